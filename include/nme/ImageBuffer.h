@@ -14,6 +14,7 @@ enum
    surfNotRepeatIfNonPO2    = 0x0001,
    surfUsePremultipliedAlpha = 0x0002,
    surfHasPremultipliedAlpha = 0x0004,
+   surfNoAtlas               = 0x0008,
 };
 
 
@@ -24,6 +24,9 @@ public:
 
    virtual void Dirty(const Rect &inRect) = 0;
    virtual bool IsCurrentVersion() = 0;
+
+   // Textures that share a page of a texture atlas return the same, non-null, page
+   virtual const void *GetAtlasPage() { return 0; }
 };
 
 
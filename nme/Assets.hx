@@ -627,7 +627,27 @@ class Assets
       return null;
    }
 
+   /**
+    * Mounts an asset pack built by the nme tool (with "packAssets" defined), so the
+    * assets it holds are found before loose files of the same name.
+    * The default pack, "assets.pak", is mounted on startup if it exists.
+    * @param   inFilename   The pack file
+    * @return      True if the pack was mounted
+    */
+   public static function mountPack(inFilename:String):Bool
+   {
+      #if (cpp||neko)
+      if (nme_asset_pack_mount==null)
+         nme_asset_pack_mount = nme.Loader.load("nme_asset_pack_mount", 1);
+      return nme_asset_pack_mount!=null && nme_asset_pack_mount(inFilename);
+      #else
+      return false;
+      #end
+   }
+
   #if (cpp||neko)
+   private static var nme_asset_pack_mount:Dynamic = null;
+
    private static var initResources:Dynamic = (function() {
        var nme_set_resource_factory = nme.Loader.load("nme_set_resource_factory", 1);
        if (nme_set_resource_factory!=null)
@@ -651,6 +671,7 @@ class Assets
              return null;
          });
       }
+      mountPack("assets.pak");
       return null; } ) ();
   #end
 
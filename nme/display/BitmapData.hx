@@ -31,6 +31,8 @@ class BitmapData extends Surface implements IBitmapDrawable
    public static var FORMAT_4444:Int = 1; //16 bit with alpha channel
    public static var FORMAT_565:Int = 2;  //16 bit 565 without alpha
 
+   static var nmePendingLoads = new Array<{ handle:Dynamic, onLoaded:BitmapData->Void }>();
+
 
    public function new(inWidth:Int, inHeight:Int, inTransparent:Bool = true, ?inFillARGB:Int, ?inGPUMode:Null<Int>)
    {
@@ -364,6 +366,51 @@ class BitmapData extends Surface implements IBitmapDrawable
       return loadFromBytes(ByteArray.fromBytes(inBytes), inRawAlpha == null ? null : ByteArray.fromBytes(inRawAlpha));
    }
 
+   // Decodes on the worker threads set with Stage.setRenderThreads, so many images can load
+   //  at once without holding up the frame.  onLoaded is called from the frame loop with the
+   //  bitmap, or null if it could not be decoded.
+   // With premultiply, the pixels are premultiplied while decoding, saving the work on upload,
+   //  but getPixel and software rendering will see premultiplied colours.
+   public static function loadAsync(inFilename:String, onLoaded:BitmapData->Void, format:Int = 0, premultiply:Bool = false):Void
+   {
+      var handle = nme_bitmap_data_load_async(inFilename, format, premultiply ? 1 : 0);
+      nmePendingLoads.push( { handle:handle, onLoaded:onLoaded } );
+   }
+
+   public static function loadFromBytesAsync(inBytes:ByteArray, onLoaded:BitmapData->Void, format:Int = 0, premultiply:Bool = false):Void
+   {
+      var handle = nme_bitmap_data_from_bytes_async(inBytes, format, premultiply ? 1 : 0);
+      nmePendingLoads.push( { handle:handle, onLoaded:onLoaded } );
+   }
+
+   /** @private */ public static function nmeLoadPending() {
+      return nmePendingLoads.length > 0;
+   }
+
+   /** @private */ public static function nmePollLoads() {
+      if (nmePendingLoads.length == 0)
+         return;
+
+      var loads = nmePendingLoads;
+      nmePendingLoads = [];
+      for(load in loads)
+      {
+         if (load.handle==null || nme_bitmap_data_load_done(load.handle))
+         {
+            var surface = load.handle==null ? null : nme_bitmap_data_load_result(load.handle);
+            var result:BitmapData = null;
+            if (surface != null)
+            {
+               result = new BitmapData(0, 0);
+               result.nmeHandle = surface;
+            }
+            load.onLoaded(result);
+         }
+         else
+            nmePendingLoads.push(load);
+      }
+   }
+
    public function lock() 
    {
       // Handled internally...
@@ -377,6 +424,10 @@ class BitmapData extends Surface implements IBitmapDrawable
    // Native Methods
    private static var nme_bitmap_data_apply_filter = Loader.load("nme_bitmap_data_apply_filter", 5);
    private static var nme_bitmap_data_generate_filter_rect = Loader.load("nme_bitmap_data_generate_filter_rect", 3);
+   private static var nme_bitmap_data_load_async = Loader.load("nme_bitmap_data_load_async", 3);
+   private static var nme_bitmap_data_from_bytes_async = Loader.load("nme_bitmap_data_from_bytes_async", 3);
+   private static var nme_bitmap_data_load_done = Loader.load("nme_bitmap_data_load_done", 1);
+   private static var nme_bitmap_data_load_result = Loader.load("nme_bitmap_data_load_result", 1);
 }
 
 
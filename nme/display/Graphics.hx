@@ -3,6 +3,7 @@ package nme.display;
 
 import nme.geom.Matrix;
 import nme.Loader;
+import nme.utils.IMemoryRange;
 
 @:nativeProperty
 class Graphics 
@@ -19,6 +20,10 @@ class Graphics
    public static inline var TILE_BLEND_NORMAL   = 0x00000000;
    public static inline var TILE_BLEND_ADD      = 0x00010000;
    //public static inline var TILE_BLEND_SUBTRACT = 0x00020000;
+   // Vertex parts for drawTriangleData, following the x,y - these match VertexFormat in Graphics.h
+   public static inline var VERTEX_UV     = 0x0001;
+   public static inline var VERTEX_UVT    = 0x0002;
+   public static inline var VERTEX_COLOUR = 0x0004;
    /** @private */ private var nmeHandle:Dynamic;
    public function new(inHandle:Dynamic) 
    {
@@ -91,6 +96,17 @@ class Graphics
       nme_gfx_draw_points(nmeHandle, inXY, inPointRGBA, inDefaultRGBA, #if (neko && (!haxe3 || neko_v1)) true #else false #end, inSize);
    }
 
+   // Like drawPoints, but with the x,y floats and ARGB ints read straight from a Float32Array,
+   //  Int32Array or ByteArray, without being converted from a haxe Array
+   public function drawPointData(inXY:IMemoryRange, ?inPointRGBA:IMemoryRange, inDefaultRGBA:Int = 0xffffffff, inSize:Float = -1.0) 
+   {
+      nme_gfx_draw_point_data(nmeHandle, inXY.getByteBuffer(), inXY.getStart(), inXY.getLength(),
+         inPointRGBA==null ? null : inPointRGBA.getByteBuffer(),
+         inPointRGBA==null ? 0 : inPointRGBA.getStart(),
+         inPointRGBA==null ? 0 : inPointRGBA.getLength(),
+         inDefaultRGBA, inSize);
+   }
+
    public function drawRect(inX:Float, inY:Float, inWidth:Float, inHeight:Float) 
    {
       nme_gfx_draw_rect(nmeHandle, inX, inY, inWidth, inHeight);
@@ -124,6 +140,19 @@ class Graphics
       nme_gfx_draw_triangles(nmeHandle, vertices, indices, uvtData, cull, colours, blendMode);
    }
 
+   // Like drawTriangles, with the vertices read straight from memory.  Each vertex is x,y floats,
+   //  then u,v (VERTEX_UV) or u,v,t (VERTEX_UVT) floats if in the format, then an ARGB int if
+   //  VERTEX_COLOUR is in the format.  The indices, if given, are 32-bit ints.
+   public function drawTriangleData(vertices:IMemoryRange, format:Int = 0, ?indices:IMemoryRange, ?culling:TriangleCulling, blendMode:Int = 0) 
+   {
+      var cull:Int = culling == null ? 0 : Type.enumIndex(culling) - 1;
+      nme_gfx_draw_triangle_data(nmeHandle, vertices.getByteBuffer(), vertices.getStart(), vertices.getLength(), format,
+         indices==null ? null : indices.getByteBuffer(),
+         indices==null ? 0 : indices.getStart(),
+         indices==null ? 0 : indices.getLength(),
+         cull, blendMode);
+   }
+
    public function endFill() 
    {
       nme_gfx_end_fill(nmeHandle);
@@ -191,6 +220,8 @@ class Graphics
    private static var nme_gfx_draw_points = Loader.load("nme_gfx_draw_points", -1);
    private static var nme_gfx_draw_round_rect = Loader.load("nme_gfx_draw_round_rect", -1);
    private static var nme_gfx_draw_triangles = Loader.load("nme_gfx_draw_triangles", -1);
+   private static var nme_gfx_draw_triangle_data = Loader.load("nme_gfx_draw_triangle_data", -1);
+   private static var nme_gfx_draw_point_data = Loader.load("nme_gfx_draw_point_data", -1);
 }
 
 #else
@@ -0,0 +1,164 @@
+package nme.display;
+#if (!flash)
+
+import nme.Loader;
+import nme.events.Event;
+
+// Particles moved and drawn by the native code - each update steps the simulation on a worker
+//  thread (see Stage.setRenderThreads), and draws the result of the previous step as tiles
+//  from the sheet, so the particles are one frame behind the settings.
+@:nativeProperty
+class ParticleEmitter extends DisplayObject
+{
+   /** The tile drawn for each particle, or -1 for the whole sheet */
+   public var tile:Int;
+   /** Particles per second */
+   public var emitRate:Float;
+   public var emitX:Float;
+   public var emitY:Float;
+   /** Particles start up to this far either side of emitX and emitY */
+   public var spreadX:Float;
+   public var spreadY:Float;
+   /** In seconds */
+   public var lifetime:Float;
+   public var lifetimeVariance:Float;
+   /** In pixels per second */
+   public var speed:Float;
+   public var speedVariance:Float;
+   /** The direction of travel in radians, and the size of the arc around it */
+   public var angle:Float;
+   public var angleSpread:Float;
+   /** In pixels per second per second */
+   public var gravityX:Float;
+   public var gravityY:Float;
+   /** The fraction of the speed lost each second, roughly */
+   public var damping:Float;
+   /** In radians per second */
+   public var spin:Float;
+   public var spinVariance:Float;
+   /** The scale and colour go from the start to the end values over each particle's life */
+   public var startScale:Float;
+   public var endScale:Float;
+   public var startColour:Int;
+   public var startAlpha:Float;
+   public var endColour:Int;
+   public var endAlpha:Float;
+   public var additive:Bool;
+   public var smooth:Bool;
+
+   /** Calls update every frame with the time since the last one */
+   public var autoUpdate(default, set_autoUpdate):Bool;
+   /** The number of particles drawn by the last update */
+   public var count(get_count, null):Int;
+
+   var nmeSettings:Array<Float>;
+   var nmeLastTime:Float;
+
+   public function new(inSheet:Tilesheet, inMaxParticles:Int = 10000)
+   {
+      super(nme_particle_emitter_create(inSheet.nmeHandle, inMaxParticles), "ParticleEmitter");
+
+      tile = -1;
+      emitRate = 100;
+      emitX = emitY = 0;
+      spreadX = spreadY = 0;
+      lifetime = 1;
+      lifetimeVariance = 0;
+      speed = 100;
+      speedVariance = 0;
+      angle = -Math.PI * 0.5;
+      angleSpread = Math.PI * 2;
+      gravityX = gravityY = 0;
+      damping = 0;
+      spin = spinVariance = 0;
+      startScale = endScale = 1;
+      startColour = endColour = 0xffffff;
+      startAlpha = 1;
+      endAlpha = 0;
+      additive = false;
+      smooth = true;
+
+      nmeSettings = [];
+      nmeLastTime = -1;
+      autoUpdate = true;
+   }
+
+   public function update(inSeconds:Float):Void
+   {
+      // The order must match ParticleSetting in Display.h
+      var s = nmeSettings;
+      s[0] = tile;
+      s[1] = emitRate;
+      s[2] = emitX;
+      s[3] = emitY;
+      s[4] = spreadX;
+      s[5] = spreadY;
+      s[6] = lifetime;
+      s[7] = lifetimeVariance;
+      s[8] = speed;
+      s[9] = speedVariance;
+      s[10] = angle;
+      s[11] = angleSpread;
+      s[12] = gravityX;
+      s[13] = gravityY;
+      s[14] = damping;
+      s[15] = spin;
+      s[16] = spinVariance;
+      s[17] = startScale;
+      s[18] = endScale;
+      s[19] = ((startColour >> 16) & 0xff) / 255.0;
+      s[20] = ((startColour >> 8) & 0xff) / 255.0;
+      s[21] = (startColour & 0xff) / 255.0;
+      s[22] = startAlpha;
+      s[23] = ((endColour >> 16) & 0xff) / 255.0;
+      s[24] = ((endColour >> 8) & 0xff) / 255.0;
+      s[25] = (endColour & 0xff) / 255.0;
+      s[26] = endAlpha;
+      s[27] = additive ? 1 : 0;
+      s[28] = smooth ? 1 : 0;
+      nme_particle_emitter_update(nmeHandle, inSeconds, s);
+   }
+
+   /** Adds inCount particles at the next update, as well as those from emitRate */
+   public function emit(inCount:Int):Void
+   {
+      nme_particle_emitter_emit(nmeHandle, inCount);
+   }
+
+   public function clearParticles():Void
+   {
+      nme_particle_emitter_clear(nmeHandle);
+   }
+
+   private function nmeOnEnterFrame(_)
+   {
+      var now = haxe.Timer.stamp();
+      update(nmeLastTime < 0 ? 0 : now - nmeLastTime);
+      nmeLastTime = now;
+   }
+
+   // Getters & Setters
+   private function set_autoUpdate(inValue:Bool):Bool
+   {
+      if (inValue != autoUpdate)
+      {
+         if (inValue)
+            addEventListener(Event.ENTER_FRAME, nmeOnEnterFrame);
+         else
+            removeEventListener(Event.ENTER_FRAME, nmeOnEnterFrame);
+         nmeLastTime = -1;
+      }
+      return autoUpdate = inValue;
+   }
+
+   private function get_count():Int { return nme_particle_emitter_get_count(nmeHandle); }
+
+   // Native Methods
+   private static var nme_particle_emitter_create = Loader.load("nme_particle_emitter_create", 2);
+   private static var nme_particle_emitter_update = Loader.load("nme_particle_emitter_update", 3);
+   private static var nme_particle_emitter_emit = Loader.load("nme_particle_emitter_emit", 2);
+   private static var nme_particle_emitter_clear = Loader.load("nme_particle_emitter_clear", 1);
+   private static var nme_particle_emitter_get_count = Loader.load("nme_particle_emitter_get_count", 1);
+}
+
+#end
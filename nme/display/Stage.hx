@@ -30,6 +30,7 @@ import nme.Lib;
 import nme.media.SoundChannel;
 import nme.net.URLLoader;
 import nme.Loader;
+import nme.utils.LzmaStream;
 import nme.Vector;
 import nme.events.StageVideoAvailabilityEvent;
 import haxe.CallStack;
@@ -816,6 +817,8 @@ class Stage extends DisplayObjectContainer implements nme.app.IPollClient implem
       //trace("poll");
       SoundChannel.nmePollComplete();
       URLLoader.nmePollData();
+      BitmapData.nmePollLoads();
+      LzmaStream.nmePollTasks();
    }
 
    public function getNextWake(inDefaultWake:Float, inTimestamp:Float) : Float
@@ -825,7 +828,8 @@ class Stage extends DisplayObjectContainer implements nme.app.IPollClient implem
       if (wake>0.001 && SoundChannel.nmeDynamicSoundCount > 0)
          wake = 0.001;
 
-      if (wake > 0.02 && (SoundChannel.nmeCompletePending() || URLLoader.nmeLoadPending())) 
+      if (wake > 0.02 && (SoundChannel.nmeCompletePending() || URLLoader.nmeLoadPending() ||
+             BitmapData.nmeLoadPending() || LzmaStream.nmeTaskPending())) 
       {
          wake =(active || !pauseWhenDeactivated) ? 0.020 : 0.500;
       }
@@ -898,6 +902,76 @@ class Stage extends DisplayObjectContainer implements nme.app.IPollClient implem
       Application.setFixedOrientation(inOrientation);
    }
 
+   // Split software rendering of large areas into horizontal bands, rendered on this many extra threads.
+   // Returns the number of threads actually available - 0 means single-threaded.
+   public static function setRenderThreads(inThreads:Int):Int
+   {
+      return nme_set_render_threads(inThreads);
+   }
+
+   // Tessellate vector graphics for hardware rendering on the render threads (see setRenderThreads).
+   // New graphics are not drawn until their first tessellation is ready, and graphics that are
+   //  cleared and drawn again keep showing their last tessellation until the new one is.
+   public static function setAsyncTessellation(inAsync:Bool):Void
+   {
+      nme_set_async_tessellation(inAsync);
+   }
+
+   // Pack the textures of small BitmapData into shared pages, so more objects can be drawn together.
+   // Only affects textures created afterwards.
+   public static function setTextureAtlas(inUseAtlas:Bool):Void
+   {
+      nme_set_texture_atlas(inUseAtlas);
+   }
+
+   // Time the phases of native rendering, and count draw calls, vertices, texture bytes uploaded,
+   //  tessellations, bitmap-cache rebuilds, filters and redundant GL state changes skipped.  With inTrace, the timings are also kept for saveProfileTrace.
+   public static function setProfiling(inEnable:Bool, inTrace:Bool = false):Void
+   {
+      nme_set_profiling(inEnable, inTrace);
+   }
+
+   // Totals for the last frame: { frameMs, drawCalls, vertices, textureBytes, tessellations,
+   //  bitmapCacheBuilds, filters, skippedStateCalls, zones:Array<{ name, ms, calls }> }
+   public static function getProfileStats():Dynamic
+   {
+      return nme_get_profile_stats();
+   }
+
+   // Write the traced timings in chrome://tracing format, and start a new trace
+   public static function saveProfileTrace(inFilename:String):Bool
+   {
+      return nme_save_profile_trace(inFilename);
+   }
+
+   // On software-rendered stages, only redraw and present the parts of the screen that have changed.
+   // Hardware stages always redraw everything.
+   public static function setDirtyRectRendering(inEnable:Bool):Void
+   {
+      nme_set_dirty_rect_rendering(inEnable);
+   }
+
+   // Walk the display list once per frame, drawing from a list made while updating the cached bitmaps.
+   // When nothing has changed since the last frame, the list is drawn again without walking it at all.
+   public static function setRenderQueue(inEnable:Bool):Void
+   {
+      nme_set_render_queue(inEnable);
+   }
+
+   // Filters and cached bitmaps reuse freed pixel memory, keeping up to this many bytes spare.
+   // Memory that is not reused within a second or so is freed anyway.  Defaults to 32MB.
+   public static function setPixelPoolBudget(inBytes:Int):Void
+   {
+      nme_set_pixel_pool_budget(inBytes);
+   }
+
+   // On hardware stages, blur, colour matrix and outer drop shadow filters run on the gpu,
+   //  rendering into textures.  Other filters, and all of them when this is off, use the cpu.
+   public static function setGpuFilters(inEnable:Bool):Void
+   {
+      nme_set_gpu_filters(inEnable);
+   }
+
 
    // Ignored - use Application.setFixedOrientation instead.
    public static dynamic function shouldRotateInterface(inOrientation:Int):Bool { return true; }
@@ -965,6 +1039,16 @@ class Stage extends DisplayObjectContainer implements nme.app.IPollClient implem
    // Native Methods
    private static var nme_render_stage = Loader.load("nme_render_stage", 1);
    private static var nme_set_render_gc_free = Loader.load("nme_set_render_gc_free", 1);
+   private static var nme_set_render_threads = Loader.load("nme_set_render_threads", 1);
+   private static var nme_set_async_tessellation = Loader.load("nme_set_async_tessellation", 1);
+   private static var nme_set_texture_atlas = Loader.load("nme_set_texture_atlas", 1);
+   private static var nme_set_profiling = Loader.load("nme_set_profiling", 2);
+   private static var nme_get_profile_stats = Loader.load("nme_get_profile_stats", 0);
+   private static var nme_save_profile_trace = Loader.load("nme_save_profile_trace", 1);
+   private static var nme_set_dirty_rect_rendering = Loader.load("nme_set_dirty_rect_rendering", 1);
+   private static var nme_set_render_queue = Loader.load("nme_set_render_queue", 1);
+   private static var nme_set_pixel_pool_budget = Loader.load("nme_set_pixel_pool_budget", 1);
+   private static var nme_set_gpu_filters = Loader.load("nme_set_gpu_filters", 1);
    private static var nme_stage_get_focus_id = Loader.load("nme_stage_get_focus_id", 1);
    private static var nme_stage_set_focus = Loader.load("nme_stage_set_focus", 3);
    private static var nme_stage_get_focus_rect = Loader.load("nme_stage_get_focus_rect", 1);
@@ -0,0 +1,291 @@
+package nme.gl;
+#if (!flash)
+
+import nme.utils.ByteArray;
+import nme.utils.IMemoryRange;
+import nme.utils.Float32Array;
+
+// Records GL calls to be run together with execute, so code making many calls a frame pays
+//  for one trip to the native code instead of one per call.  The calls run in order, just
+//  as the matching GL functions would, when execute is called - there is nothing to read
+//  back until then.
+class GLCommandBuffer
+{
+   // These must match GLCommandOp in OGLExport.cpp
+   static inline var cmdActiveTexture = 1;
+   static inline var cmdBindBuffer = 2;
+   static inline var cmdBindFramebuffer = 3;
+   static inline var cmdBindTexture = 4;
+   static inline var cmdBlendFunc = 5;
+   static inline var cmdBlendFuncSeparate = 6;
+   static inline var cmdBufferSubData = 7;
+   static inline var cmdClear = 8;
+   static inline var cmdClearColor = 9;
+   static inline var cmdColorMask = 10;
+   static inline var cmdCullFace = 11;
+   static inline var cmdDepthFunc = 12;
+   static inline var cmdDepthMask = 13;
+   static inline var cmdDisable = 14;
+   static inline var cmdDisableVertexAttribArray = 15;
+   static inline var cmdDrawArrays = 16;
+   static inline var cmdDrawElements = 17;
+   static inline var cmdEnable = 18;
+   static inline var cmdEnableVertexAttribArray = 19;
+   static inline var cmdScissor = 20;
+   static inline var cmdUniform1f = 21;
+   static inline var cmdUniform2f = 22;
+   static inline var cmdUniform3f = 23;
+   static inline var cmdUniform4f = 24;
+   static inline var cmdUniform1i = 25;
+   static inline var cmdUniform2i = 26;
+   static inline var cmdUniform3i = 27;
+   static inline var cmdUniform4i = 28;
+   static inline var cmdUniformfv = 29;
+   static inline var cmdUniformMatrix = 30;
+   static inline var cmdUseProgram = 31;
+   static inline var cmdVertexAttribPointer = 32;
+   static inline var cmdViewport = 33;
+
+   /** The number of calls recorded since the last execute */
+   public var length(default, null):Int;
+
+   var bytes:ByteArray;
+   var objects:Array<Dynamic>;
+
+   public function new(inReserveBytes:Int = 4096)
+   {
+      bytes = new ByteArray(inReserveBytes);
+      bytes.bigEndian = false;
+      bytes.position = 0;
+      objects = [];
+      length = 0;
+   }
+
+   // Runs the recorded calls, and starts recording again
+   public function execute():Void
+   {
+      if (length > 0)
+         nme_gl_execute_commands(bytes, bytes.position, objects);
+      reset();
+   }
+
+   // Drops the recorded calls
+   public function reset():Void
+   {
+      bytes.position = 0;
+      if (objects.length > 0)
+         objects = [];
+      length = 0;
+   }
+
+   public function activeTexture(texture:Int):Void { op1(cmdActiveTexture, texture); }
+
+   public function bindBuffer(target:Int, buffer:GLBuffer):Void
+   {
+      op2(cmdBindBuffer, target, object(buffer));
+   }
+
+   public function bindFramebuffer(target:Int, framebuffer:GLFramebuffer):Void
+   {
+      op2(cmdBindFramebuffer, target, object(framebuffer));
+   }
+
+   public function bindTexture(target:Int, texture:GLTexture):Void
+   {
+      op2(cmdBindTexture, target, object(texture));
+   }
+
+   public function blendFunc(sfactor:Int, dfactor:Int):Void { op2(cmdBlendFunc, sfactor, dfactor); }
+
+   public function blendFuncSeparate(srcRGB:Int, dstRGB:Int, srcAlpha:Int, dstAlpha:Int):Void
+   {
+      op4(cmdBlendFuncSeparate, srcRGB, dstRGB, srcAlpha, dstAlpha);
+   }
+
+   // The data is copied now, so it may be changed before execute
+   public function bufferSubData(target:Int, offset:Int, data:IMemoryRange):Void
+   {
+      var len = data.getLength();
+      op3(cmdBufferSubData, target, offset, len);
+      if (len > 0)
+         bytes.writeBytes(data.getByteBuffer(), data.getStart(), len);
+      while( (bytes.position & 3) != 0 )
+         bytes.writeByte(0);
+   }
+
+   public function clear(mask:Int):Void { op1(cmdClear, mask); }
+
+   public function clearColor(red:Float, green:Float, blue:Float, alpha:Float):Void
+   {
+      bytes.writeInt(cmdClearColor);
+      bytes.writeFloat(red);
+      bytes.writeFloat(green);
+      bytes.writeFloat(blue);
+      bytes.writeFloat(alpha);
+      length++;
+   }
+
+   public function colorMask(red:Bool, green:Bool, blue:Bool, alpha:Bool):Void
+   {
+      op4(cmdColorMask, red ? 1 : 0, green ? 1 : 0, blue ? 1 : 0, alpha ? 1 : 0);
+   }
+
+   public function cullFace(mode:Int):Void { op1(cmdCullFace, mode); }
+   public function depthFunc(func:Int):Void { op1(cmdDepthFunc, func); }
+   public function depthMask(flag:Bool):Void { op1(cmdDepthMask, flag ? 1 : 0); }
+   public function disable(cap:Int):Void { op1(cmdDisable, cap); }
+   public function disableVertexAttribArray(index:Int):Void { op1(cmdDisableVertexAttribArray, index); }
+   public function drawArrays(mode:Int, first:Int, count:Int):Void { op3(cmdDrawArrays, mode, first, count); }
+
+   public function drawElements(mode:Int, count:Int, type:Int, offset:Int):Void
+   {
+      op4(cmdDrawElements, mode, count, type, offset);
+   }
+
+   public function enable(cap:Int):Void { op1(cmdEnable, cap); }
+   public function enableVertexAttribArray(index:Int):Void { op1(cmdEnableVertexAttribArray, index); }
+
+   public function scissor(x:Int, y:Int, width:Int, height:Int):Void { op4(cmdScissor, x, y, width, height); }
+
+   public function uniform1f(location:GLUniformLocation, x:Float):Void
+   {
+      bytes.writeInt(cmdUniform1f);
+      bytes.writeInt(location);
+      bytes.writeFloat(x);
+      length++;
+   }
+
+   public function uniform2f(location:GLUniformLocation, x:Float, y:Float):Void
+   {
+      bytes.writeInt(cmdUniform2f);
+      bytes.writeInt(location);
+      bytes.writeFloat(x);
+      bytes.writeFloat(y);
+      length++;
+   }
+
+   public function uniform3f(location:GLUniformLocation, x:Float, y:Float, z:Float):Void
+   {
+      bytes.writeInt(cmdUniform3f);
+      bytes.writeInt(location);
+      bytes.writeFloat(x);
+      bytes.writeFloat(y);
+      bytes.writeFloat(z);
+      length++;
+   }
+
+   public function uniform4f(location:GLUniformLocation, x:Float, y:Float, z:Float, w:Float):Void
+   {
+      bytes.writeInt(cmdUniform4f);
+      bytes.writeInt(location);
+      bytes.writeFloat(x);
+      bytes.writeFloat(y);
+      bytes.writeFloat(z);
+      bytes.writeFloat(w);
+      length++;
+   }
+
+   public function uniform1i(location:GLUniformLocation, x:Int):Void { op2(cmdUniform1i, location, x); }
+   public function uniform2i(location:GLUniformLocation, x:Int, y:Int):Void { op3(cmdUniform2i, location, x, y); }
+   public function uniform3i(location:GLUniformLocation, x:Int, y:Int, z:Int):Void { op4(cmdUniform3i, location, x, y, z); }
+
+   public function uniform4i(location:GLUniformLocation, x:Int, y:Int, z:Int, w:Int):Void
+   {
+      op4(cmdUniform4i, location, x, y, z);
+      bytes.writeInt(w);
+   }
+
+   public function uniform1fv(location:GLUniformLocation, v:Array<Float>):Void { uniformfv(location, 1, v); }
+   public function uniform2fv(location:GLUniformLocation, v:Array<Float>):Void { uniformfv(location, 2, v); }
+   public function uniform3fv(location:GLUniformLocation, v:Array<Float>):Void { uniformfv(location, 3, v); }
+   public function uniform4fv(location:GLUniformLocation, v:Array<Float>):Void { uniformfv(location, 4, v); }
+
+   public function uniformMatrix2fv(location:GLUniformLocation, transpose:Bool, v:Float32Array):Void
+   {
+      uniformMatrix(location, transpose, 2, v);
+   }
+
+   public function uniformMatrix3fv(location:GLUniformLocation, transpose:Bool, v:Float32Array):Void
+   {
+      uniformMatrix(location, transpose, 3, v);
+   }
+
+   public function uniformMatrix4fv(location:GLUniformLocation, transpose:Bool, v:Float32Array):Void
+   {
+      uniformMatrix(location, transpose, 4, v);
+   }
+
+   public function useProgram(program:GLProgram):Void { op1(cmdUseProgram, object(program)); }
+
+   public function vertexAttribPointer(indx:Int, size:Int, type:Int, normalized:Bool, stride:Int, offset:Int):Void
+   {
+      op4(cmdVertexAttribPointer, indx, size, type, normalized ? 1 : 0);
+      bytes.writeInt(stride);
+      bytes.writeInt(offset);
+   }
+
+   public function viewport(x:Int, y:Int, width:Int, height:Int):Void { op4(cmdViewport, x, y, width, height); }
+
+
+   function uniformfv(location:GLUniformLocation, components:Int, v:Array<Float>):Void
+   {
+      op3(cmdUniformfv, location, components, v.length);
+      for(f in v)
+         bytes.writeFloat(f);
+   }
+
+   function uniformMatrix(location:GLUniformLocation, transpose:Bool, size:Int, v:Float32Array):Void
+   {
+      var floats = v.length;
+      op4(cmdUniformMatrix, location, transpose ? 1 : 0, size, floats);
+      for(i in 0...floats)
+         bytes.writeFloat(v[i]);
+   }
+
+   inline function object(inObject:GLObject):Int
+   {
+      if (inObject == null)
+         return -1;
+      objects.push(inObject);
+      return objects.length - 1;
+   }
+
+   inline function op1(inOp:Int, a:Int):Void
+   {
+      bytes.writeInt(inOp);
+      bytes.writeInt(a);
+      length++;
+   }
+
+   inline function op2(inOp:Int, a:Int, b:Int):Void
+   {
+      bytes.writeInt(inOp);
+      bytes.writeInt(a);
+      bytes.writeInt(b);
+      length++;
+   }
+
+   inline function op3(inOp:Int, a:Int, b:Int, c:Int):Void
+   {
+      bytes.writeInt(inOp);
+      bytes.writeInt(a);
+      bytes.writeInt(b);
+      bytes.writeInt(c);
+      length++;
+   }
+
+   inline function op4(inOp:Int, a:Int, b:Int, c:Int, d:Int):Void
+   {
+      bytes.writeInt(inOp);
+      bytes.writeInt(a);
+      bytes.writeInt(b);
+      bytes.writeInt(c);
+      bytes.writeInt(d);
+      length++;
+   }
+
+   // Native Methods
+   private static var nme_gl_execute_commands = GL.load("nme_gl_execute_commands", 3);
+}
+
+#end
@@ -0,0 +1,112 @@
+package nme.utils;
+#if (!flash)
+
+import nme.utils.ByteArray;
+import nme.Loader;
+
+// Decodes data written by ByteArray.compress(LZMA) a piece at a time, so a large download
+//  or file can be decoded as it arrives without holding the whole of the input or output.
+class LzmaStream
+{
+   /** The decoded size, or -1 until the header has been pushed */
+   public var totalLength(get_totalLength, null):Int;
+   /** The number of bytes pulled so far */
+   public var position(get_position, null):Int;
+   /** True once all the output has been pulled */
+   public var finished(get_finished, null):Bool;
+
+   /** @private */ private var nmeHandle:Dynamic;
+
+   static var nmePendingTasks = new Array<LzmaTaskInfo>();
+
+   public function new()
+   {
+      nmeHandle = nme_lzma_stream_create();
+   }
+
+   public function push(inBytes:ByteArray, inOffset:Int = 0, inLength:Int = -1):Void
+   {
+      if (inLength < 0)
+         inLength = inBytes.length - inOffset;
+      nme_lzma_stream_push(nmeHandle, inBytes, inOffset, inLength);
+   }
+
+   // Returns what can be decoded from the input pushed so far, up to inMaxLength bytes.
+   // Throws if the data is not valid.
+   public function pull(inMaxLength:Int = 0x10000):ByteArray
+   {
+      var result:ByteArray = nme_lzma_stream_pull(nmeHandle, inMaxLength);
+      if (result == null)
+         throw "Invalid lzma data";
+      return result;
+   }
+
+   // Whole buffers, on the worker threads set with Stage.setRenderThreads.  onComplete is
+   //  called from the frame loop with the result, or null if the data could not be decoded.
+   //  onProgress, if given, is called each frame with a value from 0 to 1.
+   public static function encodeAsync(inBytes:ByteArray, onComplete:ByteArray->Void, ?onProgress:Float->Void):Void
+   {
+      var handle = nme_lzma_task_create(inBytes, true);
+      nmePendingTasks.push( { handle:handle, onComplete:onComplete, onProgress:onProgress } );
+   }
+
+   public static function decodeAsync(inBytes:ByteArray, onComplete:ByteArray->Void, ?onProgress:Float->Void):Void
+   {
+      var handle = nme_lzma_task_create(inBytes, false);
+      nmePendingTasks.push( { handle:handle, onComplete:onComplete, onProgress:onProgress } );
+   }
+
+   /** @private */ public static function nmeTaskPending() {
+      return nmePendingTasks.length > 0;
+   }
+
+   /** @private */ public static function nmePollTasks() {
+      if (nmePendingTasks.length == 0)
+         return;
+
+      var tasks = nmePendingTasks;
+      nmePendingTasks = [];
+      for(task in tasks)
+      {
+         if (task.handle==null || nme_lzma_task_done(task.handle))
+         {
+            var result:ByteArray = task.handle==null ? null : nme_lzma_task_result(task.handle);
+            if (result != null && task.onProgress != null)
+               task.onProgress(1.0);
+            task.onComplete(result);
+         }
+         else
+         {
+            if (task.onProgress != null)
+               task.onProgress(nme_lzma_task_progress(task.handle));
+            nmePendingTasks.push(task);
+         }
+      }
+   }
+
+   // Getters & Setters
+   private function get_totalLength():Int { return nme_lzma_stream_get_total(nmeHandle); }
+   private function get_position():Int { return nme_lzma_stream_get_position(nmeHandle); }
+   private function get_finished():Bool { return nme_lzma_stream_get_finished(nmeHandle); }
+
+   // Native Methods
+   private static var nme_lzma_stream_create = Loader.load("nme_lzma_stream_create", 0);
+   private static var nme_lzma_stream_push = Loader.load("nme_lzma_stream_push", 4);
+   private static var nme_lzma_stream_pull = Loader.load("nme_lzma_stream_pull", 2);
+   private static var nme_lzma_stream_get_total = Loader.load("nme_lzma_stream_get_total", 1);
+   private static var nme_lzma_stream_get_position = Loader.load("nme_lzma_stream_get_position", 1);
+   private static var nme_lzma_stream_get_finished = Loader.load("nme_lzma_stream_get_finished", 1);
+   private static var nme_lzma_task_create = Loader.load("nme_lzma_task_create", 2);
+   private static var nme_lzma_task_done = Loader.load("nme_lzma_task_done", 1);
+   private static var nme_lzma_task_progress = Loader.load("nme_lzma_task_progress", 1);
+   private static var nme_lzma_task_result = Loader.load("nme_lzma_task_result", 1);
+}
+
+typedef LzmaTaskInfo =
+{
+   handle:Dynamic,
+   onComplete:ByteArray->Void,
+   onProgress:Float->Void,
+}
+
+#end
@@ -0,0 +1,48 @@
+#ifndef NME_ASSET_PACK_H
+#define NME_ASSET_PACK_H
+
+#include "Utils.h"
+
+namespace nme
+{
+
+class MappedFile;
+
+// --- Asset packs ---------------------------------------------------------
+//
+// A pack is one file holding many assets, written by the nme tool, so startup needs a
+//  single open and the data sits together on disk.  The pack is mapped once, and entries
+//  are found through an index sorted by name hash.  Stored entries are shared straight
+//  from the mapping, while compressed ones are decoded each time they are opened.
+//
+// All values are 32 bit little endian:
+//   header  "NMEP", version, entry count, index offset, names offset, names size,
+//           data alignment, reserved
+//   index   per entry: hash, flags, name offset, name length, data offset, stored size,
+//           size, reserved - sorted by hash
+//   names   utf8, not terminated
+//   data    each entry aligned, and in the Lzma::Encode format if compressed
+
+class AssetPack
+{
+public:
+   enum { entryLzma = 0x0001 };
+
+   // Packs stay mounted, with their mapping, for the life of the process.
+   // Entries of later packs are found first.
+   static bool Mount(const OSChar *inFilename);
+
+   // Returns the entry with one reference, or 0 if no mounted pack holds it
+   static MappedFile *Open(const char *inName);
+   #ifdef HX_WINDOWS
+   static MappedFile *Open(const wchar_t *inName);
+   #endif
+   static bool Contains(const char *inName);
+
+   // 32 bit FNV-1a of the utf8 name
+   static unsigned int Hash(const char *inName, int inLength);
+};
+
+} // end namespace nme
+
+#endif
@@ -19,6 +19,7 @@ struct ByteArray
    ByteArray();
    ByteArray(value Value);
    ByteArray(const QuickVec<unsigned char>  &inValue);
+   ByteArray(const unsigned char *inData, int inSize);
    ByteArray(const char *inResourceName);
 
    void          Resize(int inSize);
@@ -10,7 +10,7 @@ namespace nme
 extern int gCachedExtentID;
 struct CachedExtent
 {
-   CachedExtent() : mID(0), mIncludeStroke(false), mIsSet(false), mForScreen(false) {}
+   CachedExtent() : mID(0), mIncludeStroke(false), mIsSet(false), mForScreen(false), mForHitTest(false) {}
    Extent2DF Get(const Transform &inTransform);
 
    Transform mTransform;
@@ -21,10 +21,24 @@ struct CachedExtent
    bool      mIncludeStroke;
    bool      mIsSet;
    bool      mForScreen;
+   bool      mForHitTest;
    int       mID;
 };
 
 
+// The last few extents of something, by transform.  Only the translation may differ
+//  between the transforms sharing an extent.
+struct CachedExtentSet
+{
+   // Returns the slot for the transform, set up for it and with outFound false if it must
+   //  be measured
+   CachedExtent &Find(const Transform &inTransform,bool inIncludeStroke,bool &outFound);
+   void Clear();
+
+   CachedExtent mSlots[3];
+};
+
+
 
 class CachedExtentRenderer : public Renderer
 {
@@ -37,7 +51,7 @@ public:
    virtual void GetExtent(CachedExtent &ioCache) = 0;
 
 private:
-   CachedExtent mExtentCache[3];
+   CachedExtentSet mExtentCache;
 };
 
 } // end namespace NME
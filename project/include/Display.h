@@ -75,6 +75,74 @@ extern const char *sHandCursorData[];
 
 extern bool gMouseShowCursor;
 
+// Redraw only the changed parts of software stages that keep their back buffer
+extern bool gDirtyRectRendering;
+
+// Screen rects that need to be redrawn, kept as a few rects that do not overlap much
+class DamageRegion
+{
+public:
+   DamageRegion() : mFull(true) { }
+
+   void Add(const Rect &inRect);
+   void SetFull() { mFull = true; mRects.resize(0); }
+   void Reset() { mFull = false; mRects.resize(0); }
+   // Clip to the target, and give up on the rects if they cover most of it anyway
+   void Finish(const Rect &inBounds);
+
+   bool IsFull() const { return mFull; }
+   int  Count() const { return mRects.size(); }
+   const Rect &operator[](int inIndex) const { return mRects[inIndex]; }
+
+private:
+   bool           mFull;
+   QuickVec<Rect> mRects;
+};
+
+// Record the render phase while doing the bitmap phase, and draw from the record
+extern bool gUseRenderQueue;
+// Changes whenever any display object is dirtied
+extern unsigned int gDisplayListVersion;
+
+enum RenderQueueKind { rqOwn, rqWhole, rqBitmap };
+
+// The rpRender phase as a flat list.  The rpBitmap phase visits everything in exactly the
+//  reverse order, so it records the items as it goes and they are drawn last-first.
+// If nothing has been dirtied since, the list can be drawn again without walking the tree.
+class RenderQueue
+{
+public:
+   RenderQueue() : mRecorded(false), mVersion(0), mHasMasks(false) { }
+
+   void Clear();
+   // Start recording with ioState as the root
+   void Begin(RenderState &ioState,bool inHardware);
+   void Add(RenderQueueKind inKind,class DisplayObject *inObject,const RenderState &inState);
+   bool StillGood(const RenderState &inState,bool inHardware);
+   void Render(const RenderTarget &inTarget,const RenderState &inState);
+
+private:
+   struct Item
+   {
+      class DisplayObject *mObject;
+      class BitmapCache   *mMask;
+      Matrix              mMatrix;
+      Rect                mClip;
+      int                 mColour;
+      RenderQueueKind     mKind;
+   };
+
+   bool                     mRecorded;
+   unsigned int             mVersion;
+   Matrix                   mRoot;
+   Rect                     mRootClip;
+   int                      mAA;
+   bool                     mHardware;
+   bool                     mHasMasks;
+   QuickVec<Item>           mItems;
+   QuickVec<ColorTransform> mColours;
+};
+
 class DisplayObject : public Object
 {
 public:
@@ -162,7 +230,11 @@ public:
    bool   needsSoftKeyboard;
    bool   movesForSoftKeyboard;
 
-   virtual void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke);
+   // inForHitTest adds areas that are only hit-tested, such as SimpleButton's hit state
+   virtual void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke,
+                          bool inForHitTest=false);
+   // Quick test of the bounds, before hit-testing with a render
+   bool MayHit(const Transform &inTrans,const Rect &inClip);
 
    virtual void Render( const RenderTarget &inTarget, const RenderState &inState );
 
@@ -176,6 +248,12 @@ public:
    virtual void ClearExtentDirty();
    virtual bool NonNormalBlendChild() { return false; }
 
+   // Adds where this has changed since the last call, given its screen matrix and colour
+   virtual void CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,
+                              DamageRegion &ioDamage);
+   // Adds where this was drawn, for when it is no longer drawn
+   virtual void ForgetDrawn(DamageRegion &ioDamage);
+
    virtual Cursor GetCursor() { return curPointer; }
    virtual bool WantsFocus() { return false; }
    virtual void Focus();
@@ -204,6 +282,8 @@ public:
 
    virtual bool IsCacheDirty();
    virtual void ClearCacheDirty();
+   // Whether rpBitmap adds the children to the render queue, rather than this as a whole
+   virtual bool QueuesChildren() { return false; }
 
    void CheckCacheDirty(bool inForHardware);
    bool IsBitmapRender(bool inForHardware);
@@ -236,6 +316,12 @@ protected:
    DisplayObject          *mMask;
    int                    mIsMaskCount;
 
+   // Damage tracking
+   void UpdateDrawn(const Rect &inRect,uint32 inKey,bool inDirty,DamageRegion &ioDamage);
+   Rect                   mDrawnRect;
+   uint32                 mDrawnKey;
+   bool                   mDrawn;
+
    // Matrix stuff
    Matrix mLocalMatrix;
    // Decomp
@@ -269,11 +355,15 @@ public:
    void Render( const RenderTarget &inTarget, const RenderState &inState );
    bool IsCacheDirty();
    void ClearCacheDirty();
+   bool QueuesChildren() { return true; }
    bool NonNormalBlendChild();
-   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke);
+   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke,
+                  bool inForHitTest=false);
    void DirtyCache(bool inParentOnly = false);
    virtual void DirtyExtent();
    virtual void ClearExtentDirty();
+   void CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,DamageRegion &ioDamage);
+   void ForgetDrawn(DamageRegion &ioDamage);
 
    bool IsInteractive() const { return true; }
 
@@ -287,6 +377,7 @@ public:
    CachedExtent mExtentCache[3];
 protected:
    ~DisplayObjectContainer();
+   void CollectWholeDamage(const Matrix &inMatrix,const ColorTransform &inColour,DamageRegion &ioDamage);
    QuickVec<DisplayObject *> mChildren;
 };
 
@@ -303,6 +394,43 @@ public:
    RenderFunc onRender;
 };
 
+// The settings of a ParticleEmitter, in the order haxe passes them
+enum ParticleSetting
+{
+   psTile, psRate, psX, psY, psSpreadX, psSpreadY,
+   psLife, psLifeVariance, psSpeed, psSpeedVariance, psAngle, psAngleSpread,
+   psGravityX, psGravityY, psDamping, psSpin, psSpinVariance,
+   psStartScale, psEndScale,
+   psStartR, psStartG, psStartB, psStartA,
+   psEndR, psEndG, psEndB, psEndA,
+   psAdditive, psSmooth,
+   psSIZE
+};
+
+// Simulates particles natively and draws them as tiles of a Tilesheet, through the same
+//  tile jobs as drawTiles.  Each Update draws the particles of the last step and starts the
+//  next step on a worker thread, so the simulation runs while the frame is rendered.
+class ParticleEmitter : public DisplayObject
+{
+public:
+   ParticleEmitter(class Tilesheet *inSheet, int inMaxParticles);
+
+   // inSettings holds psSIZE values
+   void Update(double inSeconds, const float *inSettings);
+   void Emit(int inCount) { mBurst += inCount; }
+   void ClearParticles() { mClear = true; }
+   int  GetCount() const { return mDrawnCount; }
+
+protected:
+   ~ParticleEmitter();
+
+   class Tilesheet       *mSheet;
+   class ParticleSystem  *mSystem;
+   int                   mBurst;
+   bool                  mClear;
+   int                   mDrawnCount;
+};
+
 class SimpleButton : public DisplayObjectContainer
 {
 public:
@@ -317,11 +445,14 @@ public:
 
 
    void Render( const RenderTarget &inTarget, const RenderState &inState );
-   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke);
+   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke,
+                  bool inForHitTest=false);
    bool IsCacheDirty();
    void ClearCacheDirty();
+   bool QueuesChildren() { return false; }
    bool NonNormalBlendChild();
    void DirtyCache(bool inParentOnly = false);
+   void CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,DamageRegion &ioDamage);
 
    bool getEnabled() const { return enabled; }
    void setEnabled(bool inEnabled) { enabled = inEnabled; }
@@ -415,6 +546,12 @@ public:
    void RemovingFromStage(DisplayObject *inObject);
    Stage  *getStage() { return this; }
 
+   // Software stages that still have the last frame in their primary surface when rendering
+   //  can redraw just the damaged parts - Flip may then present only GetDamage()
+   virtual bool KeepsBackBuffer() { return false; }
+   const DamageRegion &GetDamage() const { return mDamage; }
+   void DamageAll() { mDamage.SetFull(); }
+
    virtual class StageVideo *createStageVideo(void *) { return 0; }
    virtual void cleanStageVideo() {}
 
@@ -438,6 +575,15 @@ protected:
 
    Matrix         mStageScale;
 
+   void FindDamage();
+   void RenderPass(const RenderState &inState);
+   DamageRegion   mDamage;
+   RenderQueue    mRenderQueue;
+   bool           mDamageActive;
+   bool           mDamageClear;
+   int            mDamageWidth;
+   int            mDamageHeight;
+
    int            mNominalWidth;
    int            mNominalHeight;
 
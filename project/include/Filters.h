@@ -89,6 +89,9 @@ typedef QuickVec<Filter *> FilterList;
 
 Rect ExpandVisibleFilterDomain( const FilterList &inList, const Rect &inRect );
 
+// Lets hardware stages run the filters of cached bitmaps on the gpu, where they can
+extern bool gGPUFilters;
+
 Surface *FilterBitmap(const FilterList &inList, Surface *inBitmap,
                        const Rect &inSrcRect, const Rect &inDestRect, bool inMakePOW2,
                         ImagePoint inSrc0 = ImagePoint(0,0) );
@@ -13,6 +13,8 @@
 namespace nme
 {
 
+class MappedFile;
+
 struct TextLineMetrics
 {
    float ascent;
@@ -161,7 +163,7 @@ public:
    virtual ~FontFace() { };
 
    static FontFace *CreateNative(const TextFormat &inFormat,double inScale);
-   static FontFace *CreateFreeType(const TextFormat &inFormat,double inScale,AutoGCRoot *inBytes, const std::string &inCombinedName);
+   static FontFace *CreateFreeType(const TextFormat &inFormat,double inScale,MappedFile *inBytes, const std::string &inCombinedName);
    static FontFace *CreateCFFIFont(const TextFormat &inFormat,double inScale);
 
    virtual bool GetGlyphInfo(int inChar, int &outW, int &outH, int &outAdvance,
@@ -209,7 +211,6 @@ private:
    FontFace              *mFace;
 
    int    mPixelHeight;
-   int    mCurrentSheet;
 };
 
 class FontCache
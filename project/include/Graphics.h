@@ -291,7 +291,8 @@ public:
    void wideMoveTo(float x, float y);
    void tile(float x, float y, const Rect &inTileRect, float *inTrans,float *inColour);
    void elementBlendMode(int inMode);
-   void drawPoints(QuickVec<float> inXYs, QuickVec<int> inRGBAs);
+   // inRGBAs may be null
+   void drawPoints(const float *inXYs, const int *inRGBAs, int inCount);
    void closeLine(int inCommand0, int inData0);
 
    void reserveTiles(int inN, bool inFullImage, bool inTrans2x2, bool inHasColour);
@@ -348,6 +349,10 @@ enum TriangleCulling { tcNegative = -1, tcNone = 0, tcPositive = 1};
 
 enum VertexType { vtVertex, vtVertexUV, vtVertexUVT };
 
+// The parts of each interleaved vertex given to drawTriangleData, after the x,y: u,v (or
+//  u,v,t), then an ARGB int
+enum VertexFormat { vfUV = 0x01, vfUVT = 0x02, vfColour = 0x04 };
+
 class GraphicsTrianglePath : public IGraphicsPath
 {
 public:
@@ -356,6 +361,10 @@ public:
             const QuickVec<float> &inUVT, int inCull,
             const QuickVec<int> &inColours,
             int blendMode );
+   // The interleaved vertices are split into the arrays below, which all the renderers read,
+   //  and hardware renderers copy them again into their vertex array.
+   GraphicsTrianglePath( const float *inVertices, int inVertexCount, int inFormat,
+            const int *inIndices, int inIndexCount, int inCull, int inBlendMode );
 
    VertexType       mType;
    int              mTriangleCount;
@@ -363,6 +372,12 @@ public:
    QuickVec<float>  mUVT;
    QuickVec<uint32> mColours;
    int mBlendMode;
+
+private:
+   void Init(const float *inXY, int inXYStride,
+             const float *inUVT, int inUVTStride, int inUVParts,
+             const int *inColours, int inColourStride,
+             int inVertexCount, const int *inIndices, int inIndexCount, int inCull);
 };
 
 // ----------------------------------------------------------------------
@@ -495,6 +510,7 @@ public:
 
 	ImagePoint mMaskOffset;
 	int        mMaskVersion;
+   int        mContextVersion;
 };
 
 
@@ -534,6 +550,8 @@ struct RenderState
 	bool           *mWasDirtyPtr;
    // Masking...
    class BitmapCache    *mMask;
+   // Records the render phase while doing the bitmap phase, if set
+   class RenderQueue    *mQueue;
    // HitTest result...
    mutable class DisplayObject  *mHitResult;
 };
@@ -542,6 +560,10 @@ struct RenderState
 class HardwareData;
 class HardwareRenderer;
 
+// Tessellate new hardware graphics on the worker threads, drawing the previous tessellation
+//  until they are ready.  Graphics with nothing drawn yet are tessellated straight away.
+extern bool gAsyncTessellation;
+
 
 int UpToPower2(int inX);
 inline int IsPower2(unsigned int inX) { return (inX & (inX-1))==0; }
@@ -604,6 +626,8 @@ struct GraphicsJob
 
    void clear();
    int  Version() const { return (mFill?mFill->Version():0) + (mStroke?mStroke->Version():0); }
+   // Measured from the path data, and cached by transform
+   void GetExtent(const GraphicsPath &inPath, const Transform &inTransform, Extent2DF &ioExtent, bool inIncludeStroke);
 
    GraphicsStroke  *mStroke;
    IGraphicsFill   *mFill;
@@ -612,6 +636,8 @@ struct GraphicsJob
    class Renderer  *mHardwareRenderer;
    #endif
    class Renderer  *mSoftwareRenderer;
+   struct CachedExtentSet *mExtents;
+   int             mExtentVersion;
    int             mCommand0;
    int             mData0;
    union
@@ -639,7 +665,7 @@ public:
 
    void clear(bool inForceHardwareFree=false);
 
-   Extent2DF GetSoftwareExtent(const Transform &inTransform,bool inIncludeStroke);
+   Extent2DF GetExtent(const Transform &inTransform,bool inIncludeStroke);
 
    bool Render( const RenderTarget &inTarget, const RenderState &inState );
 
@@ -680,10 +706,14 @@ public:
               int inTileFlags = pcTile | pcTile_Trans_Bit | pcTile_Col_Bit, int inCount=0 );
    void endTiles();
    void tile(float x, float y, const Rect &inTileRect, float *inTrans,float *inColour);
-   void drawPoints(QuickVec<float> inXYs, QuickVec<int> inRGBAs, unsigned int inDefaultRGBA=0xffffffff, double inSize=-1.0 );
+   void drawPoints(const QuickVec<float> &inXYs, const QuickVec<int> &inRGBAs, unsigned int inDefaultRGBA=0xffffffff, double inSize=-1.0 );
+   void drawPointData(const float *inXYs, const int *inRGBAs, int inCount, unsigned int inDefaultRGBA=0xffffffff, double inSize=-1.0 );
    void drawTriangles(const QuickVec<float> &inXYs, const QuickVec<int> &inIndixes,
             const QuickVec<float> &inUVT, int inCull, const QuickVec<int> &inColours,
             int blendMode );
+   // Vertices are interleaved, as described by the VertexFormat flags in inFormat
+   void drawTriangleData(const float *inVertices, int inVertexCount, int inFormat,
+            const int *inIndices, int inIndexCount, int inCull, int blendMode );
    void close();
 
    const Extent2DF &GetExtent0(double inRotation);
@@ -697,8 +727,13 @@ public:
    int Version() const;
 
 protected:
-   void                      BuildHardware();
+   void                      BuildHardware(const RenderTarget &inTarget, const RenderState &inState);
+   void                      KeepHardwareScale(HardwareData *inData, float inScale);
+   void                      ClearHardwareScales();
+   void                      CancelHardwareTask();
+   void                      KeepLastHardware();
    void                      Flush(bool inLine=true,bool inFill=true,bool inTile=true);
+   void                      AddTriangleJob(GraphicsTrianglePath *inPath);
    inline void               OnChanged();
 
 private:
@@ -713,6 +748,11 @@ private:
 
    GraphicsPath              *mPathData;
    HardwareData              *mHardwareData;
+   // Drawn after a clear, until the new jobs are built
+   HardwareData              *mLastHardware;
+   // Complete tessellations at other scales
+   QuickVec<HardwareData *>  mHardwareScales;
+   class HardwareBuildTask   *mHardwareTask;
 
    double                    mRotation0;
    Extent2DF                 mExtent0;
@@ -2,6 +2,7 @@
 #define NME_HARDWARE_H
 
 #include "Graphics.h"
+#include "Filters.h"
 
 namespace nme
 {
@@ -53,6 +54,14 @@ struct DrawElement
 
 typedef QuickVec<DrawElement> DrawElements;
 
+// Bounds of the vertices of a DrawElement, for rejecting hit tests
+struct DrawElementExtent
+{
+   Extent2DF mExtent;
+   int       mVertexOffset;
+   int       mCount;
+};
+
 class HardwareData
 {
 public:
@@ -63,11 +72,17 @@ public:
    float           scaleOf(const RenderState &inState) const;
    bool            isScaleOk(const RenderState &inState) const;
    void            clear();
+   const Extent2DF &getElementExtent(int inElement) const;
 
    DrawElements    mElements;
    QuickVec<uint8> mArray;
    float           mMinScale;
    float           mMaxScale;
+   // gTextureAtlasVersion if any tex-coords point into the texture atlas, otherwise 0
+   int             mAtlasVersion;
+
+   // Calculated on demand, checked against the element in case it has grown
+   mutable QuickVec<DrawElementExtent> mElementExtents;
 
    mutable class HardwareRenderer *mVboOwner;
    mutable int             mRendersWithoutVbo;
@@ -114,10 +129,20 @@ public:
 
 
    virtual void Render(const RenderState &inState, const HardwareData &inData )=0;
+   // inData is about to be cleared or deleted, so any reference to it must be dropped
+   virtual void ForgetData(const HardwareData *inData) { }
    virtual void BeginBitmapRender(Surface *inSurface,uint32 inTint=0,bool inRepeat=true,bool inSmooth=true)=0;
    virtual void RenderBitmap(const Rect &inSrc, int inX, int inY)=0;
    virtual void EndBitmapRender()=0;
 
+   // Filters the bitmap on the gpu, returning a new surface with a reference, or 0 to have
+   //  it done on the cpu.  The arguments match FilterBitmap, but inBitmap is not released.
+   virtual Surface *FilterBitmap(const FilterList &inFilters, Surface *inBitmap,
+                         const Rect &inSrcRect, const Rect &inDestRect, ImagePoint inSrc0)
+   {
+      return 0;
+   }
+
    virtual void BeginDirectRender()=0;
    virtual void EndDirectRender()=0;
 
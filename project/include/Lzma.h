@@ -2,16 +2,80 @@
 #define NME_LZMA_H
 
 #include <hx/CFFI.h>
+#include <nme/Object.h>
+#include <nme/QuickVec.h>
+#include <NMEThread.h>
 
 namespace nme {
 
 	class Lzma {
 		public:
-		
+
 			static void Encode(buffer input_buffer, buffer output_buffer);
 			static void Decode(buffer input_buffer, buffer output_buffer);
+
+			// The same format as Encode writes, decoded without the gc.
+			// DecodedSize returns -1 if the data is not valid.
+			static int  DecodedSize(const unsigned char *input_data, int input_size);
+			static bool Decode(const unsigned char *input_data, int input_size, unsigned char *output_data, int output_size);
+	};
+
+	// Decodes the Encode format a piece at a time - input is fed as it arrives, and output
+	//  read as it is wanted, so neither has to be held whole.  Only the dictionary, and the
+	//  input not yet decoded, are kept.
+	class LzmaDecoder : public Object {
+		public:
+			LzmaDecoder();
+
+			void Feed(const unsigned char *input_data, int input_size);
+			// Returns the number of bytes decoded, 0 if more input is needed or all the
+			//  output has been read, or -1 if the data is not valid
+			int  Read(unsigned char *output_data, int output_size);
+
+			bool IsFinished() const { return mTotalSize>=0 && mDecodedSize==mTotalSize; }
+			// The decoded size from the header, or -1 until it has been fed
+			int  GetTotalSize() const { return mTotalSize; }
+			int  GetDecodedSize() const { return mDecodedSize; }
+
+		protected:
+			~LzmaDecoder();
+			bool ReadHeader();
+
+			struct State;
+			State *mState;
+			QuickVec<unsigned char> mInput;
+			int  mInputPos;
+			int  mTotalSize;
+			int  mDecodedSize;
+			bool mError;
 	};
-	
+
+	// Encodes or decodes a whole buffer on the worker pool.  The progress can be read
+	//  while it runs, and the result taken once it is done.  With no worker threads, the
+	//  work happens straight away.
+	class LzmaTask : public Object, public WorkerTask {
+		public:
+			static LzmaTask *Create(bool encode, const unsigned char *input_data, int input_size);
+
+			bool   IsDone();
+			// From 0 to 1
+			double GetProgress() const { return mProgress; }
+			// Waits if the task is not done, returning false if the data was not valid
+			bool   GetResult(const unsigned char *&output_data, int &output_size);
+
+			void   RunTask(int index);
+
+		protected:
+			LzmaTask(bool encode);
+			~LzmaTask();
+
+			bool                    mEncode;
+			bool                    mOk;
+			volatile float          mProgress;
+			QuickVec<unsigned char> mInput;
+			QuickVec<unsigned char> mOutput;
+	};
+
 }
 
-#endif
\ No newline at end of file
+#endif
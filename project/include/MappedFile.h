@@ -0,0 +1,53 @@
+#ifndef NME_MAPPED_FILE_H
+#define NME_MAPPED_FILE_H
+
+#include <nme/Object.h>
+#include "Utils.h"
+#include <stddef.h>
+
+namespace nme
+{
+
+// A read-only view of a whole file.  The file is mapped into memory where the system
+//  allows it, and read into a heap buffer where it does not, so decoders can work on the
+//  bytes in place, and a stream can keep them for as long as it holds a reference.
+// Reference counts are not atomic, so a file should only be held on one thread at a time.
+class MappedFile : public Object
+{
+public:
+   // These return an object with one reference, or 0.  Open finds entries of the
+   //  mounted asset packs before files.
+   static MappedFile *Open(const OSChar *inFilename);
+   #ifdef HX_WINDOWS
+   static MappedFile *Open(const char *inUtf8Filename);
+   #endif
+   // Copies the bytes - for data that comes from the gc or through java
+   static MappedFile *FromBytes(const unsigned char *inBytes, int inLen);
+   // Shares bytes that outlive the object, such as an entry of a mounted pack
+   static MappedFile *View(const unsigned char *inBytes, int inLen);
+   // Uninitialised bytes, to be filled in through Edit
+   static MappedFile *Alloc(int inLen);
+
+   unsigned char *Edit() { return mHeap; }
+
+   const unsigned char *Bytes() const { return mData; }
+   int  Size() const { return mSize; }
+   bool IsMapped() const { return mMapBase!=0; }
+
+private:
+   MappedFile();
+   ~MappedFile();
+
+   static MappedFile *ReadAll(FILE *inFile);
+   bool MapRange(int inFd, long long inOffset, long long inLength);
+
+   const unsigned char *mData;
+   int                 mSize;
+   unsigned char       *mHeap;
+   void                *mMapBase;
+   size_t              mMapLength;
+};
+
+} // end namespace nme
+
+#endif
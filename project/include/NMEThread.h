@@ -44,6 +44,44 @@ struct NmeAutoMutex
 };
 
 
+// --- Worker pool -----------------------------------------------------
+//
+// A small pool of native threads used to split CPU-heavy work (eg, software
+//  rendering) into independent pieces.  Tasks must not touch the haxe GC.
+
+class WorkerTask
+{
+public:
+   WorkerTask() : mQueueState(0), mNextQueued(0) { }
+   virtual ~WorkerTask() { }
+   // Called once for each index in 0...inCount-1, possibly concurrently
+   virtual void RunTask(int inIndex) = 0;
+
+   // Used by QueueWorkerTask
+   int        mQueueState;
+   WorkerTask *mNextQueued;
+};
+
+// Number of extra threads available - 0 means everything runs on the calling thread
+int  GetWorkerThreads();
+void SetWorkerThreads(int inThreads);
+
+// Runs the task for each index using the pool and the calling thread, returning when all are complete.
+// If the pool is disabled or busy, the task is run serially on the calling thread.
+void RunWorkerTask(WorkerTask *inTask, int inCount);
+
+// Runs inTask->RunTask(0) in the background, when a worker thread is free.
+// If the pool is disabled, the task is run immediately on the calling thread.
+void QueueWorkerTask(WorkerTask *inTask);
+// True once a queued task has completed
+bool IsWorkerTaskDone(WorkerTask *inTask);
+// Blocks until a queued task has completed, running it here if it has not started yet
+void WaitWorkerTask(WorkerTask *inTask);
+// Takes a task that has not started out of the queue without running it, returning true.
+// Otherwise waits for it to complete, returning false.
+bool CancelWorkerTask(WorkerTask *inTask);
+
+
 }
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef NME_PIXEL_POOL_H
+#define NME_PIXEL_POOL_H
+
+namespace nme
+{
+
+// --- Pixel pool ---------------------------------------------------------
+//
+// Pixel memory for short-lived surfaces - filter passes, drop shadows and bitmap caches -
+//  which are rebuilt over and over while an object animates.
+// Freed buffers are kept in power-of-two sized buckets for reuse, up to the budget, and
+//  buffers that have not been reused for a while are trimmed away between frames.
+
+// Returns a buffer of at least inBytes
+unsigned char *PixelPoolAlloc(int inBytes);
+// inBytes must match the value given to PixelPoolAlloc
+void PixelPoolFree(unsigned char *inBuffer, int inBytes);
+
+// Called once a frame, to free the buffers that are no longer being reused
+void PixelPoolTrim();
+// Free everything not in use
+void PixelPoolClear();
+
+void PixelPoolSetBudget(int inBytes);
+int  PixelPoolGetBudget();
+// Bytes kept in the pool, not counting those in use
+int  PixelPoolHeldBytes();
+
+} // end namespace nme
+
+#endif
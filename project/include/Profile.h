@@ -0,0 +1,83 @@
+#ifndef NME_PROFILE_H
+#define NME_PROFILE_H
+
+namespace nme
+{
+
+// --- Frame profiler -----------------------------------------------------
+//
+// Zones are timed with NME_PROFILE_ZONE("name"), which must be given a string literal,
+//  and events are counted with ProfileCount.  Only the main thread is recorded, and
+//  nothing at all is done until profiling is enabled.
+// The totals for the last complete frame can be queried, and with tracing on, the zones
+//  are also kept as events that can be saved in the chrome://tracing JSON format.
+
+enum ProfileCounter
+{
+   pcDrawCalls,
+   pcVertices,
+   pcTextureBytes,
+   pcTessellations,
+   pcBitmapCacheBuilds,
+   pcFilters,
+   pcSkippedStateCalls,
+
+   pcSIZE,
+};
+
+extern bool gProfileEnabled;
+
+void SetProfiling(bool inEnable, bool inTrace);
+
+void ProfileBeginFrame();
+void ProfileEndFrame();
+
+// Returns false if the zone is not recorded, in which case ProfileEndZone should not be called
+bool ProfileBeginZone(const char *inName);
+void ProfileEndZone();
+void ProfileAddCount(ProfileCounter inCounter, int inAmount);
+
+inline void ProfileCount(ProfileCounter inCounter, int inAmount=1)
+{
+   if (gProfileEnabled)
+      ProfileAddCount(inCounter,inAmount);
+}
+
+class ProfileZone
+{
+public:
+   ProfileZone(const char *inName) : mActive(gProfileEnabled && ProfileBeginZone(inName)) { }
+   ~ProfileZone()
+   {
+      if (mActive)
+         ProfileEndZone();
+   }
+
+private:
+   bool mActive;
+};
+
+#define NME_PROFILE_ZONE(name) nme::ProfileZone nmeProfileZone(name)
+
+
+struct ProfileZoneStats
+{
+   const char *name;
+   double     seconds;
+   int        calls;
+};
+
+const char *ProfileCounterName(ProfileCounter inCounter);
+
+// Stats for the last complete frame
+double ProfileFrameSeconds();
+int    ProfileFrameCount(ProfileCounter inCounter);
+int    ProfileZoneCount();
+const  ProfileZoneStats &ProfileGetZone(int inIndex);
+
+// Writes the recorded trace events, and clears them
+bool   ProfileSaveTrace(const char *inFilename);
+
+} // end namespace nme
+
+#endif
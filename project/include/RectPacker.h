@@ -0,0 +1,56 @@
+#ifndef NME_RECT_PACKER_H
+#define NME_RECT_PACKER_H
+
+#include <nme/Rect.h>
+#include <nme/QuickVec.h>
+
+namespace nme
+{
+
+// Packs rectangles into a fixed sized area, using the "skyline bottom-left" method.
+// Gaps left under the skyline, and freed rects, are kept in a free list and reused first.
+class RectPacker
+{
+public:
+   RectPacker(int inWidth=0,int inHeight=0);
+
+   void Reset();
+   void Reset(int inWidth,int inHeight);
+
+   // Returns false if there is no room
+   bool Alloc(int inW,int inH,Rect &outRect);
+   // Give back a rect from Alloc
+   void Free(const Rect &inRect);
+
+   int  Width() const { return mWidth; }
+   int  Height() const { return mHeight; }
+
+   // Stats
+   int    Allocated() const { return mAllocated; }
+   int    UsedArea() const { return mUsedArea; }
+   double Occupancy() const { return mWidth*mHeight>0 ? (double)mUsedArea/(mWidth*mHeight) : 0.0; }
+
+private:
+   struct Span
+   {
+      int x;
+      int y;
+      int w;
+   };
+
+   int  FitAt(int inSpan,int inW,int inH) const;
+   bool AllocFree(int inW,int inH,Rect &outRect);
+   void AddFree(const Rect &inRect);
+
+   int  mWidth;
+   int  mHeight;
+   int  mAllocated;
+   int  mUsedArea;
+
+   QuickVec<Span> mSkyline;
+   QuickVec<Rect> mFree;
+};
+
+} // end namespace nme
+
+#endif
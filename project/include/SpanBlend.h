@@ -0,0 +1,33 @@
+#ifndef NME_SPAN_BLEND_H
+#define NME_SPAN_BLEND_H
+
+#include <Graphics.h>
+#include <nme/Pixel.h>
+
+namespace nme
+{
+
+// Vectorised blending of whole spans onto an opaque (no alpha) destination.
+// These produce the same results as the per-pixel code in Surface.cpp and Render.h, and are
+//  chosen at startup based on the cpu features.  A null function means use the per-pixel code.
+
+// Blend inSrc onto ioDest, using the given blend mode
+typedef void (*SpanBlendFunc)(ARGB *ioDest, const ARGB *inSrc, int inCount);
+
+// Normal-blend a single colour onto ioDest
+typedef void (*SpanSolidFunc)(ARGB *ioDest, ARGB inColour, int inCount);
+
+// Normal-blend inTint, with alpha scaled by the alpha-only source
+typedef void (*SpanTintFunc)(ARGB *ioDest, const uint8 *inAlpha, ARGB inTint, int inCount);
+
+// Called on the main thread before the worker threads start, so the bands never choose
+//  the functions at the same time.  The getters call it if needed.
+void InitSpanBlend();
+
+SpanBlendFunc GetSpanBlend(BlendMode inMode);
+SpanSolidFunc GetSpanSolid();
+SpanTintFunc  GetSpanTint();
+
+} // end namespace nme
+
+#endif
@@ -20,6 +20,11 @@ void HintColourOrder(bool inRedFirst);
 
 extern int gTextureContextVersion;
 
+// Pack small surfaces into shared texture pages
+extern bool gUseTextureAtlas;
+// Bumped when a live surface leaves the atlas, which makes tex-coords pointing into it stale
+extern int gTextureAtlasVersion;
+
 
 
 
@@ -67,6 +72,8 @@ public:
                             int inSrcChannel, int inDestChannel ) const = 0;
 
    Texture *GetTexture(HardwareContext *inHardware,int inPlane=0);
+   // A texture covering only this surface, for repeating or direct use
+   Texture *GetOwnTexture(HardwareContext *inHardware);
 
    virtual HardwareRenderer *GetHardwareRenderer() { return 0; }
 
@@ -118,7 +125,14 @@ public:
 class SimpleSurface : public Surface
 {
 public:
-   SimpleSurface(int inWidth,int inHeight,PixelFormat inPixelFormat,int inByteAlign=4,int inGPUPixelFormat=-1);
+   SimpleSurface(int inWidth,int inHeight,PixelFormat inPixelFormat,int inByteAlign=4,int inGPUPixelFormat=-1,
+                 bool inPooled=false);
+
+   // With the pixels from the pixel pool, for surfaces that are made and thrown away often
+   static SimpleSurface *CreatePooled(int inWidth,int inHeight,PixelFormat inPixelFormat)
+   {
+      return new SimpleSurface(inWidth,inHeight,inPixelFormat,4,-1,true);
+   }
 
    PixelFormat Format() const  { return mPixelFormat; }
 
@@ -150,6 +164,7 @@ public:
 
    virtual void colorTransform(const Rect &inRect, ColorTransform &inTransform);
    virtual void setGPUFormat( PixelFormat pf ) { mGPUPixelFormat = pf; }
+   void multiplyAlpha();
    void unmultiplyAlpha();
    
    Surface *clone();
@@ -175,7 +190,9 @@ protected:
    int           mGPUPixelFormat;
    int           mStride;
    uint8         *mBase;
+   bool          mPooled;
    ~SimpleSurface();
+   void FreeBase();
 
 private:
    SimpleSurface(const SimpleSurface &inRHS);
@@ -0,0 +1,49 @@
+#ifndef NME_SURFACE_LOADER_H
+#define NME_SURFACE_LOADER_H
+
+#include <Surface.h>
+#include <NMEThread.h>
+
+namespace nme
+{
+
+// --- Surface loader -----------------------------------------------------
+//
+// Decodes an image file, or a copy of encoded bytes, on the worker pool so many images
+//  can load at once without holding up the frame.  Poll IsDone on the main thread and
+//  then take the result.  With no worker threads, the decode happens straight away.
+
+enum
+{
+   // Premultiply the pixels while decoding, so the texture upload does not have to.
+   // getPixel and the software renderer will see premultiplied colours.
+   loadPremultiply = 0x0001,
+};
+
+class SurfaceLoader : public Object, public WorkerTask
+{
+public:
+   // inFormat is as for nme_bitmap_data_load: 0 = 8888, 1 = 4444, 2 = 565 on the gpu
+   static SurfaceLoader *Create(const OSChar *inFilename, int inFormat, int inFlags);
+   static SurfaceLoader *Create(const uint8 *inBytes, int inLen, int inFormat, int inFlags);
+
+   bool IsDone();
+   // Waits if the decode is not done, returning the surface, without a new reference, or 0
+   Surface *GetResult();
+
+   void RunTask(int inIndex);
+
+protected:
+   SurfaceLoader(int inFormat, int inFlags);
+   ~SurfaceLoader();
+
+   QuickVec<OSChar> mFilename;
+   QuickVec<uint8>  mBytes;
+   int              mFormat;
+   int              mFlags;
+   Surface          *mResult;
+};
+
+} // end namespace nme
+
+#endif
@@ -149,7 +149,8 @@ public:
    double  textHeight;
    DRect   mActiveRect;
 
-   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke);
+   void GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke,
+                  bool inForHitTest=false);
    Cursor GetCursor();
    bool WantsFocus() { return isInput && mouseEnabled; }
    bool CaptureDown(Event &inEvent);
@@ -3,6 +3,7 @@
 
 #include <Graphics.h>
 #include <nme/Object.h>
+#include <RectPacker.h>
 
 namespace nme
 {
@@ -30,14 +31,13 @@ public:
    Surface &GetSurface() { return *mSheet; }
    int Tiles() const { return mTiles.size(); }
    bool IsSingleTileImage();
+   // Fraction of the sheet given out by AllocRect
+   double Occupancy() const { return mPacker.Occupancy(); }
 
 private:
    ~Tilesheet();
 
-   int  mCurrentX;
-   int  mCurrentY;
-   int  mMaxHeight;
-
+   RectPacker     mPacker;
    QuickVec<Tile> mTiles;
    Surface        *mSheet;
 };
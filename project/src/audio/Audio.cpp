@@ -1,6 +1,7 @@
 #include "Audio.h"
 
 #include <ByteArray.h>
+#include <MappedFile.h>
 #include <cstdio>
 #include <iostream>
 #include <vorbis/vorbisfile.h>
@@ -512,12 +513,16 @@ public:
    int    channelSampleCount;
    QuickVec<short> decodedBuffer;
    QuickVec<unsigned char> sourceBuffer;
+   MappedFile *sourceFile;
+   bool   sourceKept;
    AudioFormat fileFormat;
 
-   NmeSoundData(const unsigned char *inData, int inDataLength, unsigned int inFlags)
+   NmeSoundData(const unsigned char *inData, int inDataLength, unsigned int inFlags, MappedFile *inSource=0)
    {
       refCount = 1;
       flags = inFlags;
+      sourceFile = inSource ? (MappedFile *)inSource->IncRef() : 0;
+      sourceKept = false;
       init(0,true);
 
       fileFormat = determineFormatFromBytes(inData, inDataLength);
@@ -540,10 +545,18 @@ public:
          default:
             ;
       }
+
+      if (sourceFile && !sourceKept)
+      {
+         sourceFile->DecRef();
+         sourceFile = 0;
+      }
    }
 
    NmeSoundData(const short *inData, int inChannelSamples, bool inIsStereo, int inRate)
    {
+      sourceFile = 0;
+      sourceKept = false;
       init(inChannelSamples, inIsStereo, inRate);
       int shorts = channelSampleCount * (isStereo?2:1);
       decodedBuffer.Set(inData,shorts);
@@ -559,12 +572,37 @@ public:
       duration = rate>0 ? (double)channelSampleCount/rate : 0;
    }
 
+   ~NmeSoundData()
+   {
+      if (sourceFile)
+         sourceFile->DecRef();
+   }
+
    INmeSoundData  *addRef()
    {
       refCount++;
       return this;
    }
 
+   // Streams decode from the source as they play - a mapped file is shared rather than copied
+   void keepSource(const unsigned char *inData, int inDataLength)
+   {
+      if (sourceFile && sourceFile->Bytes()==inData && sourceFile->Size()==inDataLength)
+         sourceKept = true;
+      else
+         sourceBuffer.Set(inData,inDataLength);
+   }
+
+   const unsigned char *sourceData()
+   {
+      return sourceKept ? sourceFile->Bytes() : sourceBuffer.ByteData();
+   }
+
+   int sourceSize() const
+   {
+      return sourceKept ? sourceFile->Size() : sourceBuffer.ByteCount();
+   }
+
    void release()
    {
       refCount--;
@@ -668,7 +706,7 @@ public:
             }
             else
             {
-               sourceBuffer.Set(inData,inDataLength);
+               keepSource(inData,inDataLength);
             }
          }
          ModPlug_Unload(modFile);
@@ -721,7 +759,7 @@ public:
                   }
                   else
                   {
-                     sourceBuffer.Set(inData,inDataLength);
+                     keepSource(inData,inDataLength);
                   }
                }
             }
@@ -744,8 +782,8 @@ public:
 
    short *decodeAll()
    {
-      if (!isDecoded && sourceBuffer.size())
-         parseOgg(sourceBuffer.ByteData(), sourceBuffer.ByteCount(), SoundForceDecode);
+      if (!isDecoded && sourceSize())
+         parseOgg(sourceData(), sourceSize(), SoundForceDecode);
 
       if (!isDecoded || !channelSampleCount)
          return 0;
@@ -768,11 +806,11 @@ public:
       }
 
       if (fileFormat==eAF_ogg)
-         return new NmeSoundStreamOgg(this, sourceBuffer.ByteData(), sourceBuffer.ByteCount());
+         return new NmeSoundStreamOgg(this, sourceData(), sourceSize());
 
       #ifdef NME_MODPLUG
       if (fileFormat==eAF_mid)
-         return new NmeSoundStreamMid(this, sourceBuffer.ByteData(), sourceBuffer.ByteCount());
+         return new NmeSoundStreamMid(this, sourceData(), sourceSize());
       #endif
 
       LOG_SOUND("Error creating stream - unknown format");
@@ -785,9 +823,19 @@ public:
 
 INmeSoundData *INmeSoundData::create(const std::string &inId, unsigned int inFlags)
 {
-   ByteArray bytes = ByteArray::FromFile(inId.c_str());
-   if (!bytes.Ok())
-      bytes = ByteArray(inId.c_str());
+   MappedFile *file = MappedFile::Open(inId.c_str());
+   if (file)
+   {
+      INmeSoundData *result = 0;
+      if (file->Size())
+         result = create(file,inFlags);
+      else
+         LOG_SOUND("Sound resource is invalid %s", inId.c_str());
+      file->DecRef();
+      return result;
+   }
+
+   ByteArray bytes(inId.c_str());
    if (!bytes.Ok())
    {
       LOG_SOUND("Could not create sound resource %s", inId.c_str());
@@ -806,9 +854,14 @@ INmeSoundData *INmeSoundData::create(const std::string &inId, unsigned int inFla
    return create(data,length,inFlags);
 }
 
-INmeSoundData *INmeSoundData::create(const unsigned char *inData, int inDataLength, unsigned int inFlags)
+INmeSoundData *INmeSoundData::create(MappedFile *inFile, unsigned int inFlags)
+{
+   return create(inFile->Bytes(), inFile->Size(), inFlags, inFile);
+}
+
+INmeSoundData *INmeSoundData::create(const unsigned char *inData, int inDataLength, unsigned int inFlags, MappedFile *inSource)
 {
-   INmeSoundData *result = new NmeSoundData(inData, inDataLength, inFlags);
+   INmeSoundData *result = new NmeSoundData(inData, inDataLength, inFlags, inSource);
    if (result->getChannelSampleCount()==0)
    {
       result->release();
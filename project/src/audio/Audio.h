@@ -29,6 +29,8 @@
 namespace nme
 {
 
+class MappedFile;
+
 Sound *CreateAndroidSound(const unsigned char *inData, int len, bool inForceMusic);
 Sound *CreateAndroidSound(const std::string &inFilename,bool inForceMusic);
 
@@ -89,7 +91,10 @@ class INmeSoundData
 public:
    static INmeSoundData *create(const std::string &inId, unsigned int inFlags=0x0000);
    static INmeSoundData *createAvDecoded(const std::string &inId);
-   static INmeSoundData *create(const unsigned char *inData, int inDataLength, unsigned int inFlags=0x0000);
+   // The source may be given to share a mapped file with streams, instead of copying the data
+   static INmeSoundData *create(const unsigned char *inData, int inDataLength, unsigned int inFlags=0x0000,
+                                MappedFile *inSource=0);
+   static INmeSoundData *create(MappedFile *inFile, unsigned int inFlags=0x0000);
    static INmeSoundData *createAcm(const unsigned char *inData, int inDataLength, unsigned int inFlags=0x0000);
    static INmeSoundData *create(const short *inData, int inChannelSamples, bool inIsStereo, int inRate);
 
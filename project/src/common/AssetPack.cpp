@@ -0,0 +1,199 @@
+#include <AssetPack.h>
+#include <MappedFile.h>
+#include <NMEThread.h>
+#include <Lzma.h>
+#include <nme/QuickVec.h>
+#include <string.h>
+
+namespace nme
+{
+
+enum
+{
+   HEADER_SIZE = 32,
+   ENTRY_SIZE  = 32,
+   PACK_VERSION = 1,
+};
+
+struct MountedPack
+{
+   MappedFile          *file;
+   const unsigned char *index;
+   const unsigned char *names;
+   int                 count;
+};
+
+// Lookups may come from the worker threads
+static NmeMutex sgPackMutex;
+static QuickVec<MountedPack> sgPacks;
+
+
+static inline unsigned int ReadU32(const unsigned char *inPtr)
+{
+   return inPtr[0] | (inPtr[1]<<8) | (inPtr[2]<<16) | ((unsigned int)inPtr[3]<<24);
+}
+
+unsigned int AssetPack::Hash(const char *inName, int inLength)
+{
+   unsigned int hash = 2166136261u;
+   for(int i=0;i<inLength;i++)
+   {
+      hash ^= (unsigned char)inName[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+
+bool AssetPack::Mount(const OSChar *inFilename)
+{
+   MappedFile *file = MappedFile::Open(inFilename);
+   if (!file)
+      return false;
+
+   const unsigned char *data = file->Bytes();
+   unsigned int size = file->Size();
+   bool ok = size>=HEADER_SIZE && !memcmp(data,"NMEP",4) && ReadU32(data+4)==PACK_VERSION;
+
+   MountedPack pack;
+   if (ok)
+   {
+      unsigned int count = ReadU32(data+8);
+      unsigned int indexOffset = ReadU32(data+12);
+      unsigned int namesOffset = ReadU32(data+16);
+      unsigned int namesSize = ReadU32(data+20);
+
+      ok = indexOffset<=size && count<=(size-indexOffset)/ENTRY_SIZE &&
+           namesOffset<=size && namesSize<=size-namesOffset;
+
+      pack.file = file;
+      pack.index = data + indexOffset;
+      pack.names = data + namesOffset;
+      pack.count = count;
+
+      // Check every entry once, so lookups can trust the offsets
+      for(int i=0;ok && i<pack.count;i++)
+      {
+         const unsigned char *entry = pack.index + i*ENTRY_SIZE;
+         unsigned int nameOffset = ReadU32(entry+8);
+         unsigned int nameLength = ReadU32(entry+12);
+         unsigned int dataOffset = ReadU32(entry+16);
+         unsigned int stored = ReadU32(entry+20);
+         unsigned int length = ReadU32(entry+24);
+         bool lzma = ReadU32(entry+4) & entryLzma;
+
+         ok = nameOffset<=namesSize && nameLength<=namesSize-nameOffset &&
+              dataOffset<=size && stored<=size-dataOffset &&
+              length<=0x7fffffff && (lzma || stored==length) &&
+              (i==0 || ReadU32(entry-ENTRY_SIZE)<=ReadU32(entry));
+      }
+   }
+
+   if (!ok)
+   {
+      ELOG("Invalid asset pack");
+      file->DecRef();
+      return false;
+   }
+
+   NmeAutoMutex lock(sgPackMutex);
+   sgPacks.push_back(pack);
+   return true;
+}
+
+
+// Called with the lock held
+static const unsigned char *FindEntry(const char *inName, const MountedPack **outPack)
+{
+   while(inName[0]=='.' && inName[1]=='/')
+      inName+=2;
+
+   int len = strlen(inName);
+   unsigned int hash = AssetPack::Hash(inName,len);
+
+   for(int p=(int)sgPacks.size()-1;p>=0;p--)
+   {
+      const MountedPack &pack = sgPacks[p];
+
+      int lo = 0;
+      int hi = pack.count;
+      while(lo<hi)
+      {
+         int mid = (lo+hi)>>1;
+         if (ReadU32(pack.index + mid*ENTRY_SIZE) < hash)
+            lo = mid+1;
+         else
+            hi = mid;
+      }
+
+      for(int i=lo;i<pack.count;i++)
+      {
+         const unsigned char *entry = pack.index + i*ENTRY_SIZE;
+         if (ReadU32(entry)!=hash)
+            break;
+         if ((int)ReadU32(entry+12)==len && !memcmp(pack.names+ReadU32(entry+8),inName,len))
+         {
+            *outPack = &pack;
+            return entry;
+         }
+      }
+   }
+   return 0;
+}
+
+
+MappedFile *AssetPack::Open(const char *inName)
+{
+   const unsigned char *data = 0;
+   unsigned int flags = 0;
+   int stored = 0;
+   int length = 0;
+   {
+      NmeAutoMutex lock(sgPackMutex);
+      if (!sgPacks.size())
+         return 0;
+      const MountedPack *pack = 0;
+      const unsigned char *entry = FindEntry(inName,&pack);
+      if (!entry)
+         return 0;
+      flags = ReadU32(entry+4);
+      data = pack->file->Bytes() + ReadU32(entry+16);
+      stored = ReadU32(entry+20);
+      length = ReadU32(entry+24);
+   }
+
+   if (!(flags & entryLzma))
+      return MappedFile::View(data,length);
+
+   MappedFile *result = MappedFile::Alloc(length);
+   if (result && length && !Lzma::Decode(data,stored,result->Edit(),length))
+   {
+      ELOG("Could not decompress packed asset %s", inName);
+      result->DecRef();
+      result = 0;
+   }
+   return result;
+}
+
+#ifdef HX_WINDOWS
+MappedFile *AssetPack::Open(const wchar_t *inName)
+{
+   {
+      NmeAutoMutex lock(sgPackMutex);
+      if (!sgPacks.size())
+         return 0;
+   }
+   return Open( WideToUTF8(inName).c_str() );
+}
+#endif
+
+bool AssetPack::Contains(const char *inName)
+{
+   NmeAutoMutex lock(sgPackMutex);
+   if (!sgPacks.size())
+      return false;
+   const MountedPack *pack = 0;
+   return FindEntry(inName,&pack)!=0;
+}
+
+} // end namespace nme
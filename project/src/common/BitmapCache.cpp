@@ -26,6 +26,7 @@ BitmapCache::BitmapCache(Surface *inSurface,const Transform &inTrans,
    mMaskVersion = inMask ? inMask->mVersion : 0;
    mMaskOffset = inMask ? ImagePoint(inMask->mTX,inMask->mTY) : ImagePoint(0,0);
    mTX = mTY = 0;
+   mContextVersion = gTextureContextVersion;
 }
 
 BitmapCache::~BitmapCache()
@@ -39,6 +40,10 @@ bool BitmapCache::StillGood(const Transform &inTransform, const Rect &inVisibleP
    if  (!mMatrix.IsIntTranslation(*inTransform.mMatrix,mTX,mTY) || mScale9!=*inTransform.mScale9)
       return false;
 
+   // Filtered on the gpu, so the pixels went with the context
+   if (!mBitmap->GetBase() && mContextVersion!=gTextureContextVersion)
+      return false;
+
    if (inMask)
    {
       if (inMask->mVersion!=mMaskVersion)
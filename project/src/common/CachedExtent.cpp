@@ -23,9 +23,9 @@ Extent2DF CachedExtent::Get(const Transform &inTransform)
    return result;
 }
 
-// --- CachedExtentRenderer --------------------------------------
+// --- CachedExtentSet --------------------------------------
 
-bool CachedExtentRenderer::GetExtent(const Transform &inTransform,Extent2DF &ioExtent,bool inIncludeStroke)
+CachedExtent &CachedExtentSet::Find(const Transform &inTransform,bool inIncludeStroke,bool &outFound)
 {
    Matrix test = *inTransform.mMatrix;
    /*
@@ -43,18 +43,16 @@ bool CachedExtentRenderer::GetExtent(const Transform &inTransform,Extent2DF &ioE
    test.mtx = 0;
    test.mty = 0;
 
-   int smallest = mExtentCache[0].mID;
+   int smallest = mSlots[0].mID;
    int slot = 0;
    for(int i=0;i<3;i++)
    {
-      CachedExtent &cache = mExtentCache[i];
+      CachedExtent &cache = mSlots[i];
       if (cache.mIsSet && test==cache.mTestMatrix &&
             *inTransform.mScale9==cache.mScale9 && cache.mIncludeStroke==inIncludeStroke)
       {
-         // Maybe set but not valid - ie, 0 size
-         if (cache.mExtent.Valid())
-            ioExtent.Add(cache.Get(inTransform));
-         return true;
+         outFound = true;
+         return cache;
       }
       if (cache.mID<gCachedExtentID)
          cache.mID = gCachedExtentID;
@@ -67,7 +65,7 @@ bool CachedExtentRenderer::GetExtent(const Transform &inTransform,Extent2DF &ioE
    }
 
    // Not in cache - fill slot
-   CachedExtent &cache = mExtentCache[slot];
+   CachedExtent &cache = mSlots[slot];
    cache.mMatrix = *inTransform.mMatrix;
    cache.mTestMatrix = test;
    cache.mScale9 = *inTransform.mScale9;
@@ -77,11 +75,29 @@ bool CachedExtentRenderer::GetExtent(const Transform &inTransform,Extent2DF &ioE
    cache.mTransform.mScale9 = &cache.mScale9;
    cache.mIncludeStroke = inIncludeStroke;
    cache.mIsSet = true;
-   GetExtent(cache);
+   cache.mExtent = Extent2DF();
+   outFound = false;
+   return cache;
+}
 
-   cache.Get(inTransform);
+void CachedExtentSet::Clear()
+{
+   for(int i=0;i<3;i++)
+      mSlots[i] = CachedExtent();
+}
+
+// --- CachedExtentRenderer --------------------------------------
+
+bool CachedExtentRenderer::GetExtent(const Transform &inTransform,Extent2DF &ioExtent,bool inIncludeStroke)
+{
+   bool found = false;
+   CachedExtent &cache = mExtentCache.Find(inTransform,inIncludeStroke,found);
+   if (!found)
+      GetExtent(cache);
 
-   ioExtent.Add(cache.mExtent);
+   // Maybe set but not valid - ie, 0 size
+   if (cache.mExtent.Valid())
+      ioExtent.Add(cache.Get(inTransform));
 
    return true;
 }
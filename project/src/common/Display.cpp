@@ -1,5 +1,6 @@
 #include <Display.h>
 #include <Surface.h>
+#include <Profile.h>
 #include <math.h>
 
 
@@ -21,6 +22,8 @@ static int sgDisplayObjID = 0;
 
 bool gMouseShowCursor = true;
 
+unsigned int gDisplayListVersion = 0;
+
 // --- DisplayObject ------------------------------------------------
 
 DisplayObject::DisplayObject(bool inInitRef) : Object(inInitRef)
@@ -47,6 +50,8 @@ DisplayObject::DisplayObject(bool inInitRef) : Object(inInitRef)
    mMask = 0;
    mIsMaskCount = 0;
    mBitmapGfx = 0;
+   mDrawnKey = 0;
+   mDrawn = false;
    id = sgDisplayObjID++ & 0x7fffffff;
    if (id==0)
       id = sgDisplayObjID++;
@@ -142,7 +147,11 @@ UserPoint DisplayObject::LocalToGlobal(const UserPoint &inPoint)
 
 void DisplayObject::setCacheAsBitmap(bool inVal)
 {
-   cacheAsBitmap = inVal;
+   if (cacheAsBitmap!=inVal)
+   {
+      cacheAsBitmap = inVal;
+      DirtyCache();
+   }
 }
 
 
@@ -273,6 +282,7 @@ void DisplayObject::DebugRenderMask( const RenderTarget &inTarget, const RenderS
 
 void DisplayObject::DirtyCache(bool inParentOnly)
 {
+   gDisplayListVersion++;
    if (!(mDirtyFlags & dirtCache))
    {
       if (!inParentOnly)
@@ -282,6 +292,86 @@ void DisplayObject::DirtyCache(bool inParentOnly)
    }
 }
 
+// Anything that changes how an object is drawn without changing its graphics or flags
+static uint32 DamageKey(const Matrix &inMatrix,const ColorTransform &inColour)
+{
+   const double values[] = { inMatrix.m00, inMatrix.m01, inMatrix.m10, inMatrix.m11,
+                             inMatrix.mtx, inMatrix.mty,
+                             inColour.redMultiplier, inColour.redOffset,
+                             inColour.greenMultiplier, inColour.greenOffset,
+                             inColour.blueMultiplier, inColour.blueOffset,
+                             inColour.alphaMultiplier, inColour.alphaOffset };
+   const unsigned char *bytes = (const unsigned char *)values;
+   uint32 key = 2166136261u;
+   for(int i=0;i<(int)sizeof(values);i++)
+      key = (key ^ bytes[i]) * 16777619u;
+   return key;
+}
+
+void DisplayObject::UpdateDrawn(const Rect &inRect,uint32 inKey,bool inDirty,DamageRegion &ioDamage)
+{
+   // Allow for antialiasing and pixel snapping
+   Rect rect;
+   if (inRect.HasPixels())
+      rect = Rect(inRect.x-1, inRect.y-1, inRect.w+2, inRect.h+2);
+
+   if (!mDrawn || inDirty || inKey!=mDrawnKey || rect!=mDrawnRect)
+   {
+      if (mDrawn)
+         ioDamage.Add(mDrawnRect);
+      ioDamage.Add(rect);
+   }
+   mDrawnRect = rect;
+   mDrawnKey = inKey;
+   mDrawn = true;
+}
+
+// The whole object, including any children, filters, mask and scrollRect, as one rect
+void DisplayObject::CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,
+                                  DamageRegion &ioDamage)
+{
+   Matrix full = inMatrix;
+   if (scrollRect.HasPixels())
+      full.TranslateData(-scrollRect.x, -scrollRect.y);
+
+   Transform trans;
+   trans.mMatrix = &full;
+   Extent2DF extent;
+   GetExtent(trans,extent,true,true);
+
+   Rect rect;
+   if (extent.Valid())
+   {
+      rect = GetFilteredObjectRect(filters, trans.GetTargetRect(extent));
+      if (scrollRect.HasPixels())
+      {
+         Extent2DF scroll;
+         for(int c=0;c<4;c++)
+            scroll.Add( inMatrix.Apply( (c&1) ? scrollRect.w : 0, (c&2) ? scrollRect.h : 0 ) );
+         rect = rect.Intersect( trans.GetTargetRect(scroll) );
+      }
+   }
+
+   uint32 key = DamageKey(full,inColour);
+   bool dirty = IsCacheDirty();
+   if (mMask)
+   {
+      key = key*31 + DamageKey(mMask->GetFullMatrix(true),ColorTransform());
+      dirty = dirty || mMask->IsCacheDirty();
+   }
+   UpdateDrawn(rect,key,dirty,ioDamage);
+}
+
+void DisplayObject::ForgetDrawn(DamageRegion &ioDamage)
+{
+   if (mDrawn)
+   {
+      ioDamage.Add(mDrawnRect);
+      mDrawnRect = Rect();
+      mDrawn = false;
+   }
+}
+
 Matrix DisplayObject::GetFullMatrix(bool inStageScaling)
 {
    if (mParent)
@@ -341,10 +431,30 @@ Matrix &DisplayObject::GetLocalMatrix()
    return mLocalMatrix;
 }
 
-void DisplayObject::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke)
+void DisplayObject::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke,
+                              bool inForHitTest)
 {
    if (mGfx)
-      outExt.Add(mGfx->GetSoftwareExtent(inTrans,inIncludeStroke));
+      outExt.Add(mGfx->GetExtent(inTrans,inIncludeStroke));
+}
+
+bool DisplayObject::MayHit(const Transform &inTrans,const Rect &inClip)
+{
+   // Scale9 graphics are not drawn with inTrans
+   if (scale9Grid.HasPixels())
+      return true;
+
+   // The extents are cached by the renderers, and by containers for their whole subtree,
+   //  so this only visits objects whose parents' bounds contain the point.
+   Extent2DF extent;
+   GetExtent(inTrans,extent,true,true,true);
+   if (!extent.Valid())
+      return false;
+
+   // Allow for rounding in the exact tests
+   const float pad = 1.0f;
+   return inClip.x1() > extent.minX-pad && inClip.x < extent.maxX+pad &&
+          inClip.y1() > extent.minY-pad && inClip.y < extent.maxY+pad;
 }
 
 
@@ -791,7 +901,8 @@ void SimpleButton::setMouseState(int inState)
    mMouseState = inState;
 }
 
-void SimpleButton::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen, bool inIncludeStroke)
+void SimpleButton::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen, bool inIncludeStroke,
+                             bool inForHitTest)
 {
    DisplayObject::GetExtent(inTrans,outExt,inForScreen,inIncludeStroke);
 
@@ -801,7 +912,8 @@ void SimpleButton::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool in
 
    for(int i=0;i<stateSIZE;i++)
    {
-      if (i == stateHitTest) continue;
+      // The hit area is not drawn, but MayHit must include it
+      if (i == stateHitTest && !inForHitTest) continue;
       DisplayObject *obj = mState[i];
       if (!obj)
          continue;
@@ -818,7 +930,7 @@ void SimpleButton::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool in
       }
       else
          // Seems scroll rects are ignored when calculating extent...
-         obj->GetExtent(trans,outExt,inForScreen,inIncludeStroke);
+         obj->GetExtent(trans,outExt,inForScreen,inIncludeStroke,inForHitTest);
    }
 }
 
@@ -854,6 +966,13 @@ void SimpleButton::DirtyCache(bool inParentOnly)
    DisplayObject::DirtyCache(inParentOnly);
 }
 
+void SimpleButton::CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,
+                                 DamageRegion &ioDamage)
+{
+   // Only the current state is drawn
+   CollectWholeDamage(inMatrix,inColour,ioDamage);
+}
+
 
 
 
@@ -954,6 +1073,7 @@ void DisplayObjectContainer::addChild(DisplayObject *inChild)
 
 void DisplayObjectContainer::DirtyCache(bool inParentOnly)
 {
+   gDisplayListVersion++;
    if (!(mDirtyFlags & dirtCache))
       DisplayObject::DirtyCache(inParentOnly);
    if (!(mDirtyFlags & dirtExtent))
@@ -1046,7 +1166,7 @@ bool DisplayObject::CreateMask(const Rect &inClipRect,int inAA)
    int h = rect.h;
    //w = UpToPower2(w); h = UpToPower2(h);
 
-   Surface *bitmap = new SimpleSurface(w, h, pfAlpha);
+   Surface *bitmap = SimpleSurface::CreatePooled(w, h, pfAlpha);
    RenderState state(bitmap,inAA);
 
    bitmap->IncRef();
@@ -1072,6 +1192,7 @@ bool DisplayObject::CreateMask(const Rect &inClipRect,int inAA)
    }
    
    SetBitmapCache( new BitmapCache(bitmap, trans, rect, false, 0));
+   ProfileCount(pcBitmapCacheBuilds);
    bitmap->DecRef();
    return true;
 }
@@ -1094,6 +1215,7 @@ struct Leveller
 
 void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderState &inState )
 {
+   NME_PROFILE_ZONE("DisplayObjectContainer::Render");
    //Leveller level;
 
    Rect visible_bitmap;
@@ -1180,6 +1302,10 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
          }
       }
 
+      // Reject using the cached bounds, before any masks are built or exact tests done
+      if (inState.mPhase==rpHitTest && !obj->MayHit(obj_state->mTransform,obj_state->mClipRect))
+         continue;
+
       obj_state->mMask = orig_mask;
 
       DisplayObject *mask = obj->getMask();
@@ -1199,6 +1325,9 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
          //printf("Bitmap phase %d\n", obj->id);
          if (obj->IsBitmapRender(inTarget.IsHardware()) )
          {
+            if (obj_state->mQueue)
+               obj_state->mQueue->Add(rqBitmap,obj,*obj_state);
+
             obj->CheckCacheDirty(inTarget.IsHardware());
 
             Extent2DF screen_extent;
@@ -1270,7 +1399,7 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
                uint32 bg = obj->opaqueBackground;
                if (bg && filters.size())
                    bg = 0;
-               Surface *bitmap = new SimpleSurface(w, h, obj->IsBitmapRender(inTarget.IsHardware()) ?
+               Surface *bitmap = SimpleSurface::CreatePooled(w, h, obj->IsBitmapRender(inTarget.IsHardware()) ?
                          (bg ? pfXRGB : pfARGB) : pfAlpha );
                bitmap->IncRef();
 
@@ -1290,6 +1419,8 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
                ImagePoint offset = obj_state->mTargetOffset;
                Rect clip = obj_state->mClipRect;
                RenderPhase phase = obj_state->mPhase;
+               RenderQueue *queue = obj_state->mQueue;
+               obj_state->mQueue = 0;
 
                obj_state->mClipRect = Rect(render_to.w,render_to.h);
 
@@ -1313,13 +1444,25 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
                obj_state->mTargetOffset = offset;
                obj_state->mClipRect = clip;
                obj_state->mPhase = phase;
+               obj_state->mQueue = queue;
                }
 
-               bitmap = FilterBitmap(filters,bitmap,render_to,visible_bitmap,old_pow2);
+               Surface *gpu_filtered = 0;
+               if (inTarget.IsHardware() && gGPUFilters && filters.size())
+                  gpu_filtered = inTarget.mHardware->FilterBitmap(filters,bitmap,render_to,visible_bitmap,
+                                                                  ImagePoint(0,0));
+               if (gpu_filtered)
+               {
+                  bitmap->DecRef();
+                  bitmap = gpu_filtered;
+               }
+               else
+                  bitmap = FilterBitmap(filters,bitmap,render_to,visible_bitmap,old_pow2);
 
                full = orig;
                obj->SetBitmapCache(
                       new BitmapCache(bitmap, obj_state->mTransform, visible_bitmap, false, mask));
+               ProfileCount(pcBitmapCacheBuilds);
                obj_state->mRoundSizeToPOW2 = old_pow2;
                bitmap->DecRef();
             }
@@ -1333,7 +1476,16 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
             if (!obj->IsMask())
                obj->SetBitmapCache(0);
             obj_state->CombineColourTransform(inState,&obj->colorTransform,&col_trans);
-            obj->Render(inTarget,*obj_state);
+            RenderQueue *queue = obj_state->mQueue;
+            if (queue && !obj->QueuesChildren())
+            {
+               queue->Add(rqWhole,obj,*obj_state);
+               obj_state->mQueue = 0;
+               obj->Render(inTarget,*obj_state);
+               obj_state->mQueue = queue;
+            }
+            else
+               obj->Render(inTarget,*obj_state);
          }
       }
       // Not rpBitmap ...
@@ -1401,11 +1553,27 @@ void DisplayObjectContainer::Render( const RenderTarget &inTarget, const RenderS
 
    // Render parent at beginning or end...
    if (!parent_first)
+   {
+      if (inState.mPhase==rpBitmap && inState.mQueue)
+         inState.mQueue->Add(rqOwn,this,inState);
       DisplayObject::Render(inTarget,inState);
+   }
+
+}
 
+// The extent just moves with the translation, so a cached one can be reused if the rest matches.
+// This keeps the extents of a subtree valid while its ancestors move about.
+static bool SameExceptTranslation(const Matrix &inA,const Matrix &inB)
+{
+   return inA.m00==inB.m00 && inA.m01==inB.m01 && inA.m10==inB.m10 && inA.m11==inB.m11
+   #ifdef NME_S3D
+      && inA.mtz==inB.mtz
+   #endif
+      ;
 }
 
-void DisplayObjectContainer::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke)
+void DisplayObjectContainer::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForScreen,bool inIncludeStroke,
+                                       bool inForHitTest)
 {
    int smallest = mExtentCache[0].mID;
    int slot = 0;
@@ -1413,13 +1581,18 @@ void DisplayObjectContainer::GetExtent(const Transform &inTrans, Extent2DF &outE
    for(int i=0;i<3;i++)
    {
       CachedExtent &cache = mExtentCache[i];
-      if (cache.mIsSet && *inTrans.mMatrix==cache.mMatrix &&
+      if (cache.mIsSet && SameExceptTranslation(*inTrans.mMatrix,cache.mMatrix) &&
             *inTrans.mScale9==cache.mScale9 && cache.mIncludeStroke==inIncludeStroke &&
-               cache.mForScreen==inForScreen)
+               cache.mForScreen==inForScreen && cache.mForHitTest==inForHitTest)
          {
             // Maybe set but not valid - ie, 0 size
             if (cache.mExtent.Valid())
-               outExt.Add(cache.mExtent);
+            {
+               Extent2DF extent = cache.mExtent;
+               extent.Transform(1.0, 1.0, inTrans.mMatrix->mtx - cache.mMatrix.mtx,
+                                          inTrans.mMatrix->mty - cache.mMatrix.mty);
+               outExt.Add(extent);
+            }
             return;
          }
       if (cache.mID<gCachedExtentID)
@@ -1440,6 +1613,7 @@ void DisplayObjectContainer::GetExtent(const Transform &inTrans, Extent2DF &outE
    cache.mScale9 = *inTrans.mScale9;
    // todo:Matrix3d?
    cache.mForScreen = inForScreen;
+   cache.mForHitTest = inForHitTest;
    cache.mIncludeStroke = inIncludeStroke;
 
    DisplayObject::GetExtent(inTrans,cache.mExtent,inForScreen,inIncludeStroke);
@@ -1465,7 +1639,7 @@ void DisplayObjectContainer::GetExtent(const Transform &inTrans, Extent2DF &outE
       }
       else
          // Seems scroll rects are ignored when calculating extent...
-         obj->GetExtent(trans,cache.mExtent,inForScreen,inIncludeStroke);
+         obj->GetExtent(trans,cache.mExtent,inForScreen,inIncludeStroke,inForHitTest);
    }
 
    if (cache.mExtent.Valid())
@@ -1504,6 +1678,64 @@ void DisplayObjectContainer::ClearCacheDirty()
    DisplayObject::ClearCacheDirty();
 }
 
+void DisplayObjectContainer::CollectWholeDamage(const Matrix &inMatrix,const ColorTransform &inColour,
+                                                DamageRegion &ioDamage)
+{
+   for(int i=0;i<mChildren.size();i++)
+      mChildren[i]->ForgetDrawn(ioDamage);
+   DisplayObject::CollectDamage(inMatrix,inColour,ioDamage);
+}
+
+void DisplayObjectContainer::CollectDamage(const Matrix &inMatrix,const ColorTransform &inColour,
+                                           DamageRegion &ioDamage)
+{
+   // Drawn via a bitmap, or clipped, so the children are not tracked separately
+   if (IsBitmapRender(false) || mMask || scrollRect.HasPixels())
+   {
+      CollectWholeDamage(inMatrix,inColour,ioDamage);
+      return;
+   }
+
+   Rect rect;
+   if (mGfx)
+   {
+      Transform trans;
+      trans.mMatrix = &inMatrix;
+      Extent2DF extent;
+      DisplayObject::GetExtent(trans,extent,true,true);
+      if (extent.Valid())
+         rect = trans.GetTargetRect(extent);
+   }
+   // Our own flag covers scale9Grid and the like.  The children set it too, which redraws
+   //  our graphics along with them, but they are usually small or absent.
+   UpdateDrawn(rect, DamageKey(inMatrix,inColour), DisplayObject::IsCacheDirty(), ioDamage);
+
+   Matrix full;
+   ColorTransform colour;
+   for(int i=0;i<mChildren.size();i++)
+   {
+      DisplayObject *obj = mChildren[i];
+      if (!obj->visible || obj->IsMask())
+      {
+         obj->ForgetDrawn(ioDamage);
+         continue;
+      }
+      full = inMatrix.Mult( obj->GetLocalMatrix() );
+      colour.Combine(inColour,obj->colorTransform);
+      obj->CollectDamage(full,colour,ioDamage);
+   }
+}
+
+void DisplayObjectContainer::ForgetDrawn(DamageRegion &ioDamage)
+{
+   // Children are only drawn if we are
+   if (!mDrawn)
+      return;
+   DisplayObject::ForgetDrawn(ioDamage);
+   for(int i=0;i<mChildren.size();i++)
+      mChildren[i]->ForgetDrawn(ioDamage);
+}
+
 
 
 
@@ -28,6 +28,12 @@
 #include <ByteArray.h>
 #include <Lzma.h>
 #include <NMEThread.h>
+#include <SpanBlend.h>
+#include <Profile.h>
+#include <PixelPool.h>
+#include <SurfaceLoader.h>
+#include <MappedFile.h>
+#include <AssetPack.h>
 #include <StageVideo.h>
 #include <NmeBinVersion.h>
 #ifndef NME_TOOLKIT_BUILD
@@ -742,6 +748,12 @@ value nme_set_resource_factory(value inFactory)
 }
 DEFINE_PRIM(nme_set_resource_factory,1);
 
+value nme_asset_pack_mount(value inFilename)
+{
+   return alloc_bool( AssetPack::Mount(val_os_string(inFilename)) );
+}
+DEFINE_PRIM(nme_asset_pack_mount,1);
+
 
 
 ByteArray::ByteArray(int inSize)
@@ -759,6 +771,14 @@ ByteArray::ByteArray(const QuickVec<uint8> &inData)
      memcpy(bytes, &inData[0], inData.size() );
 }
 
+ByteArray::ByteArray(const unsigned char *inData, int inSize)
+{
+   mValue = val_call1(gByteArrayCreate->get(), alloc_int(inSize) );
+   uint8 *bytes = Bytes();
+   if (bytes && inSize)
+     memcpy(bytes, inData, inSize );
+}
+
 ByteArray::ByteArray(const ByteArray &inRHS) : mValue(inRHS.mValue) { }
 
 ByteArray::ByteArray(value inValue) : mValue(inValue) { }
@@ -805,6 +825,14 @@ unsigned char *ByteArray::Bytes()
 ByteArray::ByteArray(const char *inResourceName)
 {
    mValue = 0;
+   MappedFile *packed = AssetPack::Open(inResourceName);
+   if (packed)
+   {
+      mValue = ByteArray(packed->Bytes(), packed->Size()).mValue;
+      packed->DecRef();
+      return;
+   }
+
    if (gResourceFactory)
    {
       mValue = val_call1(gResourceFactory->get(),alloc_string(inResourceName));
@@ -1497,6 +1525,113 @@ value nme_set_render_gc_free(value inGcFree)
 DEFINE_PRIM(nme_set_render_gc_free,1);
 
 
+value nme_set_render_threads(value inThreads)
+{
+   InitSpanBlend();
+   SetWorkerThreads(val_int(inThreads));
+   return alloc_int(GetWorkerThreads());
+}
+
+DEFINE_PRIM(nme_set_render_threads,1);
+
+
+value nme_set_async_tessellation(value inAsync)
+{
+   gAsyncTessellation = val_bool(inAsync);
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_async_tessellation,1);
+
+
+value nme_set_texture_atlas(value inUseAtlas)
+{
+   gUseTextureAtlas = val_bool(inUseAtlas);
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_texture_atlas,1);
+
+
+value nme_set_profiling(value inEnable, value inTrace)
+{
+   SetProfiling(val_bool(inEnable), val_bool(inTrace));
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_profiling,2);
+
+
+value nme_get_profile_stats()
+{
+   value result = alloc_empty_object();
+   alloc_field(result, val_id("frameMs"), alloc_float(ProfileFrameSeconds()*1000.0) );
+   for(int c=0;c<pcSIZE;c++)
+      alloc_field(result, val_id(ProfileCounterName((ProfileCounter)c)),
+                  alloc_int(ProfileFrameCount((ProfileCounter)c)) );
+
+   int n = ProfileZoneCount();
+   value zones = alloc_array(n);
+   for(int i=0;i<n;i++)
+   {
+      const ProfileZoneStats &stats = ProfileGetZone(i);
+      value zone = alloc_empty_object();
+      alloc_field(zone, val_id("name"), alloc_string(stats.name) );
+      alloc_field(zone, val_id("ms"), alloc_float(stats.seconds*1000.0) );
+      alloc_field(zone, val_id("calls"), alloc_int(stats.calls) );
+      val_array_set_i(zones,i,zone);
+   }
+   alloc_field(result, val_id("zones"), zones);
+   return result;
+}
+
+DEFINE_PRIM(nme_get_profile_stats,0);
+
+
+value nme_save_profile_trace(value inFilename)
+{
+   return alloc_bool(ProfileSaveTrace(val_string(inFilename)));
+}
+
+DEFINE_PRIM(nme_save_profile_trace,1);
+
+
+value nme_set_dirty_rect_rendering(value inEnable)
+{
+   gDirtyRectRendering = val_bool(inEnable);
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_dirty_rect_rendering,1);
+
+
+value nme_set_render_queue(value inEnable)
+{
+   gUseRenderQueue = val_bool(inEnable);
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_render_queue,1);
+
+
+value nme_set_pixel_pool_budget(value inBytes)
+{
+   PixelPoolSetBudget(val_int(inBytes));
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_pixel_pool_budget,1);
+
+
+value nme_set_gpu_filters(value inEnable)
+{
+   gGPUFilters = val_bool(inEnable);
+   return alloc_null();
+}
+
+DEFINE_PRIM(nme_set_gpu_filters,1);
+
+
 value nme_stage_resize_window(value inStage, value inWidth, value inHeight)
 {
    #if (defined(HX_WINDOWS) || defined(HX_MACOS) || defined(HX_LINUX))
@@ -2403,6 +2538,59 @@ value nme_direct_renderer_set(value inRenderer, value inCallback)
 }
 DEFINE_PRIM(nme_direct_renderer_set,2);
 
+// --- ParticleEmitter --------------------------------------------------
+
+value nme_particle_emitter_create(value inSheet, value inMaxParticles)
+{
+   Tilesheet *sheet;
+   if (AbstractToObject(inSheet,sheet))
+      return ObjectToAbstract( new ParticleEmitter(sheet, val_int(inMaxParticles)) );
+   return alloc_null();
+}
+DEFINE_PRIM(nme_particle_emitter_create,2);
+
+value nme_particle_emitter_update(value inEmitter, value inSeconds, value inSettings)
+{
+   ParticleEmitter *emitter;
+   if (AbstractToObject(inEmitter,emitter))
+   {
+      QuickVec<float> settings;
+      FillArrayDouble(settings,inSettings);
+      if (settings.size()<psSIZE)
+         val_throw(alloc_string("Missing particle settings"));
+      emitter->Update(val_number(inSeconds), &settings[0]);
+   }
+   return alloc_null();
+}
+DEFINE_PRIM(nme_particle_emitter_update,3);
+
+value nme_particle_emitter_emit(value inEmitter, value inCount)
+{
+   ParticleEmitter *emitter;
+   if (AbstractToObject(inEmitter,emitter))
+      emitter->Emit(val_int(inCount));
+   return alloc_null();
+}
+DEFINE_PRIM(nme_particle_emitter_emit,2);
+
+value nme_particle_emitter_clear(value inEmitter)
+{
+   ParticleEmitter *emitter;
+   if (AbstractToObject(inEmitter,emitter))
+      emitter->ClearParticles();
+   return alloc_null();
+}
+DEFINE_PRIM(nme_particle_emitter_clear,1);
+
+value nme_particle_emitter_get_count(value inEmitter)
+{
+   ParticleEmitter *emitter;
+   if (AbstractToObject(inEmitter,emitter))
+      return alloc_int(emitter->GetCount());
+   return alloc_int(0);
+}
+DEFINE_PRIM(nme_particle_emitter_get_count,1);
+
 // --- SimpleButton -----------------------------------------------------
 
 value nme_simple_button_create()
@@ -2849,6 +3037,50 @@ value nme_gfx_draw_triangles(value *arg, int args )
 DEFINE_PRIM_MULT(nme_gfx_draw_triangles);
 
 
+// A buffer,start,length range of 4-byte values, read in place - or null if the buffer is null
+static const unsigned char *MemoryRange(value inBuffer, value inStart, value inLength, int &outLength)
+{
+   outLength = 0;
+   if (val_is_null(inBuffer))
+      return 0;
+
+   ByteArray bytes(inBuffer);
+   int start = val_int(inStart);
+   int len = val_int(inLength);
+   if (start<0 || len<0 || start+len>bytes.Size() || (start & 3))
+      val_throw(alloc_string("Invalid memory range"));
+
+   outLength = len;
+   return bytes.Bytes() + start;
+}
+
+value nme_gfx_draw_triangle_data(value *arg, int args )
+{
+   enum { aGfx, aVertices, aVStart, aVLength, aFormat, aIndices, aIStart, aILength, aCull, aBlend, aSIZE };
+
+   Graphics *gfx;
+   if (AbstractToObject(arg[aGfx],gfx))
+   {
+      CHECK_ACCESS("nme_gfx_draw_triangle_data");
+      int format = val_int(arg[aFormat]);
+      int stride = 2 + ((format & vfUVT) ? 3 : (format & vfUV) ? 2 : 0) + ((format & vfColour) ? 1 : 0);
+
+      int vLength = 0;
+      const float *vertices = (const float *)MemoryRange(arg[aVertices],arg[aVStart],arg[aVLength],vLength);
+      int iLength = 0;
+      const int *indices = (const int *)MemoryRange(arg[aIndices],arg[aIStart],arg[aILength],iLength);
+
+      int vertexCount = vLength/(stride*4);
+      if (vertexCount>0)
+         gfx->drawTriangleData(vertices, vertexCount, format, indices, iLength/4,
+                               val_int(arg[aCull]), val_int(arg[aBlend]) );
+   }
+
+   return alloc_null();
+}
+DEFINE_PRIM_MULT(nme_gfx_draw_triangle_data);
+
+
 value nme_gfx_draw_data(value inGfx,value inData)
 {
    Graphics *gfx;
@@ -3282,6 +3514,28 @@ value nme_gfx_draw_points(value *arg, int nargs)
 }
 DEFINE_PRIM_MULT(nme_gfx_draw_points);
 
+value nme_gfx_draw_point_data(value *arg, int nargs)
+{
+   enum { aGfx, aXYs, aXYStart, aXYLength, aRGBAs, aRGBAStart, aRGBALength, aDefaultRGBA, aPointSize, aSIZE };
+
+   Graphics *gfx;
+   if (AbstractToObject(arg[aGfx],gfx))
+   {
+      int xyLength = 0;
+      const float *xys = (const float *)MemoryRange(arg[aXYs],arg[aXYStart],arg[aXYLength],xyLength);
+      int rgbaLength = 0;
+      const int *rgbas = (const int *)MemoryRange(arg[aRGBAs],arg[aRGBAStart],arg[aRGBALength],rgbaLength);
+
+      int n = xyLength/8;
+      if (rgbaLength/4 < n)
+         rgbas = 0;
+      if (n>0)
+         gfx->drawPointData(xys, rgbas, n, val_int(arg[aDefaultRGBA]), val_number(arg[aPointSize]));
+   }
+   return alloc_null();
+}
+DEFINE_PRIM_MULT(nme_gfx_draw_point_data);
+
 
 
 
@@ -3929,6 +4183,50 @@ value nme_bitmap_data_from_bytes(value inRGBBytes, value inAlphaBytes)
 DEFINE_PRIM(nme_bitmap_data_from_bytes,2);
 
 
+// Decoded on the worker threads - poll nme_bitmap_data_load_done, then take the result
+value nme_bitmap_data_load_async(value inFilename, value inFormat, value inFlags)
+{
+   SurfaceLoader *loader = SurfaceLoader::Create(val_os_string(inFilename), val_int(inFormat),
+                                                 val_int(inFlags));
+   return ObjectToAbstract(loader);
+}
+DEFINE_PRIM(nme_bitmap_data_load_async,3);
+
+value nme_bitmap_data_from_bytes_async(value inBytes, value inFormat, value inFlags)
+{
+   ByteData bytes;
+   if (!FromValue(bytes,inBytes))
+      return alloc_null();
+
+   SurfaceLoader *loader = SurfaceLoader::Create(bytes.data, bytes.length, val_int(inFormat),
+                                                 val_int(inFlags));
+   return ObjectToAbstract(loader);
+}
+DEFINE_PRIM(nme_bitmap_data_from_bytes_async,3);
+
+value nme_bitmap_data_load_done(value inLoader)
+{
+   SurfaceLoader *loader;
+   if (AbstractToObject(inLoader,loader))
+      return alloc_bool(loader->IsDone());
+   return alloc_bool(true);
+}
+DEFINE_PRIM(nme_bitmap_data_load_done,1);
+
+value nme_bitmap_data_load_result(value inLoader)
+{
+   SurfaceLoader *loader;
+   if (AbstractToObject(inLoader,loader))
+   {
+      Surface *surface = loader->GetResult();
+      if (surface)
+         return ObjectToAbstract(surface);
+   }
+   return alloc_null();
+}
+DEFINE_PRIM(nme_bitmap_data_load_result,1);
+
+
 value nme_bitmap_data_encode(value inSurface, value inFormat,value inQuality)
 {
    Surface *surf;
@@ -5028,6 +5326,124 @@ value nme_lzma_decode(value input_value)
 }
 DEFINE_PRIM(nme_lzma_decode,1);
 
+// Streamed decoding - push the input as it arrives, and pull the output as it is wanted
+value nme_lzma_stream_create()
+{
+   return ObjectToAbstract(new LzmaDecoder());
+}
+DEFINE_PRIM(nme_lzma_stream_create,0);
+
+value nme_lzma_stream_push(value inStream, value inBytes, value inOffset, value inLength)
+{
+   LzmaDecoder *stream;
+   ByteData bytes;
+   if (AbstractToObject(inStream,stream) && FromValue(bytes,inBytes))
+   {
+      int offset = val_int(inOffset);
+      int len = val_int(inLength);
+      if (offset>=0 && offset<=bytes.length && len>0 && len<=bytes.length-offset)
+         stream->Feed(bytes.data+offset,len);
+   }
+   return alloc_null();
+}
+DEFINE_PRIM(nme_lzma_stream_push,4);
+
+// Returns as much as has been decoded, up to inMax bytes, or null if the data is not valid
+value nme_lzma_stream_pull(value inStream, value inMax)
+{
+   LzmaDecoder *stream;
+   if (!AbstractToObject(inStream,stream))
+      return alloc_null();
+
+   int max = val_int(inMax);
+   if (stream->GetTotalSize()>=0 && max>stream->GetTotalSize()-stream->GetDecodedSize())
+      max = stream->GetTotalSize()-stream->GetDecodedSize();
+   if (max<0)
+      max = 0;
+
+   ByteArray result(max);
+   int got = 0;
+   while(got<max)
+   {
+      int len = stream->Read(result.Bytes()+got, max-got);
+      if (len<0)
+         return alloc_null();
+      if (len==0)
+         break;
+      got += len;
+   }
+   if (got<max)
+      result.Resize(got);
+   return result.mValue;
+}
+DEFINE_PRIM(nme_lzma_stream_pull,2);
+
+value nme_lzma_stream_get_total(value inStream)
+{
+   LzmaDecoder *stream;
+   if (AbstractToObject(inStream,stream))
+      return alloc_int(stream->GetTotalSize());
+   return alloc_int(-1);
+}
+DEFINE_PRIM(nme_lzma_stream_get_total,1);
+
+value nme_lzma_stream_get_position(value inStream)
+{
+   LzmaDecoder *stream;
+   if (AbstractToObject(inStream,stream))
+      return alloc_int(stream->GetDecodedSize());
+   return alloc_int(0);
+}
+DEFINE_PRIM(nme_lzma_stream_get_position,1);
+
+value nme_lzma_stream_get_finished(value inStream)
+{
+   LzmaDecoder *stream;
+   if (AbstractToObject(inStream,stream))
+      return alloc_bool(stream->IsFinished());
+   return alloc_bool(true);
+}
+DEFINE_PRIM(nme_lzma_stream_get_finished,1);
+
+// Whole buffers on the worker threads - poll nme_lzma_task_done, then take the result
+value nme_lzma_task_create(value inBytes, value inEncode)
+{
+   ByteData bytes;
+   if (!FromValue(bytes,inBytes))
+      return alloc_null();
+   return ObjectToAbstract(LzmaTask::Create(val_bool(inEncode), bytes.data, bytes.length));
+}
+DEFINE_PRIM(nme_lzma_task_create,2);
+
+value nme_lzma_task_done(value inTask)
+{
+   LzmaTask *task;
+   if (AbstractToObject(inTask,task))
+      return alloc_bool(task->IsDone());
+   return alloc_bool(true);
+}
+DEFINE_PRIM(nme_lzma_task_done,1);
+
+value nme_lzma_task_progress(value inTask)
+{
+   LzmaTask *task;
+   if (AbstractToObject(inTask,task))
+      return alloc_float(task->GetProgress());
+   return alloc_float(1.0);
+}
+DEFINE_PRIM(nme_lzma_task_progress,1);
+
+value nme_lzma_task_result(value inTask)
+{
+   LzmaTask *task;
+   const unsigned char *data = 0;
+   int len = 0;
+   if (!AbstractToObject(inTask,task) || !task->GetResult(data,len))
+      return alloc_null();
+   return ByteArray(data,len).mValue;
+}
+DEFINE_PRIM(nme_lzma_task_result,1);
+
 
 value nme_file_dialog_folder(value in_title, value in_text )
 { 
@@ -1,11 +1,16 @@
 #include <Graphics.h>
 #include <Display.h>
 #include <Surface.h>
+#include <Profile.h>
+#include <NMEThread.h>
+#include <PixelPool.h>
 #include <nme/Pixel.h>
 
 namespace nme
 {
 
+bool gGPUFilters = true;
+
 
 Surface *ExtractAlpha(const Surface *inSurface)
 {
@@ -14,7 +19,7 @@ Surface *ExtractAlpha(const Surface *inSurface)
 
    int w =  inSurface->Width();
    int h = inSurface->Height();
-   Surface *result = new SimpleSurface(w,h,pfAlpha);
+   Surface *result = SimpleSurface::CreatePooled(w,h,pfAlpha);
    result->IncRef();
 
    AutoSurfaceRender render(result);
@@ -232,6 +237,183 @@ void BlurRow(const uint8 *inSrc, int inDS, int inSrcW, int inFilterLeft,
 
 
 
+/*
+  The columns are blurred a row at a time, with a running sum for each column, so memory
+   is read in order rather than striding down each column.  The window for destination
+   row y covers source rows inTop+y ... inTop+y+inFilterSize-1, clipped to the valid rows.
+  Each add/subtract loop runs along a row of separate sums, which the compiler can vectorise.
+*/
+static void BlurCols(const ARGB *inSrc, int inSrcStride, int inSrcRows, int inTop,
+                     ARGB *inDest, int inDestStride, int inDestRows, int inFilterSize, int inCols)
+{
+   QuickVec<int> sums(inCols*4);
+   sums.Zero();
+   int *sa = &sums[0];
+   int *sr = sa + inCols;
+   int *sg = sr + inCols;
+   int *sb = sg + inCols;
+
+   int end = std::min(inTop+inFilterSize, inSrcRows);
+   for(int r=std::max(inTop,0); r<end; r++)
+   {
+      const ARGB *s = inSrc + r*inSrcStride;
+      for(int x=0;x<inCols;x++)
+      {
+         int a = s[x].a;
+         sa[x] += a;
+         sr[x] += s[x].r * a;
+         sg[x] += s[x].g * a;
+         sb[x] += s[x].b * a;
+      }
+   }
+
+   for(int y=0;y<inDestRows;y++)
+   {
+      int prev = inTop + y;
+      // The rest is left as zero
+      if (prev>=inSrcRows)
+         return;
+
+      ARGB *dest = inDest + y*inDestStride;
+      for(int x=0;x<inCols;x++)
+      {
+         int a = sa[x];
+         if (a==0)
+            dest[x].ival = 0;
+         else
+         {
+            dest[x].r = sr[x]/a;
+            dest[x].g = sg[x]/a;
+            dest[x].b = sb[x]/a;
+            dest[x].a = a/inFilterSize;
+         }
+      }
+
+      int next = prev + inFilterSize;
+      if (next<inSrcRows)
+      {
+         const ARGB *s = inSrc + next*inSrcStride;
+         for(int x=0;x<inCols;x++)
+         {
+            int a = s[x].a;
+            sa[x] += a;
+            sr[x] += s[x].r * a;
+            sg[x] += s[x].g * a;
+            sb[x] += s[x].b * a;
+         }
+      }
+      if (prev>=0)
+      {
+         const ARGB *s = inSrc + prev*inSrcStride;
+         for(int x=0;x<inCols;x++)
+         {
+            int a = s[x].a;
+            sa[x] -= a;
+            sr[x] -= s[x].r * a;
+            sg[x] -= s[x].g * a;
+            sb[x] -= s[x].b * a;
+         }
+      }
+   }
+}
+
+// Alpha version
+static void BlurCols(const uint8 *inSrc, int inSrcStride, int inSrcRows, int inTop,
+                     uint8 *inDest, int inDestStride, int inDestRows, int inFilterSize, int inCols)
+{
+   QuickVec<int> sums(inCols);
+   sums.Zero();
+   int *sa = &sums[0];
+
+   int end = std::min(inTop+inFilterSize, inSrcRows);
+   for(int r=std::max(inTop,0); r<end; r++)
+   {
+      const uint8 *s = inSrc + r*inSrcStride;
+      for(int x=0;x<inCols;x++)
+         sa[x] += s[x];
+   }
+
+   for(int y=0;y<inDestRows;y++)
+   {
+      int prev = inTop + y;
+      if (prev>=inSrcRows)
+         return;
+
+      uint8 *dest = inDest + y*inDestStride;
+      for(int x=0;x<inCols;x++)
+         dest[x] = sa[x]/inFilterSize;
+
+      int next = prev + inFilterSize;
+      if (next<inSrcRows)
+      {
+         const uint8 *s = inSrc + next*inSrcStride;
+         for(int x=0;x<inCols;x++)
+            sa[x] += s[x];
+      }
+      if (prev>=0)
+      {
+         const uint8 *s = inSrc + prev*inSrcStride;
+         for(int x=0;x<inCols;x++)
+            sa[x] -= s[x];
+      }
+   }
+}
+
+
+// Below this, splitting the blur between threads is not worth it
+static const int sgMinBlurBandPixels = 128*128;
+// Column bands are kept to whole cache lines, so threads do not write to the same ones
+static const int sgBlurColAlign = 16;
+
+
+template<typename PIXEL>
+struct BlurBandTask : public WorkerTask
+{
+   void RunTask(int inBand)
+   {
+      if (mCols)
+      {
+         int x0 = BandStart(inBand, mBlurredW);
+         int x1 = BandStart(inBand+1, mBlurredW);
+         if (x1>x0)
+            BlurCols(mTmp+x0, mTmpStride, mSrcH, mSY0-mOY,
+                     (PIXEL *)mDest->Row(0) + x0, mDest->mSoftStride/sizeof(PIXEL), mBlurredH,
+                     mFilterH, x1-x0);
+      }
+      else
+      {
+         int y0 = inBand*mSrcH/mBands;
+         int y1 = (inBand+1)*mSrcH/mBands;
+         for(int y=y0;y<y1;y++)
+         {
+            const PIXEL *src = ((const PIXEL *)mSrc->Row(y)) + mSX0;
+            BlurRow(src,1,mSrcW-mSX0,mOX, mTmp+y*mTmpStride,1,mBlurredW, mFilterW, mSX0);
+         }
+      }
+   }
+
+   int BandStart(int inBand,int inWidth) const
+   {
+      if (inBand>=mBands)
+         return inWidth;
+      int x = inBand*inWidth/mBands;
+      return std::min(inWidth, (x + sgBlurColAlign-1) & ~(sgBlurColAlign-1));
+   }
+
+   const Surface      *mSrc;
+   const RenderTarget *mDest;
+   PIXEL *mTmp;
+   int   mTmpStride;
+   int   mSrcW, mSrcH;
+   int   mSX0, mSY0;
+   int   mOX, mOY;
+   int   mFilterW, mFilterH;
+   int   mBlurredW, mBlurredH;
+   int   mBands;
+   bool  mCols;
+};
+
+
 template<typename PIXEL>
 void BlurFilter::DoApply(const Surface *inSrc,Surface *outDest,ImagePoint inSrc0,ImagePoint inDiff,int inPass
       ) const
@@ -245,9 +427,8 @@ void BlurFilter::DoApply(const Surface *inSrc,Surface *outDest,ImagePoint inSrc0
 
    int blurred_w = std::min(sw+mBlurX,w);
    int blurred_h = std::min(sh+mBlurY,h);
-   // TODO: tmp height is potentially less (h+mBlurY) than sh ...
-   SimpleSurface *tmp = new SimpleSurface(blurred_w,sh,outDest->Format());
-   tmp->IncRef();
+   if (blurred_w<=0 || sh<=0)
+      return;
 
    int ox = mBlurX/2;
    int oy = mBlurY/2;
@@ -257,45 +438,44 @@ void BlurFilter::DoApply(const Surface *inSrc,Surface *outDest,ImagePoint inSrc0
       oy = mBlurY - oy;
    }
 
-   {
-   AutoSurfaceRender tmp_render(tmp);
-   const RenderTarget &target = tmp_render.Target();
-   // Blur rows ...
-   int sx0 = inSrc0.x + inDiff.x;
-   for(int y=0;y<sh;y++)
-   {
-      PIXEL *dest = (PIXEL *)target.Row(y);
-      const PIXEL *src = ((PIXEL *)inSrc->Row(y)) + sx0;
-
-      BlurRow(src,1,sw-sx0,ox, dest,1,blurred_w, mBlurX+1, sx0);
-   }
-   sw = tmp->Width();
-   }
+   // The rows are blurred into a buffer from the pixel pool
+   // TODO: tmp height is potentially less (h+mBlurY) than sh ...
+   int tmp_bytes = blurred_w*sh*sizeof(PIXEL);
+   uint8 *tmp = PixelPoolAlloc(tmp_bytes);
 
-   if (0)
-   {
-      AutoSurfaceRender dest_render(outDest);
-      const RenderTarget &target = dest_render.Target();
-      for(int y=0;y<sh;y++)
-         memcpy(target.Row(y),tmp->Row(y),sw*sizeof(PIXEL));
-   }
-   else
-   {
    AutoSurfaceRender dest_render(outDest);
-   const RenderTarget &target = dest_render.Target();
-   int s_stride = tmp->GetStride()/sizeof(PIXEL);
-   int d_stride = target.mSoftStride/sizeof(PIXEL);
+
+   BlurBandTask<PIXEL> task;
+   task.mSrc = inSrc;
+   task.mDest = &dest_render.Target();
+   task.mTmp = (PIXEL *)tmp;
+   task.mTmpStride = blurred_w;
+   task.mSrcW = sw;
+   task.mSrcH = sh;
+   task.mSX0 = inSrc0.x + inDiff.x;
+   task.mSY0 = inSrc0.y + inDiff.y;
+   task.mOX = ox;
+   task.mOY = oy;
+   task.mFilterW = mBlurX+1;
+   task.mFilterH = mBlurY+1;
+   task.mBlurredW = blurred_w;
+   task.mBlurredH = blurred_h;
+
+   int bands = 1;
+   if (GetWorkerThreads()>0 && blurred_w*sh>=sgMinBlurBandPixels)
+      bands = GetWorkerThreads()+1;
+
+   // Blur rows ...
+   task.mCols = false;
+   task.mBands = std::min(bands,sh);
+   RunWorkerTask(&task,task.mBands);
+
    // Blur cols ...
-   int sy0 = inSrc0.y + inDiff.y;
-   for(int x=0;x<blurred_w;x++)
-   {
-      PIXEL *dest = (PIXEL *)target.Row(0) + x;
-      const PIXEL *src = ((PIXEL *)tmp->Row(sy0)) + x;
+   task.mCols = true;
+   task.mBands = std::max(1,std::min(bands,blurred_w/sgBlurColAlign));
+   RunWorkerTask(&task,task.mBands);
 
-      BlurRow(src,s_stride,sh-sy0,oy, dest,d_stride,blurred_h,mBlurY+1,sy0);
-   }
-   }
-   tmp->DecRef();
+   PixelPoolFree(tmp,tmp_bytes);
 }
 
 void BlurFilter::Apply(const Surface *inSrc,Surface *outDest,ImagePoint inSrc0,ImagePoint inDiff,int inPass) const
@@ -476,7 +656,7 @@ void DropShadowFilter::Apply(const Surface *inSrc,Surface *outDest,ImagePoint in
    {
       Rect src_rect(alpha->Width(),alpha->Height());
       BlurFilter::GetFilteredObjectRect(src_rect,q);
-      Surface *blur = new SimpleSurface(src_rect.w, src_rect.h, pfAlpha);
+      Surface *blur = SimpleSurface::CreatePooled(src_rect.w, src_rect.h, pfAlpha);
       blur->IncRef();
 
       ImagePoint diff(src_rect.x, src_rect.y);
@@ -669,7 +849,9 @@ Surface *FilterBitmap( const FilterList &inFilters, Surface *inBitmap,
                        const Rect &inSrcRect, const Rect &inDestRect, bool inMakePOW2,
                        ImagePoint inSrc0)
 {
+   NME_PROFILE_ZONE("FilterBitmap");
    int n = inFilters.size();
+   ProfileCount(pcFilters,n);
    if (n==0)
       return inBitmap;
 
@@ -702,7 +884,7 @@ Surface *FilterBitmap( const FilterList &inFilters, Surface *inBitmap,
             f->GetFilteredObjectRect(dest_rect, q);
          }
 
-         Surface *filtered = new SimpleSurface(dest_rect.w,dest_rect.h,bmp->Format());
+         Surface *filtered = SimpleSurface::CreatePooled(dest_rect.w,dest_rect.h,bmp->Format());
          filtered->IncRef();
 
          if (do_clear)
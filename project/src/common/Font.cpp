@@ -1,6 +1,8 @@
 #include <Font.h>
 #include <Utils.h>
 #include <Surface.h>
+#include <MappedFile.h>
+#include <ByteArray.h>
 #include <map>
 
 #if defined(HX_WINDOWS) || defined(HX_MACOS) || defined(HX_LINUX)
@@ -149,7 +151,6 @@ FontFace *FontFace::CreateCFFIFont(const TextFormat &inFormat,double inScale)
 Font::Font(FontFace *inFace, int inPixelHeight, bool inInitRef) :
      Object(inInitRef), mFace(inFace), mPixelHeight(inPixelHeight)
 {
-   mCurrentSheet = -1;
 }
 
 
@@ -188,40 +189,37 @@ Tile Font::GetGlyph(int inCharacter,int &outAdvance)
          }
       }
 
-      int orig_w = gw;
-      int orig_h = gh;
-
-      while(1)
+      // Earlier sheets may still have gaps that fit, so try them all, newest first
+      int tid = -1;
+      int sheetId = mSheets.size()-1;
+      for( ; sheetId>=0; sheetId--)
       {
-         // Allocate new sheet?
-         if (mCurrentSheet<0)
-         {
-            int rows = mPixelHeight > 127 ? 1 : mPixelHeight > 63 ? 2 : mPixelHeight>31 ? 4 : 5;
-            int h = 4;
-            while(h<orig_h*rows)
-               h*=2;
-            int w = h;
-            while(w<orig_w)
-               w*=2;
-            PixelFormat pf = mFace->WantRGB() ? pfARGB : pfAlpha;
-            Tilesheet *sheet = new Tilesheet(w,h,pf,true);
-            sheet->GetSurface().Clear(0);
-            mCurrentSheet = mSheets.size();
-            mSheets.push_back(sheet);
-         }
-
-         int tid = mSheets[mCurrentSheet]->AllocRect(gw,gh,ox,oy,true);
+         tid = mSheets[sheetId]->AllocRect(gw,gh,ox,oy,true);
          if (tid>=0)
-         {
-            glyph.sheet = mCurrentSheet;
-            glyph.tile = tid;
-            glyph.advance = adv;
             break;
-         }
+      }
 
-         // Need new sheet...
-         mCurrentSheet = -1;
+      if (tid<0)
+      {
+         // Room for a few rows, plus the one pixel border
+         int rows = mPixelHeight > 127 ? 1 : mPixelHeight > 63 ? 2 : mPixelHeight>31 ? 4 : 5;
+         int h = 4;
+         while(h<(gh+1)*rows)
+            h*=2;
+         int w = h;
+         while(w<gw+1)
+            w*=2;
+         PixelFormat pf = mFace->WantRGB() ? pfARGB : pfAlpha;
+         Tilesheet *sheet = new Tilesheet(w,h,pf,true);
+         sheet->GetSurface().Clear(0);
+         sheetId = mSheets.size();
+         mSheets.push_back(sheet);
+         tid = sheet->AllocRect(gw,gh,ox,oy,true);
       }
+
+      glyph.sheet = sheetId;
+      glyph.tile = tid;
+      glyph.advance = adv;
       // Now fill rect...
       Tile tile = mSheets[glyph.sheet]->GetTile(glyph.tile);
       // SharpenText(bitmap);
@@ -336,7 +334,8 @@ const char *RemapFontName(const char *inName)
 
 typedef std::map<FontInfo, Font *> FontMap;
 FontMap sgFontMap;
-typedef std::map<std::string, AutoGCRoot *> FontBytesMap;
+// Registered font files are kept once, and shared by the faces of every size
+typedef std::map<std::string, MappedFile *> FontBytesMap;
 FontBytesMap sgRegisteredFonts;
 
 Font *Font::Create(TextFormat &inFormat,double inScale,bool inNative,bool inInitRef)
@@ -379,7 +378,7 @@ Font *Font::Create(TextFormat &inFormat,double inScale,bool inNative,bool inInit
          seekName = remappedFont;
       }
 
-      AutoGCRoot *bytes = 0;
+      MappedFile *bytes = 0;
       FontBytesMap::iterator fbit = sgRegisteredFonts.find(seekName);
 
       if (fbit!=sgRegisteredFonts.end())
@@ -393,7 +392,7 @@ Font *Font::Create(TextFormat &inFormat,double inScale,bool inNative,bool inInit
          ByteArray resource(seekName.c_str());
          if (resource.Ok())
          {
-            sgRegisteredFonts[seekName] = new AutoGCRoot( resource.mValue );
+            sgRegisteredFonts[seekName] = MappedFile::FromBytes( resource.Bytes(), resource.Size() );
             fbit = sgRegisteredFonts.find(seekName);
             bytes = fbit->second;
           //  printf("Found!\n");
@@ -454,8 +453,12 @@ Font *Font::Create(TextFormat &inFormat,double inScale,bool inNative,bool inInit
 
 value nme_font_register_font(value inFontName, value inBytes)
 {
-   AutoGCRoot *bytes = new AutoGCRoot(inBytes);
-   sgRegisteredFonts[std::string(val_string(inFontName))] = bytes;
+   ByteArray data(inBytes);
+   MappedFile *bytes = MappedFile::FromBytes(data.Bytes(), data.Size());
+   MappedFile *&slot = sgRegisteredFonts[std::string(val_string(inFontName))];
+   if (slot)
+      slot->DecRef();
+   slot = bytes;
    return alloc_null();
 }
 DEFINE_PRIM(nme_font_register_font,2)
@@ -42,6 +42,7 @@
 #endif
 
 #include "ByteArray.h"
+#include "MappedFile.h"
 
 #define NME_FREETYPE_FLAGS  (FT_LOAD_FORCE_AUTOHINT|FT_LOAD_DEFAULT)
 
@@ -54,8 +55,8 @@ FT_Library sgLibrary = 0;
 class FreeTypeFont : public FontFace
 {
 public:
-   FreeTypeFont(FT_Face inFace, int inPixelHeight, int inTransform, void* inBuffer) :
-     mFace(inFace), mPixelHeight(inPixelHeight),mTransform(inTransform), mBuffer(inBuffer)
+   FreeTypeFont(FT_Face inFace, int inPixelHeight, int inTransform, MappedFile* inBuffer) :
+     mBuffer(inBuffer), mFace(inFace), mTransform(inTransform), mPixelHeight(inPixelHeight)
    {
    }
 
@@ -63,7 +64,7 @@ public:
    ~FreeTypeFont()
    {
       FT_Done_Face(mFace);
-	  if (mBuffer) free(mBuffer);
+      if (mBuffer) mBuffer->DecRef();
    }
 
    bool LoadBitmap(int inChar)
@@ -243,44 +244,30 @@ public:
    }
 
    
-   void* mBuffer;
+   MappedFile* mBuffer;
    FT_Face  mFace;
    uint32 mTransform;
    int    mPixelHeight;
 
 };
 
-int MyNewFace(const std::string &inFace, int inIndex, FT_Face *outFace, AutoGCRoot *inBytes, void** outBuffer)
+int MyNewFace(const std::string &inFace, int inIndex, FT_Face *outFace, MappedFile *inBytes, MappedFile** outBuffer)
 {
    *outFace = 0;
    *outBuffer = 0;
-   int result = 0;
-   result = FT_New_Face(sgLibrary, inFace.c_str(), inIndex, outFace);
-   if (*outFace==0)
-   {
-     ByteArray bytes;
-     if (inBytes == 0)
-     {
-         bytes = ByteArray::FromFile(inFace.c_str());
-     }
-     else
-     {
-         bytes = ByteArray(inBytes->get());
-     }
-      if (bytes.Ok())
-      {
-         int l = bytes.Size();
-         unsigned char *buf = (unsigned char*)malloc(l);
-         memcpy(buf,bytes.Bytes(),l);
-         result = FT_New_Memory_Face(sgLibrary, buf, l, inIndex, outFace);
-
-         // The font owns the bytes here - so we just leak (fonts are not actually cleaned)
-         if (!*outFace)
-            free(buf);
-         else
-            *outBuffer = buf;
-      }
-   }
+
+   // Faces share the file or registered bytes, which must outlive them
+   MappedFile *file = MappedFile::Open(inFace.c_str());
+   if (!file && inBytes)
+      file = (MappedFile *)inBytes->IncRef();
+   if (!file)
+      return FT_Err_Cannot_Open_Resource;
+
+   int result = FT_New_Memory_Face(sgLibrary, file->Bytes(), file->Size(), inIndex, outFace);
+   if (*outFace)
+      *outBuffer = file;
+   else
+      file->DecRef();
    //printf("MyNewFace done\n");
    return result;
 }
@@ -289,11 +276,11 @@ int MyNewFace(const std::string &inFace, int inIndex, FT_Face *outFace, AutoGCRo
 
 
 
-static FT_Face OpenFont(const std::string &inFace, unsigned int inFlags, AutoGCRoot *inBytes, void** outBuffer)
+static FT_Face OpenFont(const std::string &inFace, unsigned int inFlags, MappedFile *inBytes, MappedFile** outBuffer)
 {
    *outBuffer = 0;
    FT_Face face = 0;
-   void* pBuffer = 0;
+   MappedFile* pBuffer = 0;
    // printf("MyNewFace %s with bytes %p\n", inFace.c_str(), inBytes);
 
    MyNewFace(inFace.c_str(), 0, &face, inBytes, &pBuffer);
@@ -304,18 +291,21 @@ static FT_Face OpenFont(const std::string &inFace, unsigned int inFlags, AutoGCR
       for(int f=1;f<n;f++)
       {
          FT_Face test = 0;
-         void* pTestBuffer = 0;
-         MyNewFace(inFace.c_str(), f, &test, NULL, &pTestBuffer);
+         MappedFile* pTestBuffer = 0;
+         MyNewFace(inFace.c_str(), f, &test, inBytes, &pTestBuffer);
          if (test && test->style_flags == inFlags)
          {
             // A goodie!
             FT_Done_Face(face);
-            if (pBuffer) free(pBuffer);
+            if (pBuffer) pBuffer->DecRef();
             *outBuffer = pTestBuffer;
             return test;
          }
          else if (test)
+         {
             FT_Done_Face(test);
+            pTestBuffer->DecRef();
+         }
       }
       // The original face will have to do...
    }
@@ -584,7 +574,7 @@ std::string ToAssetName(const std::string &inPath)
 #endif
 }
 
-FT_Face FindFont(const std::string &inFontName, unsigned int inFlags, AutoGCRoot *inBytes, void** pBuffer)
+FT_Face FindFont(const std::string &inFontName, unsigned int inFlags, MappedFile *inBytes, MappedFile** pBuffer)
 {
    std::string fname = inFontName;
    
@@ -620,7 +610,7 @@ FT_Face FindFont(const std::string &inFontName, unsigned int inFlags, AutoGCRoot
 
 extern const char *RemapFontName(const char *inName);
 
-FontFace *FontFace::CreateFreeType(const TextFormat &inFormat,double inScale,AutoGCRoot *inBytes, const std::string &inCombinedName)
+FontFace *FontFace::CreateFreeType(const TextFormat &inFormat,double inScale,MappedFile *inBytes, const std::string &inCombinedName)
 {
    if (!sgLibrary)
      FT_Init_FreeType( &sgLibrary );
@@ -639,7 +629,7 @@ FontFace *FontFace::CreateFreeType(const TextFormat &inFormat,double inScale,Aut
          flags |= ffItalic;
    }
    
-   void* pBuffer = 0;
+   MappedFile* pBuffer = 0;
    face = FindFont(str,flags,inBytes,&pBuffer);
    if (!face)
    {
@@ -851,10 +841,17 @@ value freetype_import_font(value font_file, value char_vector, value em_size, va
    val_check(font_file, string);
    val_check(em_size, int);
    
-   AutoGCRoot *bytes = !val_is_null(inBytes) ? new AutoGCRoot(inBytes) : NULL;
+   nme::MappedFile *bytes = 0;
+   if (!val_is_null(inBytes))
+   {
+      nme::ByteArray data(inBytes);
+      bytes = nme::MappedFile::FromBytes(data.Bytes(), data.Size());
+   }
 
-   void* pBuffer = 0;
+   nme::MappedFile* pBuffer = 0;
    result = nme::MyNewFace(val_string(font_file), 0, &face, bytes, &pBuffer);
+   if (bytes)
+      bytes->DecRef();
    
    if (result == FT_Err_Unknown_File_Format)
    {
@@ -870,7 +867,7 @@ value freetype_import_font(value font_file, value char_vector, value em_size, va
    if (!FT_IS_SCALABLE(face))
    {
       FT_Done_Face(face);
-      if (pBuffer) free(pBuffer);
+      if (pBuffer) pBuffer->DecRef();
       
       val_throw(alloc_string("Font is not scalable!"));
       return alloc_null();
@@ -1040,7 +1037,7 @@ value freetype_import_font(value font_file, value char_vector, value em_size, va
       alloc_field(ret, val_id("kerning"), alloc_null());
 
    FT_Done_Face(face);
-   if (pBuffer) free(pBuffer);
+   if (pBuffer) pBuffer->DecRef();
    
    return ret;
 }
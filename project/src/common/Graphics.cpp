@@ -1,6 +1,9 @@
 #include <Graphics.h>
+#include <CachedExtent.h>
 #include <Surface.h>
 #include <Display.h>
+#include <NMEThread.h>
+#include <Profile.h>
 
 namespace nme
 {
@@ -21,6 +24,8 @@ Graphics::Graphics(DisplayObject *inOwner,bool inInitRef) : Object(inInitRef)
    mRotation0 = 0;
    mCursor = UserPoint(0,0);
    mHardwareData = 0;
+   mLastHardware = 0;
+   mHardwareTask = 0;
    mPathData = new GraphicsPath;
    mBuiltHardware = 0;
    mTileJob.mIsTileJob = true;
@@ -34,13 +39,24 @@ Graphics::Graphics(DisplayObject *inOwner,bool inInitRef) : Object(inInitRef)
 Graphics::~Graphics()
 {
    mOwner = 0;
-   clear();
+   clear(true);
    mPathData->DecRef();
 }
 
 
 void Graphics::clear(bool inForceFreeHardware)
 {
+   if (gAsyncTessellation && !inForceFreeHardware)
+      KeepLastHardware();
+   else
+   {
+      delete mLastHardware;
+      mLastHardware = 0;
+   }
+
+   // The task uses copies of the jobs, so it must be finished with them first
+   CancelHardwareTask();
+
    mFillJob.clear();
    mLineJob.clear();
    mTileJob.clear();
@@ -50,6 +66,8 @@ void Graphics::clear(bool inForceFreeHardware)
       mJobs[i].clear();
    mJobs.resize(0);
 
+   ClearHardwareScales();
+
    if (mHardwareData)
    {
       if (inForceFreeHardware || mClearCount<4)
@@ -425,7 +443,14 @@ void Graphics::tile(float x, float y, const Rect &inTileRect,float *inTrans,floa
 }
 
 
-void Graphics::drawPoints(QuickVec<float> inXYs, QuickVec<int> inRGBAs, unsigned int inDefaultRGBA,
+void Graphics::drawPoints(const QuickVec<float> &inXYs, const QuickVec<int> &inRGBAs, unsigned int inDefaultRGBA,
+								  double inSize)
+{
+   int n = inXYs.size()/2;
+   drawPointData(n ? &inXYs[0] : 0, n && inRGBAs.size()==n ? &inRGBAs[0] : 0, n, inDefaultRGBA, inSize);
+}
+
+void Graphics::drawPointData(const float *inXYs, const int *inRGBAs, int inCount, unsigned int inDefaultRGBA,
 								  double inSize)
 {
    endFill();
@@ -437,7 +462,7 @@ void Graphics::drawPoints(QuickVec<float> inXYs, QuickVec<int> inRGBAs, unsigned
    job.mCommandCount = 1;
    job.mData0 = mPathData->data.size();
    job.mIsPointJob = true;
-   mPathData->drawPoints(inXYs,inRGBAs);
+   mPathData->drawPoints(inXYs,inRGBAs,inCount);
    job.mDataCount = mPathData->data.size() - job.mData0;
    if (mPathData->commands[job.mCommand0]==pcPointsXY)
    {
@@ -458,6 +483,18 @@ void Graphics::drawTriangles(const QuickVec<float> &inXYs,
             const QuickVec<float> &inUVT, int inCull,
             const QuickVec<int> &inColours,
             int blendMode)
+{
+   AddTriangleJob( new GraphicsTrianglePath(inXYs, inIndices, inUVT, inCull, inColours, blendMode) );
+}
+
+void Graphics::drawTriangleData(const float *inVertices, int inVertexCount, int inFormat,
+            const int *inIndices, int inIndexCount, int inCull, int blendMode)
+{
+   AddTriangleJob( new GraphicsTrianglePath(inVertices, inVertexCount, inFormat,
+                      inIndices, inIndexCount, inCull, blendMode) );
+}
+
+void Graphics::AddTriangleJob(GraphicsTrianglePath *path)
 {
 	Flush( );
 	
@@ -468,8 +505,6 @@ void Graphics::drawTriangles(const QuickVec<float> &inXYs,
 	
 	IGraphicsFill *fill = mFillJob.mFill;
 
-   GraphicsTrianglePath *path = new GraphicsTrianglePath(inXYs,
-           inIndices, inUVT, inCull, inColours, blendMode );
    GraphicsJob job;
    path->IncRef();
 
@@ -579,19 +614,13 @@ void Graphics::Flush(bool inLine, bool inFill, bool inTile)
 }
 
 
-Extent2DF Graphics::GetSoftwareExtent(const Transform &inTransform, bool inIncludeStroke)
+Extent2DF Graphics::GetExtent(const Transform &inTransform, bool inIncludeStroke)
 {
    Extent2DF result;
    Flush();
 
    for(int i=0;i<mJobs.size();i++)
-   {
-      GraphicsJob &job = mJobs[i];
-      if (!job.mSoftwareRenderer)
-         job.mSoftwareRenderer = Renderer::CreateSoftware(job,*mPathData);
-
-      job.mSoftwareRenderer->GetExtent(inTransform,result,inIncludeStroke);
-   }
+      mJobs[i].GetExtent(*mPathData,inTransform,result,inIncludeStroke);
 
    return result;
 }
@@ -605,7 +634,7 @@ const Extent2DF &Graphics::GetExtent0(double inRotation)
       trans.mMatrix = &m;
       if (inRotation)
          m.Rotate(inRotation);
-      mExtent0 = GetSoftwareExtent(trans,true);
+      mExtent0 = GetExtent(trans,true);
       mRotation0 = inRotation;
       mMeasuredJobs = mJobs.size();
    }
@@ -615,6 +644,7 @@ const Extent2DF &Graphics::GetExtent0(double inRotation)
 
 bool Graphics::Render( const RenderTarget &inTarget, const RenderState &inState )
 {
+   NME_PROFILE_ZONE("Graphics::Render");
    Flush();
    
    #ifdef NME_DIRECTFB
@@ -653,25 +683,16 @@ bool Graphics::Render( const RenderTarget &inTarget, const RenderState &inState
    
    if (inTarget.IsHardware())
    {
-      if (!mHardwareData)
-         mHardwareData = new HardwareData();
-      else if (!mHardwareData->isScaleOk(inState))
-      {
-         mHardwareData->clear();
-         mBuiltHardware = 0;
-      }
-      
-      while(mBuiltHardware<mJobs.size())
-      {
-         BuildHardwareJob(mJobs[mBuiltHardware++],*mPathData,*mHardwareData,*inTarget.mHardware,inState);
-      }
-      
-      if (mHardwareData && !mHardwareData->mElements.empty())
+      BuildHardware(inTarget,inState);
+
+      // Only kept while the new jobs are built, which hit tests wait for
+      HardwareData *data = mLastHardware ? mLastHardware : mHardwareData;
+      if (data && !data->mElements.empty())
       {
          if (inState.mPhase==rpHitTest)
-            return inTarget.mHardware->Hits(inState,*mHardwareData);
+            return inTarget.mHardware->Hits(inState,*data);
          else
-            inTarget.mHardware->Render(inState,*mHardwareData);
+            inTarget.mHardware->Render(inState,*data);
       }
    }
    else
@@ -698,6 +719,292 @@ bool Graphics::Render( const RenderTarget &inTarget, const RenderState &inState
 }
 
 
+// --- Hardware tessellation ---------------------------------------------------------
+//
+// A tessellation is only good for a range of scales.  Rather than discarding it when
+//  the scale changes, a few are kept so zooming back and forth can reuse them.  If the
+//  closest one is near enough, it is drawn while the exact scale is tessellated on a
+//  worker thread.
+// With gAsyncTessellation, new jobs are also tessellated on a worker thread, and the
+//  previous tessellation (if any) is drawn until the result is swapped in.  New graphics
+//  draw nothing until then, but graphics that are cleared and drawn again, perhaps every
+//  frame, keep drawing the last complete tessellation from before the clear.
+
+enum { MAX_HARDWARE_SCALES = 3 };
+
+bool gAsyncTessellation = false;
+
+// How far outside its range a tessellation may be drawn while waiting for a better one
+static const float sgHardwareScaleSlack = 2.0;
+
+// 1 if inData is good for inScale, otherwise the ratio it is out by
+static float HardwareScaleDistance(const HardwareData &inData, float inScale)
+{
+   if (inData.mMinScale>0 && inScale<inData.mMinScale)
+      return inData.mMinScale/inScale;
+   if (inData.mMaxScale>0 && inScale>inData.mMaxScale)
+      return inScale/inData.mMaxScale;
+   return 1.0;
+}
+
+class HardwareBuildTask : public WorkerTask
+{
+public:
+   HardwareBuildTask(const GraphicsJobs &inJobs, const GraphicsPath &inPath,
+                     HardwareRenderer *inHardware, const Matrix &inMatrix) :
+      mJobs(inJobs), mHardware(inHardware), mMatrix(inMatrix)
+   {
+      // The path may be appended to while we work, so take a copy
+      mPath = new GraphicsPath();
+      mPath->commands = inPath.commands;
+      mPath->data = inPath.data;
+      mPath->winding = inPath.winding;
+      mData = new HardwareData();
+   }
+   ~HardwareBuildTask()
+   {
+      mPath->DecRef();
+      delete mData;
+   }
+
+   // Bitmaps may need textures created, which must happen on the render thread, and
+   //  gradients create their colour surface as they are tessellated
+   static bool CanBuild(const GraphicsJobs &inJobs)
+   {
+      for(int i=0;i<inJobs.size();i++)
+      {
+         const GraphicsJob &job = inJobs[i];
+         if (job.mIsTileJob || job.mIsPointJob)
+            return false;
+         if (job.mFill && !CanBuildFill(job.mFill))
+            return false;
+         if (job.mStroke && job.mStroke->fill && !CanBuildFill(job.mStroke->fill))
+            return false;
+      }
+      return true;
+   }
+
+   static bool CanBuildFill(IGraphicsFill *inFill)
+   {
+      return !inFill->AsBitmapFill() && !inFill->AsGradientFill();
+   }
+
+   void RunTask(int)
+   {
+      RenderState state;
+      state.mTransform.mMatrix = &mMatrix;
+      for(int i=0;i<mJobs.size();i++)
+         BuildHardwareJob(mJobs[i],*mPath,*mData,*mHardware,state);
+   }
+
+   // Copies - the fills are kept alive by the Graphics, which waits for us before clearing
+   GraphicsJobs     mJobs;
+   GraphicsPath     *mPath;
+   HardwareData     *mData;
+   HardwareRenderer *mHardware;
+   Matrix           mMatrix;
+};
+
+
+void Graphics::BuildHardware(const RenderTarget &inTarget, const RenderState &inState)
+{
+   // A surface has left the texture atlas, so the tex-coords may be wrong
+   if (mHardwareData && mHardwareData->mAtlasVersion &&
+         mHardwareData->mAtlasVersion!=gTextureAtlasVersion)
+   {
+      mHardwareData->clear();
+      mBuiltHardware = 0;
+   }
+   if (mLastHardware && mLastHardware->mAtlasVersion &&
+         mLastHardware->mAtlasVersion!=gTextureAtlasVersion)
+   {
+      delete mLastHardware;
+      mLastHardware = 0;
+   }
+
+   // Jobs have been added, so the other scales are out of date
+   if (mBuiltHardware<mJobs.size())
+      ClearHardwareScales();
+
+   // Hit tests need the real thing
+   if (mHardwareTask && mBuiltHardware<mJobs.size() && inState.mPhase==rpHitTest)
+      WaitWorkerTask(mHardwareTask);
+
+   if (!mHardwareData)
+      mHardwareData = new HardwareData();
+   float scale = mHardwareData->scaleOf(inState);
+
+   if (mHardwareTask && IsWorkerTaskDone(mHardwareTask))
+   {
+      // The jobs can only have been added to since it was queued, so the result covers the
+      //  first of them, and is better than what we have if that covers fewer
+      int built = mHardwareTask->mJobs.size();
+      if (built<=mJobs.size())
+      {
+         HardwareData *data = mHardwareTask->mData;
+         mHardwareTask->mData = 0;
+         if (mBuiltHardware<built)
+         {
+            delete mHardwareData;
+            mHardwareData = data;
+            mBuiltHardware = built;
+         }
+         else if (built<mJobs.size())
+            delete data;
+         else
+            KeepHardwareScale(data,scale);
+      }
+      delete mHardwareTask;
+      mHardwareTask = 0;
+   }
+
+   bool canAsync = inState.mPhase!=rpHitTest && GetWorkerThreads()>0 &&
+                   HardwareBuildTask::CanBuild(mJobs);
+
+   if (!mHardwareData->isScaleOk(inState))
+   {
+      // Swap in the closest
+      float dist = HardwareScaleDistance(*mHardwareData,scale);
+      int best = -1;
+      for(int i=0;i<mHardwareScales.size();i++)
+      {
+         float d = HardwareScaleDistance(*mHardwareScales[i],scale);
+         if (d<dist)
+         {
+            dist = d;
+            best = i;
+         }
+      }
+      if (best>=0)
+      {
+         HardwareData *data = mHardwareScales[best];
+         mHardwareScales[best] = mHardwareData;
+         mHardwareData = data;
+      }
+
+      if (dist>1.0)
+      {
+         bool async = canAsync && mBuiltHardware==mJobs.size() &&
+                      (dist<=sgHardwareScaleSlack || gAsyncTessellation);
+         if (!async)
+         {
+            if (mBuiltHardware==mJobs.size())
+               KeepHardwareScale(mHardwareData,scale);
+            else
+               delete mHardwareData;
+            mHardwareData = new HardwareData();
+            mBuiltHardware = 0;
+         }
+         else if (!mHardwareTask)
+         {
+            mHardwareTask = new HardwareBuildTask(mJobs,*mPathData,inTarget.mHardware,
+                                                  *inState.mTransform.mMatrix);
+            QueueWorkerTask(mHardwareTask);
+         }
+      }
+   }
+
+   // Draw what we have until the new one is ready
+   if (mBuiltHardware<mJobs.size() && gAsyncTessellation && canAsync)
+   {
+      if (!mHardwareTask)
+      {
+         mHardwareTask = new HardwareBuildTask(mJobs,*mPathData,inTarget.mHardware,
+                                               *inState.mTransform.mMatrix);
+         QueueWorkerTask(mHardwareTask);
+      }
+      return;
+   }
+
+   // A task for these jobs would only repeat the work
+   if (mBuiltHardware<mJobs.size())
+      CancelHardwareTask();
+
+   while(mBuiltHardware<mJobs.size())
+   {
+      BuildHardwareJob(mJobs[mBuiltHardware++],*mPathData,*mHardwareData,*inTarget.mHardware,inState);
+   }
+
+   delete mLastHardware;
+   mLastHardware = 0;
+}
+
+
+void Graphics::KeepHardwareScale(HardwareData *inData, float inScale)
+{
+   mHardwareScales.push_back(inData);
+   if (mHardwareScales.size()>MAX_HARDWARE_SCALES)
+   {
+      // Drop the one furthest from the current scale
+      int worst = 0;
+      float worstDist = 0;
+      for(int i=0;i<mHardwareScales.size();i++)
+      {
+         float d = HardwareScaleDistance(*mHardwareScales[i],inScale);
+         if (d>worstDist)
+         {
+            worstDist = d;
+            worst = i;
+         }
+      }
+      delete mHardwareScales[worst];
+      mHardwareScales.erase(worst,1);
+   }
+}
+
+
+// Takes the newest complete tessellation of the jobs about to be cleared - from the task if
+//  it has started, since it is waited for anyway
+void Graphics::KeepLastHardware()
+{
+   HardwareData *last = 0;
+   if (mHardwareTask)
+   {
+      bool dropped = CancelWorkerTask(mHardwareTask);
+      if (!dropped && mHardwareTask->mJobs.size()==mJobs.size())
+      {
+         last = mHardwareTask->mData;
+         mHardwareTask->mData = 0;
+      }
+      delete mHardwareTask;
+      mHardwareTask = 0;
+   }
+   if (!last && mHardwareData && mBuiltHardware==mJobs.size())
+   {
+      last = mHardwareData;
+      mHardwareData = 0;
+   }
+
+   if (last && !last->mElements.empty())
+   {
+      delete mLastHardware;
+      mLastHardware = last;
+   }
+   else
+      delete last;
+}
+
+
+void Graphics::CancelHardwareTask()
+{
+   if (mHardwareTask)
+   {
+      // Dropped if it has not started, since the result would not be used
+      CancelWorkerTask(mHardwareTask);
+      delete mHardwareTask;
+      mHardwareTask = 0;
+   }
+}
+
+
+void Graphics::ClearHardwareScales()
+{
+   for(int i=0;i<mHardwareScales.size();i++)
+      delete mHardwareScales[i];
+   mHardwareScales.resize(0);
+}
+
+
 // --- RenderState -------------------------------------------------------------------
 
 void GraphicsJob::clear()
@@ -706,6 +1013,7 @@ void GraphicsJob::clear()
    if (mFill) mFill->DecRef();
    if (mTriangles) mTriangles->DecRef();
    if (mSoftwareRenderer) mSoftwareRenderer->Destroy();
+   delete mExtents;
    bool was_tile = mIsTileJob;
    memset(this,0,sizeof(GraphicsJob));
    mIsTileJob = was_tile;
@@ -719,6 +1027,7 @@ RenderState::RenderState(Surface *inSurface,int inAA)
 {
    mTransform.mAAFactor = inAA;
    mMask = 0;
+   mQueue = 0;
    mPhase = rpRender;
    mAlpha_LUT = 0;
    mR_LUT = 0;
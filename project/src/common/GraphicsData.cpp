@@ -183,24 +183,24 @@ void GraphicsPath::closeLine(int inCommand0, int inData0)
 }
 
 
-void GraphicsPath::drawPoints(QuickVec<float> inXYs, QuickVec<int> inRGBAs)
+void GraphicsPath::drawPoints(const float *inXYs, const int *inRGBAs, int inCount)
 {
-   int n = inXYs.size()/2;
+   int n = inCount;
    int d0 = data.size();
 
-   if (inRGBAs.size()==n)
+   if (inRGBAs)
    {
        commands.push_back(pcPointsXYRGBA);
        data.resize(d0 + n*3);
-       memcpy(&data[d0], &inXYs[0], n*2*sizeof(float));
+       memcpy(&data[d0], inXYs, n*2*sizeof(float));
        d0+=n*2;
-       memcpy(&data[d0], &inRGBAs[0], n*sizeof(int));
+       memcpy(&data[d0], inRGBAs, n*sizeof(int));
    }
    else
    {
        commands.push_back(pcPointsXY);
        data.resize(d0 + n*2);
-       memcpy(&data[d0], &inXYs[0], n*sizeof(float));
+       memcpy(&data[d0], inXYs, n*2*sizeof(float));
    }
 }
 
@@ -212,97 +212,93 @@ GraphicsTrianglePath::GraphicsTrianglePath( const QuickVec<float> &inXYs,
             const QuickVec<int> &inColours,
             int inBlendMode)
 {
-	UserPoint *v = (UserPoint *) &inXYs[0];
-    uint32 *c = (uint32 *) &inColours[0];
-    if(inColours.empty()) c=NULL;
-	
-	int v_count = inXYs.size()/2;
-	int uv_parts = inUVT.size()==v_count*2 ? 2 : inUVT.size()==v_count*3 ? 3 : 0;
-	const float *uvt = &inUVT[0];
-
-	mBlendMode = inBlendMode;
-	
-	if (inIndices.empty())
-	{
-		int t_count = v_count/3;
-		if (inCull==tcNone)
-		{
-			mVertices.resize(6*t_count);
-			memcpy(&mVertices[0],v,3*sizeof(UserPoint));
-			if (uv_parts)
-			{
-				mUVT.resize(uv_parts*3*t_count);
-				memcpy(&mUVT[0],&inUVT[0],uv_parts*sizeof(UserPoint));
-			}
-		}
-		else
-		{
-			for(int i=0;i<t_count;i++)
-			{
-				UserPoint p0 = *v++;
-				UserPoint p1 = *v++;
-				UserPoint p2 = *v++;
-				if ( (p1-p0).Cross(p2-p0)*inCull > 0)
-				{
-					mTriangleCount++;
-					mVertices.push_back(p0);
-					mVertices.push_back(p1);
-					mVertices.push_back(p2);
-					for(int i=0;i<uv_parts*3;i++)
-						mUVT.push_back( *uvt++ );
-				}
-				else
-					uvt += uv_parts;
-			}
-		}
-	}
-	else
-	{
-		const int *idx = &inIndices[0];
-		int t_count = inIndices.size()/3;
-		for(int i=0;i<t_count;i++)
-		{
-			int i0 = *idx++;
-			int i1 = *idx++;
-			int i2 = *idx++;
-			if (i0>=0 && i1>=0 && i2>=0 && i0<v_count && i1<v_count && i2<v_count)
-			{
-				UserPoint p0 = v[i0];
-				UserPoint p1 = v[i1];
-				UserPoint p2 = v[i2];
-				if ( (p1-p0).Cross(p2-p0)*inCull >= 0)
-				{
-					mVertices.push_back(p0);
-					mVertices.push_back(p1);
-					mVertices.push_back(p2);
-		                    if(c)
-		                    {
-		                       uint32 co0 = c[i0];
-		                       uint32 co1 = c[i1];
-		                       uint32 co2 = c[i2];
-							   co0 = ((co0 >> 24) & 0xFF) << 24 | (co0 & 0xFF) << 16 | ((co0 >> 8) & 0xFF) << 8 | ((co0 >> 16) & 0xFF);
-							   co1 = ((co1 >> 24) & 0xFF) << 24 | (co1 & 0xFF) << 16 | ((co1 >> 8) & 0xFF) << 8 | ((co1 >> 16) & 0xFF);
-							   co2 = ((co2 >> 24) & 0xFF) << 24 | (co2 & 0xFF) << 16 | ((co2 >> 8) & 0xFF) << 8 | ((co2 >> 16) & 0xFF);
-		                       mColours.push_back(co0);
-		                       mColours.push_back(co1);
-		                       mColours.push_back(co2);
-		                    }
-					if (uv_parts)
-					{
-						const float *f = uvt + uv_parts*i0;
-						for(int i=0;i<uv_parts;i++) mUVT.push_back( *f++ );
-						f = uvt + uv_parts*i1;
-						for(int i=0;i<uv_parts;i++) mUVT.push_back( *f++ );
-						f = uvt + uv_parts*i2;
-						for(int i=0;i<uv_parts;i++) mUVT.push_back( *f++ );
-					}
-				}
-			}
-		}
-	}
-
-	mTriangleCount = mVertices.size()/3;
-   mType = uv_parts==2 ? vtVertexUV : uv_parts==3? vtVertexUVT : vtVertex;
+   int v_count = inXYs.size()/2;
+   int uv_parts = inUVT.size()==v_count*2 ? 2 : inUVT.size()==v_count*3 ? 3 : 0;
+   bool colours = v_count>0 && inColours.size()>=v_count;
+
+   mBlendMode = inBlendMode;
+   Init( v_count ? &inXYs[0] : 0, 2,
+         uv_parts ? &inUVT[0] : 0, uv_parts, uv_parts,
+         colours ? &inColours[0] : 0, 1,
+         v_count, inIndices.empty() ? 0 : &inIndices[0], inIndices.size(), inCull );
+}
+
+GraphicsTrianglePath::GraphicsTrianglePath( const float *inVertices, int inVertexCount, int inFormat,
+            const int *inIndices, int inIndexCount, int inCull, int inBlendMode)
+{
+   int uv_parts = (inFormat & vfUVT) ? 3 : (inFormat & vfUV) ? 2 : 0;
+   bool colours = inFormat & vfColour;
+   int stride = 2 + uv_parts + (colours ? 1 : 0);
+
+   mBlendMode = inBlendMode;
+   Init( inVertices, stride,
+         inVertices+2, stride, uv_parts,
+         colours ? (const int *)(inVertices+2+uv_parts) : 0, stride,
+         inVertexCount, inIndices, inIndexCount, inCull );
+}
+
+// The strides are in 4-byte words, so the vertices may be packed one array per part, or interleaved
+void GraphicsTrianglePath::Init(const float *inXY, int inXYStride,
+            const float *inUVT, int inUVTStride, int inUVParts,
+            const int *inColours, int inColourStride,
+            int inVertexCount, const int *inIndices, int inIndexCount, int inCull)
+{
+   int t_count = inIndices ? inIndexCount/3 : inVertexCount/3;
+
+   mVertices.reserve(t_count*3);
+   if (inUVParts)
+      mUVT.reserve(t_count*3*inUVParts);
+   if (inColours)
+      mColours.reserve(t_count*3);
+
+   const int *idx = inIndices;
+   for(int t=0;t<t_count;t++)
+   {
+      int i[3];
+      if (idx)
+      {
+         i[0] = *idx++;
+         i[1] = *idx++;
+         i[2] = *idx++;
+         if (i[0]<0 || i[1]<0 || i[2]<0 || i[0]>=inVertexCount || i[1]>=inVertexCount || i[2]>=inVertexCount)
+            continue;
+      }
+      else
+      {
+         i[0] = t*3;
+         i[1] = t*3+1;
+         i[2] = t*3+2;
+      }
+
+      UserPoint p[3];
+      for(int k=0;k<3;k++)
+      {
+         const float *xy = inXY + i[k]*inXYStride;
+         p[k] = UserPoint(xy[0],xy[1]);
+      }
+      if ( inCull!=tcNone && (p[1]-p[0]).Cross(p[2]-p[0])*inCull < 0)
+         continue;
+
+      for(int k=0;k<3;k++)
+      {
+         mVertices.push_back(p[k]);
+         if (inColours)
+         {
+            // ARGB to the RGBA byte order used by the renderers
+            uint32 c = inColours[i[k]*inColourStride];
+            mColours.push_back( (c & 0xff00ff00) | ((c & 0xff)<<16) | ((c>>16) & 0xff) );
+         }
+         if (inUVParts)
+         {
+            const float *f = inUVT + i[k]*inUVTStride;
+            for(int u=0;u<inUVParts;u++)
+               mUVT.push_back( f[u] );
+         }
+      }
+   }
+
+   mTriangleCount = mVertices.size()/3;
+   mType = inUVParts==2 ? vtVertexUV : inUVParts==3? vtVertexUVT : vtVertex;
 }
 
 
@@ -0,0 +1,507 @@
+#include <CachedExtent.h>
+#include <Surface.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// The extents of the graphics jobs, measured straight from the path data.  These cover the
+//  same area as the software renderers draw, so shapes can be measured without creating
+//  renderers - which hardware targets would never draw with.
+
+namespace nme
+{
+
+class JobExtent
+{
+public:
+   JobExtent(const GraphicsJob &inJob, const GraphicsPath &inPath, CachedExtent &ioCache) :
+      mJob(inJob), mPath(inPath), mTransform(ioCache.mTransform), mExtent(ioCache.mExtent),
+      mIncludeStroke(ioCache.mIncludeStroke)
+   {
+      mPoints = inJob.mDataCount>0 ? (const UserPoint *)&inPath.data[inJob.mData0] : 0;
+   }
+
+   void Build()
+   {
+      if (mJob.mTriangles)
+      {
+         if (mJob.mFill)
+            AddTriangles();
+         if (mJob.mStroke)
+            AddTriangleLines();
+      }
+      else if (mJob.mIsTileJob)
+         AddTiles();
+      else if (mJob.mIsPointJob)
+         AddPoints();
+      else if (mJob.mStroke)
+         AddLines();
+      else
+         AddSolid();
+   }
+
+private:
+   inline UserPoint Point(int inIndex) const
+   {
+      return mTransform.Apply(mPoints[inIndex].x, mPoints[inIndex].y);
+   }
+
+
+   // Quadratic extremes, found where d/dt B(t) = 0 in each axis.  The outline of a stroke
+   //  is furthest out where the curve is, since it is perpendicular to the curve there.
+   void AddCurve(const UserPoint &p0, const UserPoint &p1, const UserPoint &p2, double inPerpLen)
+   {
+      double denom = p2.x + p0.x - 2 * p1.x;
+      if (denom != 0)
+      {
+         double t = (p0.x - p1.x) / denom;
+         if (t > 0 && t < 1)
+         {
+            double x = (1 - t) * (1 - t) * p0.x + 2 * t * (1 - t) * p1.x + t * t * p2.x;
+            mExtent.AddX(x - inPerpLen);
+            mExtent.AddX(x + inPerpLen);
+         }
+      }
+
+      denom = p2.y + p0.y - 2 * p1.y;
+      if (denom != 0)
+      {
+         double t = (p0.y - p1.y) / denom;
+         if (t > 0 && t < 1)
+         {
+            double y = (1 - t) * (1 - t) * p0.y + 2 * t * (1 - t) * p1.y + t * t * p2.y;
+            mExtent.AddY(y - inPerpLen);
+            mExtent.AddY(y + inPerpLen);
+         }
+      }
+   }
+
+
+   void AddSolid()
+   {
+      int n = mJob.mCommandCount;
+      if (n<3 || !mPoints)
+         return;
+
+      const uint8 *command = &mPath.commands[mJob.mCommand0];
+      int p = 0;
+      UserPoint last;
+      for(int i=0;i<n;i++)
+      {
+         switch(command[i])
+         {
+            case pcWideMoveTo:
+               p++;
+            case pcMoveTo:
+            case pcBeginAt:
+               last = Point(p++);
+               break;
+
+            case pcWideLineTo:
+               p++;
+            case pcLineTo:
+               mExtent.Add(last);
+               last = Point(p++);
+               mExtent.Add(last);
+               break;
+
+            case pcCurveTo:
+               {
+               UserPoint control = Point(p);
+               UserPoint end = Point(p+1);
+               mExtent.Add(last);
+               AddCurve(last, control, end, 0.0);
+               last = end;
+               mExtent.Add(last);
+               p += 2;
+               }
+               break;
+         }
+      }
+   }
+
+
+   void AddPoints()
+   {
+      int count = mJob.mDataCount / (mPath.commands[mJob.mCommand0]==pcPointsXY ? 2 : 3);
+      for(int i=0;i<count;i++)
+         mExtent.Add(Point(i));
+   }
+
+
+   void AddTiles()
+   {
+      GraphicsBitmapFill *fill = mJob.mFill ? mJob.mFill->AsBitmapFill() : 0;
+      int mode = mJob.mTileMode;
+      bool fullImage = mode & pcTile_Full_Image_Bit;
+      if (fullImage && (!fill || !fill->bitmapData))
+         return;
+
+      int size = fullImage ? 1 : 3;
+      if (mode & pcTile_Trans_Bit)
+         size+=2;
+      if (mode & pcTile_Col_Bit)
+         size+=2;
+
+      const Matrix &m = *mTransform.mMatrix;
+      const UserPoint *point = mPoints;
+      for(int t=0;t<mJob.mTileCount;t++)
+      {
+         UserPoint pos = point[0];
+         double w = fullImage ? fill->bitmapData->Width() : point[2].x;
+         double h = fullImage ? fill->bitmapData->Height() : point[2].y;
+         // The tile's 2x2 transform is stored a,b,c,d - across is w*(a,b) and down h*(c,d)
+         UserPoint across(w,0);
+         UserPoint down(0,h);
+         if (mode & pcTile_Trans_Bit)
+         {
+            const UserPoint *trans = point + (fullImage ? 1 : 3);
+            across = UserPoint(w*trans[0].x, w*trans[0].y);
+            down = UserPoint(h*trans[1].x, h*trans[1].y);
+         }
+
+         mExtent.Add( m.Apply(pos.x, pos.y) );
+         mExtent.Add( m.Apply(pos.x+across.x, pos.y+across.y) );
+         mExtent.Add( m.Apply(pos.x+down.x, pos.y+down.y) );
+         mExtent.Add( m.Apply(pos.x+across.x+down.x, pos.y+across.y+down.y) );
+
+         point += size;
+      }
+   }
+
+
+   void AddTriangles()
+   {
+      const GraphicsTrianglePath &tris = *mJob.mTriangles;
+      for(int i=0;i<tris.mVertices.size();i++)
+         mExtent.Add( mTransform.Apply(tris.mVertices[i].x, tris.mVertices[i].y) );
+   }
+
+
+   // --- Strokes -----------------------------------------------------------
+
+   // Half the line width on the target, as LineRender works it out
+   double GetPerpLen()
+   {
+      if (!mIncludeStroke)
+         return 0.0;
+
+      const GraphicsStroke &stroke = *mJob.mStroke;
+      const Matrix &m = *mTransform.mMatrix;
+      double perp_len = stroke.thickness;
+      if (perp_len==0.0)
+         perp_len = 0.5;
+      else if (perp_len>=0)
+      {
+         perp_len *= 0.5;
+         switch(stroke.scaleMode)
+         {
+            case ssmNone:
+               break;
+            case ssmNormal:
+            case ssmOpenGL:
+               perp_len *= sqrt( 0.5*(m.m00*m.m00 + m.m01*m.m01 + m.m10*m.m10 + m.m11*m.m11) );
+               break;
+            case ssmVertical:
+               perp_len *= sqrt( m.m00*m.m00 + m.m01*m.m01 );
+               break;
+            case ssmHorizontal:
+               perp_len *= sqrt( m.m10*m.m10 + m.m11*m.m11 );
+               break;
+         }
+      }
+      return fabs(perp_len);
+   }
+
+
+   // The arc LineRender::IterateCircle sweeps: from inStart, turning towards its CWPerp.
+   //  Only the ends, and the axis extremes the arc passes, can be outermost.
+   void AddArc(const UserPoint &inCentre, const UserPoint &inStart, double inTheta)
+   {
+      UserPoint other = inStart.CWPerp();
+      mExtent.Add(inCentre + inStart);
+      mExtent.Add(inCentre + inStart*cos(inTheta) + other*sin(inTheta));
+
+      double r = inStart.Norm();
+      UserPoint axes[4] = { UserPoint(r,0), UserPoint(-r,0), UserPoint(0,r), UserPoint(0,-r) };
+      for(int a=0;a<4;a++)
+      {
+         double phi = atan2( axes[a].Dot(other), axes[a].Dot(inStart) );
+         if (phi<0)
+            phi += 2*M_PI;
+         if (phi<=inTheta)
+            mExtent.Add(inCentre + axes[a]);
+      }
+   }
+
+
+   void AddJoint(const UserPoint &p0, const UserPoint &perp1, const UserPoint &perp2)
+   {
+      const GraphicsStroke &stroke = *mJob.mStroke;
+      if (stroke.joints!=sjMiter && stroke.joints!=sjRound)
+         return;
+
+      // The inside of the turn is covered by the lines themselves
+      UserPoint p1,p2;
+      if (perp2.Cross(perp1)>0)
+      {
+         p1 = perp1;
+         p2 = perp2;
+      }
+      else
+      {
+         p1 = -perp2;
+         p2 = -perp1;
+      }
+
+      if (stroke.joints==sjMiter)
+      {
+         UserPoint dir1 = p1.CWPerp();
+         UserPoint dir2 = p2.Perp();
+         double ml = stroke.miterLimit;
+         double denom_x = dir1.x-dir2.x;
+         double denom_y = dir1.y-dir2.y;
+         double a = (denom_x==0 && denom_y==0) ? ml :
+                    fabs(denom_x)>fabs(denom_y) ? std::min(ml,(p2.x-p1.x)/denom_x) :
+                                                  std::min(ml,(p2.y-p1.y)/denom_y);
+         mExtent.Add(p0 + p1 + dir1*a);
+         if (a>=ml)
+            mExtent.Add(p0 + p2 + dir2*a);
+      }
+      else
+      {
+         double denom = perp1.Norm2() * perp2.Norm2();
+         if (denom>0)
+         {
+            double dot = perp1.Dot(perp2) / sqrt( denom );
+            double theta = dot >= 1.0 ? 0 : dot<= -1.0 ? M_PI : acos(dot);
+            AddArc(p0,p1,theta);
+         }
+      }
+   }
+
+
+   void AddCap(const UserPoint &p0, const UserPoint &perp)
+   {
+      switch(mJob.mStroke->caps)
+      {
+         case scSquare:
+            {
+            UserPoint edge(perp.y,-perp.x);
+            mExtent.Add(p0+perp+edge);
+            mExtent.Add(p0-perp+edge);
+            }
+            break;
+         case scRound:
+            AddArc(p0,perp,M_PI);
+            break;
+         default:
+            mExtent.Add(p0+perp);
+            mExtent.Add(p0-perp);
+      }
+   }
+
+
+   void AddLinePart(const UserPoint &p0, const UserPoint &p1, const UserPoint &perp)
+   {
+      mExtent.Add(p0+perp);
+      mExtent.Add(p0-perp);
+      mExtent.Add(p1+perp);
+      mExtent.Add(p1-perp);
+   }
+
+
+   // Follows LineRender::Iterate, so the same joints and caps are found
+   void AddLines()
+   {
+      double perp_len = GetPerpLen();
+      if (!mPoints)
+         return;
+
+      const uint8 *command = &mPath.commands[mJob.mCommand0];
+      int n = mJob.mCommandCount;
+      int p = 0;
+
+      UserPoint first;
+      UserPoint first_perp;
+      UserPoint prev;
+      UserPoint prev_perp;
+      int points = 0;
+
+      for(int i=0;i<n;i++)
+      {
+         switch(command[i])
+         {
+            case pcWideMoveTo:
+               p++;
+            case pcBeginAt:
+            case pcMoveTo:
+               {
+               UserPoint point = Point(p++);
+               if (points==1 && prev==point)
+                  continue;
+               if (points>1)
+               {
+                  if (points>2 && point==first)
+                     AddJoint(first,prev_perp,first_perp);
+                  else
+                  {
+                     AddCap(first,-first_perp);
+                     AddCap(prev,prev_perp);
+                  }
+               }
+               prev = first = point;
+               points = 1;
+               }
+               break;
+
+            case pcWideLineTo:
+               p++;
+            case pcLineTo:
+               {
+               UserPoint point = Point(p++);
+               if (points>0)
+               {
+                  if (point==prev)
+                     continue;
+
+                  UserPoint perp = (point - prev).Perp(perp_len);
+                  if (points>1)
+                     AddJoint(prev,prev_perp,perp);
+                  else
+                     first_perp = perp;
+
+                  AddLinePart(prev,point,perp);
+                  prev = point;
+                  prev_perp = perp;
+               }
+
+               points++;
+               // Implicit loop closing...
+               if (points>2 && point==first)
+               {
+                  AddJoint(first,prev_perp,first_perp);
+                  points = 1;
+               }
+               }
+               break;
+
+            case pcCurveTo:
+               {
+               UserPoint control = Point(p);
+               UserPoint end = Point(p+1);
+               p += 2;
+
+               UserPoint g0 = control-prev;
+               UserPoint g2 = end-control;
+               UserPoint perp = g0.Perp(perp_len);
+               UserPoint perp_end = g2.Perp(perp_len);
+
+               if (points>0)
+               {
+                  if (points>1)
+                     AddJoint(prev,prev_perp,perp);
+                  else
+                     first_perp = perp;
+               }
+
+               if (fabs(g0.Cross(g2))<0.0001)
+               {
+                  perp_end = perp;
+                  AddLinePart(prev,end,perp);
+               }
+               else
+               {
+                  mExtent.Add(prev+perp);
+                  mExtent.Add(prev-perp);
+                  mExtent.Add(end+perp_end);
+                  mExtent.Add(end-perp_end);
+                  AddCurve(prev,control,end,perp_len);
+               }
+
+               prev = end;
+               prev_perp = perp_end;
+               points++;
+               if (points>2 && prev==first)
+               {
+                  AddJoint(first,perp_end,first_perp);
+                  points = 1;
+               }
+               }
+               break;
+
+            default:
+               p += gCommandDataSize[ command[i] ];
+         }
+      }
+
+      if (points>1)
+      {
+         AddCap(first,-first_perp);
+         AddCap(prev,prev_perp);
+      }
+   }
+
+
+   void AddTriangleLines()
+   {
+      double perp_len = GetPerpLen();
+      const GraphicsTrianglePath &tris = *mJob.mTriangles;
+      const UserPoint *v = tris.mTriangleCount ? &tris.mVertices[0] : 0;
+
+      for(int t=0;t<tris.mTriangleCount;t++)
+      {
+         UserPoint v0 = mTransform.Apply(v[0].x,v[0].y);
+         UserPoint v1 = mTransform.Apply(v[1].x,v[1].y);
+         UserPoint v2 = mTransform.Apply(v[2].x,v[2].y);
+         v += 3;
+
+         UserPoint perp0 = (v1-v0).Perp(perp_len);
+         UserPoint perp1 = (v2-v1).Perp(perp_len);
+         UserPoint perp2 = (v0-v2).Perp(perp_len);
+
+         AddJoint(v0,perp2,perp0);
+         AddLinePart(v0,v1,perp0);
+         AddJoint(v1,perp0,perp1);
+         AddLinePart(v1,v2,perp1);
+         AddJoint(v2,perp1,perp2);
+         AddLinePart(v2,v0,perp2);
+      }
+   }
+
+
+   const GraphicsJob  &mJob;
+   const GraphicsPath &mPath;
+   const Transform    &mTransform;
+   Extent2DF          &mExtent;
+   bool               mIncludeStroke;
+   const UserPoint    *mPoints;
+};
+
+
+
+void GraphicsJob::GetExtent(const GraphicsPath &inPath, const Transform &inTransform,
+                            Extent2DF &ioExtent, bool inIncludeStroke)
+{
+   if (!mExtents)
+      mExtents = new CachedExtentSet();
+   else if (mExtentVersion!=Version())
+      mExtents->Clear();
+   mExtentVersion = Version();
+
+   bool found = false;
+   CachedExtent &cache = mExtents->Find(inTransform,inIncludeStroke,found);
+   if (!found)
+   {
+      JobExtent builder(*this,inPath,cache);
+      builder.Build();
+   }
+
+   if (cache.mExtent.Valid())
+      ioExtent.Add(cache.Get(inTransform));
+}
+
+
+} // end namespace nme
@@ -1,5 +1,6 @@
 #include <Graphics.h>
 #include <Surface.h>
+#include <Profile.h>
 
 
 #ifndef M_PI
@@ -212,7 +213,9 @@ public:
                mElement.mColour = 0xffffffff;
             }
    
-            mElement.mPrimType = (mode & pcTile_Full_Image_Bit) ? ptQuadsFull : ptQuads;
+            // Full tiles use the whole texture, unless it is part of an atlas page
+            mElement.mPrimType = (mode & pcTile_Full_Image_Bit) && !mTexture->GetAtlasPage() ?
+                                    ptQuadsFull : ptQuads;
             ReserveArrays(tiles*4);
    
             AddTiles(mode, &inPath.data[inJob.mData0], tiles);
@@ -258,6 +261,8 @@ public:
             int w = mGradReflect ? 512 : 256;
             mElement.mSurface = new SimpleSurface(w,1,pfARGB);
             mElement.mSurface->IncRef();
+            // The tex-coords span the whole texture, and may repeat
+            mElement.mSurface->SetFlags( mElement.mSurface->GetFlags() | surfNoAtlas );
             grad->FillArray( (ARGB *)mElement.mSurface->GetBase() );
 
             if (grad->spreadMethod!=smPad)
@@ -282,9 +287,13 @@ public:
             GraphicsBitmapFill *bmp = inFill->AsBitmapFill();
             mTextureMapper = bmp->matrix.Inverse();
             mElement.mSurface = bmp->bitmapData->IncRef();
-            mTexture = mElement.mSurface->GetTexture(&inHardware);
             if (bmp->repeat)
+            {
+               mTexture = mElement.mSurface->GetOwnTexture(&inHardware);
                mElement.mFlags |= DRAW_BMP_REPEAT;
+            }
+            else
+               mTexture = mElement.mSurface->GetTexture(&inHardware);
             if (bmp->smooth)
                mElement.mFlags |= DRAW_BMP_SMOOTH;
           }
@@ -436,7 +445,8 @@ public:
    {
 
       UserPoint *vertices = (UserPoint *)&data.mArray[mElement.mVertexOffset];
-      UserPoint *tex = (mElement.mFlags & DRAW_HAS_TEX) && !FULL ? (UserPoint *)&data.mArray[ mElement.mTexOffset ] : 0;
+      UserPoint *tex = (mElement.mFlags & DRAW_HAS_TEX) && mElement.mPrimType==ptQuads ?
+                          (UserPoint *)&data.mArray[ mElement.mTexOffset ] : 0;
       int *colours = COL ? (int *)&data.mArray[ mElement.mColourOffset ] : 0;
       bool premultiplyAlpha = mElement.mSurface &&
                               (mElement.mSurface->GetFlags() & surfUsePremultipliedAlpha);
@@ -454,8 +464,16 @@ public:
       if (bmpSize.x==0 || bmpSize.y==0)
          bmpSize = UserPoint(1,1);
 
-      double texScaleX = 1.0/bmpSize.x;
-      double texScaleY = 1.0/bmpSize.y;
+      // Pixels map linearly into the texture, which may be a rect in an atlas page
+      UserPoint texOrigin = mTexture->PixelToTex( UserPoint(0,0) );
+      UserPoint texEnd = mTexture->PixelToTex(bmpSize);
+      double texScaleX = (texEnd.x-texOrigin.x)/bmpSize.x;
+      double texScaleY = (texEnd.y-texOrigin.y)/bmpSize.y;
+      if (FULL)
+      {
+         tex0 = texOrigin;
+         tex1 = texEnd;
+      }
 
       /*
         Opengl is very clear when it comes to how pixels & textures are sampled.
@@ -486,24 +504,24 @@ public:
 
             if (tileSize.x<0)
             {
-               tex0.x = (tileOrigin.x ) * texScaleX - texTol;
-               tex1.x = (tileOrigin.x + tileSize.x ) * texScaleX + texTol;
+               tex0.x = texOrigin.x + (tileOrigin.x ) * texScaleX - texTol;
+               tex1.x = texOrigin.x + (tileOrigin.x + tileSize.x ) * texScaleX + texTol;
             }
             else
             {
-               tex0.x = (tileOrigin.x ) * texScaleX + texTol;
-               tex1.x = (tileOrigin.x + tileSize.x ) * texScaleX - texTol;
+               tex0.x = texOrigin.x + (tileOrigin.x ) * texScaleX + texTol;
+               tex1.x = texOrigin.x + (tileOrigin.x + tileSize.x ) * texScaleX - texTol;
             }
 
             if (tileSize.y<0)
             {
-               tex0.y = (tileOrigin.y ) * texScaleY - texTol;
-               tex1.y = (tileOrigin.y + tileSize.y ) * texScaleY + texTol;
+               tex0.y = texOrigin.y + (tileOrigin.y ) * texScaleY - texTol;
+               tex1.y = texOrigin.y + (tileOrigin.y + tileSize.y ) * texScaleY + texTol;
             }
             else
             {
-               tex0.y = (tileOrigin.y ) * texScaleY + texTol;
-               tex1.y = (tileOrigin.y + tileSize.y ) * texScaleY - texTol;
+               tex0.y = texOrigin.y + (tileOrigin.y ) * texScaleY + texTol;
+               tex1.y = texOrigin.y + (tileOrigin.y + tileSize.y ) * texScaleY - texTol;
             }
          }
 
@@ -543,7 +561,7 @@ public:
          }
 
 
-         if (!FULL)
+         if (tex)
          {
             *tex = tex0;
             Next(tex);
@@ -645,6 +663,8 @@ public:
          data.mElements.push_back(mElement);
          if (mElement.mSurface)
             mElement.mSurface->IncRef();
+         if (mTexture && mTexture->GetAtlasPage())
+            data.mAtlasVersion = gTextureAtlasVersion;
       }
    }
 
@@ -1987,6 +2007,8 @@ void CreatePointJob(const GraphicsJob &inJob,const GraphicsPath &inPath,Hardware
 void BuildHardwareJob(const GraphicsJob &inJob,const GraphicsPath &inPath,HardwareData &ioData,
                       HardwareRenderer &inHardware, const RenderState &inState)
 {
+   NME_PROFILE_ZONE("BuildHardwareJob");
+   ProfileCount(pcTessellations);
    ioData.releaseVbo();
 
    if (inJob.mIsPointJob)
@@ -2006,6 +2028,7 @@ HardwareData::HardwareData()
    mContextId = 0;
    mVboOwner = 0;
    mMinScale = mMaxScale = 0.0;
+   mAtlasVersion = 0;
 }
 
 void HardwareData::releaseVbo()
@@ -2050,6 +2073,8 @@ bool HardwareData::isScaleOk(const RenderState &inState) const
 
 void HardwareData::clear()
 {
+   if (HardwareRenderer::current)
+      HardwareRenderer::current->ForgetData(this);
    releaseVbo();
    for(int i=0;i<mElements.size();i++)
       if (mElements[i].mSurface)
@@ -2057,7 +2082,9 @@ void HardwareData::clear()
 
    mArray.resize(0);
    mElements.resize(0);
+   mElementExtents.resize(0);
    mMinScale = mMaxScale = 0.0;
+   mAtlasVersion = 0;
 }
 
 HardwareData::~HardwareData()
@@ -2065,6 +2092,33 @@ HardwareData::~HardwareData()
    clear();
 }
 
+const Extent2DF &HardwareData::getElementExtent(int inElement) const
+{
+   int have = mElementExtents.size();
+   if (have<mElements.size())
+   {
+      mElementExtents.resize(mElements.size());
+      for(int i=have;i<mElementExtents.size();i++)
+         mElementExtents[i].mCount = -1;
+   }
+
+   DrawElementExtent &cache = mElementExtents[inElement];
+   const DrawElement &draw = mElements[inElement];
+   if (cache.mCount!=draw.mCount || cache.mVertexOffset!=draw.mVertexOffset)
+   {
+      cache.mExtent = Extent2DF();
+      if (draw.mCount>0)
+      {
+         const uint8 *v = &mArray[draw.mVertexOffset];
+         for(int i=0;i<draw.mCount;i++)
+            cache.mExtent.Add( *(const UserPoint *)(v + i*draw.mStride) );
+      }
+      cache.mCount = draw.mCount;
+      cache.mVertexOffset = draw.mVertexOffset;
+   }
+   return cache.mExtent;
+}
+
 
 // --- HardwareRenderer -----------------------------
 
@@ -2076,6 +2130,13 @@ double sLineScaleH = -1;
 double sLineScaleNormal = -1;
 
 
+static inline bool NearExtent(const Extent2DF &inExtent,const UserPoint &inPos,double inDist)
+{
+   return inExtent.Valid() &&
+          inPos.x>=inExtent.minX-inDist && inPos.x<=inExtent.maxX+inDist &&
+          inPos.y>=inExtent.minY-inDist && inPos.y<=inExtent.maxY+inDist;
+}
+
 inline bool HitTri(const UserPoint &base, const UserPoint &_v0, const UserPoint &_v1, const UserPoint &pos)
 {
    bool bgx = pos.x>base.x;
@@ -2134,7 +2195,6 @@ bool HardwareRenderer::Hits(const RenderState &inState, const HardwareData &inDa
    }
 
 
-      // TODO: include extent in HardwareArrays
       const DrawElements &elements = inData.mElements;
       for(int e=0;e<elements.size();e++)
       {
@@ -2175,6 +2235,9 @@ bool HardwareRenderer::Hits(const RenderState &inState, const HardwareData &inDa
                   break;
             }
 
+            if (!NearExtent(inData.getElementExtent(e),pos,width))
+               continue;
+
             double x0 = pos.x - width;
             double x1 = pos.x + width;
             double y0 = pos.y - width;
@@ -2221,7 +2284,7 @@ bool HardwareRenderer::Hits(const RenderState &inState, const HardwareData &inDa
          }
          else if (draw.mPrimType == ptTriangleFan)
          {
-            if (draw.mCount<3)
+            if (draw.mCount<3 || !NearExtent(inData.getElementExtent(e),pos,0))
                continue;
             UserPoint p0 = V(0);
             int count_left = 0;
@@ -2243,7 +2306,7 @@ bool HardwareRenderer::Hits(const RenderState &inState, const HardwareData &inDa
          }
          else if (draw.mPrimType == ptTriangles)
          {
-            if (draw.mCount<3)
+            if (draw.mCount<3 || !NearExtent(inData.getElementExtent(e),pos,0))
                continue;
 
             int numTriangles = draw.mCount / 3;
@@ -2260,6 +2323,8 @@ bool HardwareRenderer::Hits(const RenderState &inState, const HardwareData &inDa
          }
          else if (draw.mPrimType == ptTriangleStrip)
          {
+            if (!NearExtent(inData.getElementExtent(e),pos,0))
+               continue;
             for(int i=2;i<draw.mCount;i++)
             {
                if (HitTri(V(i-2), V(i-2),V(i), pos ))
@@ -1,6 +1,7 @@
 #include <Lzma.h>
 #include "../lzma/LzmaEnc.h"
 #include "../lzma/LzmaDec.h"
+#include <string.h>
 
 namespace nme
 {
@@ -28,55 +29,47 @@ namespace nme
 		}
 	}
 
-	void Lzma::Encode(buffer input_buffer, buffer output_buffer)
+	static ISzAlloc sgAlloc = { lzma_Alloc, lzma_Free };
+
+	// Writes the props, the 64 bit decoded size, and then the stream
+	static bool EncodeToMemory(const Byte *input_data, SizeT input_size, QuickVec<unsigned char> &output, ICompressProgress *progress)
 	{
-		SizeT  input_buffer_size = buffer_size(input_buffer);
-		Byte*  input_buffer_data = (Byte *)buffer_data(input_buffer);
-		SizeT  output_buffer_size = input_buffer_size + 1024;
-		Byte*  output_buffer_data = (Byte *)malloc(output_buffer_size);
-		SizeT  props_size = 100;
-		Byte*  props_data = (Byte *)malloc(props_size);
-		Int64  uncompressed_length = input_buffer_size;
-		CLzmaEncProps props = {0};
+		CLzmaEncProps props;
 		LzmaEncProps_Init(&props);
 		//props.level = 9;
 		//props.dictSize = (1 << 24);
 		//props.dictSize = (1 << 16);
-		//props.dictSize = (1 << 10);
 		props.dictSize = (1 << 20);
-		/*
-		props.lc = 8;
-		props.lp = 0;
-		props.pb = 2;
-		props.algo = 1;
-		props.fb = 273;
-		props.btMode = 1;
-		props.numHashBytes = 4;
-		props.mc = 32;
-		*/
 		props.writeEndMark = 0;
 		props.numThreads = 1;
-		
-		ICompressProgress progress = { lzma_Progress };
-		ISzAlloc alloc_small = { lzma_Alloc, lzma_Free };
-		ISzAlloc alloc_big = { lzma_Alloc, lzma_Free };
 
-		LzmaEncode(
-			output_buffer_data, &output_buffer_size,
-			input_buffer_data, input_buffer_size,
-			&props, props_data, &props_size, props.writeEndMark,
-			&progress, &alloc_small, &alloc_big
+		// Data that does not compress grows a little
+		SizeT output_size = input_size + input_size / 16 + 1024;
+		output.resize(LZMA_PROPS_SIZE + 8 + output_size);
+		SizeT props_size = LZMA_PROPS_SIZE;
+
+		SRes result = LzmaEncode(
+			&output[LZMA_PROPS_SIZE + 8], &output_size,
+			input_data, input_size,
+			&props, &output[0], &props_size, props.writeEndMark,
+			progress, &sgAlloc, &sgAlloc
 		);
-		
-		unsigned char le_size[8];
-		WRITE_LE64(&le_size[0], uncompressed_length);
-		
-		buffer_append_sub(output_buffer, (const char *)props_data, props_size);
-		buffer_append_sub(output_buffer, (const char *)le_size, 8);
-		buffer_append_sub(output_buffer, (const char *)output_buffer_data, output_buffer_size);
-		
-		free(props_data);
-		free(output_buffer_data);
+
+		WRITE_LE64(&output[LZMA_PROPS_SIZE], input_size);
+		output.resize(LZMA_PROPS_SIZE + 8 + output_size);
+		return result == SZ_OK;
+	}
+
+	void Lzma::Encode(buffer input_buffer, buffer output_buffer)
+	{
+		SizeT  input_buffer_size = buffer_size(input_buffer);
+		Byte*  input_buffer_data = (Byte *)buffer_data(input_buffer);
+		ICompressProgress progress = { lzma_Progress };
+
+		QuickVec<unsigned char> output;
+		EncodeToMemory(input_buffer_data, input_buffer_size, output, &progress);
+
+		buffer_append_sub(output_buffer, (const char *)&output[0], output.size());
 	}
 
 	void Lzma::Decode(buffer input_buffer, buffer output_buffer)
@@ -110,4 +103,240 @@ namespace nme
 		
 		free(output_buffer_data);
 	}
+
+	int Lzma::DecodedSize(const unsigned char *input_data, int input_size)
+	{
+		if (!input_data || input_size < LZMA_PROPS_SIZE + 8)
+			return -1;
+		UInt64 uncompressed_length = READ_LE64((unsigned char *)input_data + LZMA_PROPS_SIZE);
+		if (uncompressed_length > 0x7fffffff)
+			return -1;
+		return (int)uncompressed_length;
+	}
+
+	bool Lzma::Decode(const unsigned char *input_data, int input_size, unsigned char *output_data, int output_size)
+	{
+		if (DecodedSize(input_data, input_size) != output_size)
+			return false;
+
+		ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+		ISzAlloc alloc = { lzma_Alloc, lzma_Free };
+
+		SizeT output_buffer_size = output_size;
+		SizeT stream_size = input_size - LZMA_PROPS_SIZE - 8;
+
+		SRes result = LzmaDecode(
+			output_data, &output_buffer_size,
+			input_data + LZMA_PROPS_SIZE + 8, &stream_size,
+			input_data, LZMA_PROPS_SIZE,
+			LZMA_FINISH_ANY,
+			&status, &alloc
+		);
+
+		return result == SZ_OK && output_buffer_size == (SizeT)output_size;
+	}
+
+	// --- LzmaDecoder ---
+
+	struct LzmaDecoder::State
+	{
+		CLzmaDec dec;
+	};
+
+	LzmaDecoder::LzmaDecoder() :
+		mState(0), mInputPos(0), mTotalSize(-1), mDecodedSize(0), mError(false)
+	{
+	}
+
+	LzmaDecoder::~LzmaDecoder()
+	{
+		if (mState)
+		{
+			LzmaDec_Free(&mState->dec, &sgAlloc);
+			delete mState;
+		}
+	}
+
+	void LzmaDecoder::Feed(const unsigned char *input_data, int input_size)
+	{
+		if (!input_data || input_size <= 0 || mError)
+			return;
+
+		// Drop the input already decoded, rather than letting the buffer grow
+		if (mInputPos > 0 && mInputPos * 2 >= mInput.size())
+		{
+			int left = mInput.size() - mInputPos;
+			if (left)
+				memmove(&mInput[0], &mInput[mInputPos], left);
+			mInput.resize(left);
+			mInputPos = 0;
+		}
+
+		int old_size = mInput.size();
+		mInput.resize(old_size + input_size);
+		memcpy(&mInput[old_size], input_data, input_size);
+	}
+
+	bool LzmaDecoder::ReadHeader()
+	{
+		const int header_size = LZMA_PROPS_SIZE + 8;
+		if (mInput.size() - mInputPos < header_size)
+			return false;
+
+		const unsigned char *header = &mInput[mInputPos];
+		int total_size = Lzma::DecodedSize(header, header_size);
+
+		mState = new State;
+		LzmaDec_Construct(&mState->dec);
+		if (total_size < 0 || LzmaDec_Allocate(&mState->dec, header, LZMA_PROPS_SIZE, &sgAlloc) != SZ_OK)
+		{
+			mError = true;
+			return false;
+		}
+		LzmaDec_Init(&mState->dec);
+
+		mInputPos += header_size;
+		mTotalSize = total_size;
+		return true;
+	}
+
+	int LzmaDecoder::Read(unsigned char *output_data, int output_size)
+	{
+		if (mError)
+			return -1;
+		if (mTotalSize < 0 && !ReadHeader())
+			return mError ? -1 : 0;
+
+		int wanted = mTotalSize - mDecodedSize;
+		if (wanted > output_size)
+			wanted = output_size;
+		if (wanted <= 0)
+			return 0;
+
+		SizeT dest_len = wanted;
+		SizeT src_len = mInput.size() - mInputPos;
+		const Byte *src = src_len ? &mInput[mInputPos] : 0;
+		ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+
+		SRes result = LzmaDec_DecodeToBuf(&mState->dec, output_data, &dest_len, src, &src_len, LZMA_FINISH_ANY, &status);
+		mInputPos += src_len;
+		mDecodedSize += dest_len;
+
+		// A bad stream, or one that ended before the size in its header
+		if (result != SZ_OK || (dest_len == 0 && status == LZMA_STATUS_FINISHED_WITH_MARK))
+		{
+			mError = true;
+			return -1;
+		}
+		return dest_len;
+	}
+
+	// --- LzmaTask ---
+
+	struct TaskProgress
+	{
+		ICompressProgress base;
+		volatile float    *progress;
+		UInt64            total;
+	};
+
+	extern "C" {
+		SRes lzma_TaskProgress(void *p, UInt64 inSize, UInt64 outSize) {
+			TaskProgress *task = (TaskProgress *)p;
+			if (task->total && inSize != (UInt64)(Int64)-1)
+				*task->progress = (float)((double)inSize / task->total);
+			return SZ_OK;
+		}
+	}
+
+	LzmaTask::LzmaTask(bool encode) : mEncode(encode), mOk(false), mProgress(0)
+	{
+	}
+
+	LzmaTask::~LzmaTask()
+	{
+		// A queued task still uses our buffers
+		WaitWorkerTask(this);
+	}
+
+	LzmaTask *LzmaTask::Create(bool encode, const unsigned char *input_data, int input_size)
+	{
+		LzmaTask *task = new LzmaTask(encode);
+		if (input_data && input_size > 0)
+		{
+			task->mInput.resize(input_size);
+			memcpy(&task->mInput[0], input_data, input_size);
+		}
+		QueueWorkerTask(task);
+		return task;
+	}
+
+	bool LzmaTask::IsDone()
+	{
+		return IsWorkerTaskDone(this);
+	}
+
+	bool LzmaTask::GetResult(const unsigned char *&output_data, int &output_size)
+	{
+		WaitWorkerTask(this);
+		output_data = mOutput.size() ? &mOutput[0] : 0;
+		output_size = mOutput.size();
+		return mOk;
+	}
+
+	// On a worker thread - only our own members may be touched
+	void LzmaTask::RunTask(int index)
+	{
+		const Byte *input_data = mInput.size() ? &mInput[0] : 0;
+		int input_size = mInput.size();
+
+		if (mEncode)
+		{
+			TaskProgress progress = { { lzma_TaskProgress }, &mProgress, (UInt64)input_size };
+			mOk = EncodeToMemory(input_data, input_size, mOutput, &progress.base);
+		}
+		else
+		{
+			int total_size = Lzma::DecodedSize(input_data, input_size);
+			mOk = total_size >= 0;
+			if (mOk)
+			{
+				mOutput.resize(total_size);
+
+				CLzmaDec dec;
+				LzmaDec_Construct(&dec);
+				mOk = LzmaDec_Allocate(&dec, input_data, LZMA_PROPS_SIZE, &sgAlloc) == SZ_OK;
+				if (mOk)
+				{
+					LzmaDec_Init(&dec);
+
+					// In pieces, so the progress can be seen
+					const int piece = 1 << 18;
+					SizeT in_pos = LZMA_PROPS_SIZE + 8;
+					int out_pos = 0;
+					while (out_pos < total_size)
+					{
+						SizeT dest_len = total_size - out_pos < piece ? total_size - out_pos : piece;
+						SizeT src_len = input_size - in_pos;
+						ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+						SRes result = LzmaDec_DecodeToBuf(&dec, &mOutput[out_pos], &dest_len,
+						                  input_data + in_pos, &src_len, LZMA_FINISH_ANY, &status);
+						if (result != SZ_OK || dest_len == 0)
+							break;
+						in_pos += src_len;
+						out_pos += dest_len;
+						mProgress = (float)out_pos / total_size;
+					}
+					mOk = out_pos == total_size;
+				}
+				LzmaDec_Free(&dec, &sgAlloc);
+			}
+			if (!mOk)
+				mOutput.resize(0);
+		}
+
+		QuickVec<unsigned char> empty;
+		mInput.swap(empty);
+		mProgress = 1.0f;
+	}
 }
@@ -0,0 +1,262 @@
+#include <MappedFile.h>
+#include <ByteArray.h>
+#include <AssetPack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HX_WINDOWS) && !defined(HX_WINRT)
+  #include <windows.h>
+  #define NME_MAP_WIN32
+#elif !defined(HX_WINDOWS) && !defined(EMSCRIPTEN) && !defined(EPPC)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define NME_MAP_POSIX
+#endif
+
+#ifdef ANDROID
+#include <android/asset_manager.h>
+#endif
+
+namespace nme
+{
+
+#ifdef ANDROID
+AAsset *AndroidGetAsset(const char *inResource);
+#endif
+
+// Files this big would not fit the int sizes used by the decoders
+static const long long sgMaxSize = 0x7fffffff;
+
+MappedFile::MappedFile() :
+   Object(true), mData(0), mSize(0), mHeap(0), mMapBase(0), mMapLength(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+   if (mMapBase)
+   {
+      #if defined(NME_MAP_WIN32)
+      UnmapViewOfFile(mMapBase);
+      #elif defined(NME_MAP_POSIX)
+      munmap(mMapBase,mMapLength);
+      #endif
+   }
+   free(mHeap);
+}
+
+MappedFile *MappedFile::View(const unsigned char *inData, int inLen)
+{
+   MappedFile *result = new MappedFile();
+   result->mData = inData;
+   result->mSize = inLen;
+   return result;
+}
+
+MappedFile *MappedFile::Alloc(int inLen)
+{
+   MappedFile *result = new MappedFile();
+   if (inLen>0)
+   {
+      result->mHeap = (unsigned char *)malloc(inLen);
+      if (!result->mHeap)
+      {
+         result->DecRef();
+         return 0;
+      }
+      result->mData = result->mHeap;
+      result->mSize = inLen;
+   }
+   return result;
+}
+
+MappedFile *MappedFile::FromBytes(const unsigned char *inBytes, int inLen)
+{
+   MappedFile *result = Alloc(inBytes ? inLen : 0);
+   if (result && result->mSize)
+      memcpy(result->mHeap,inBytes,inLen);
+   return result;
+}
+
+// Takes ownership of the file
+MappedFile *MappedFile::ReadAll(FILE *inFile)
+{
+   fseek(inFile,0,SEEK_END);
+   long len = ftell(inFile);
+   fseek(inFile,0,SEEK_SET);
+
+   MappedFile *result = 0;
+   if (len>=0 && len<=sgMaxSize)
+   {
+      result = new MappedFile();
+      if (len>0)
+      {
+         result->mHeap = (unsigned char *)malloc(len);
+         if (result->mHeap && fread(result->mHeap,len,1,inFile)==1)
+         {
+            result->mData = result->mHeap;
+            result->mSize = (int)len;
+         }
+         else
+         {
+            result->DecRef();
+            result = 0;
+         }
+      }
+   }
+   fclose(inFile);
+   return result;
+}
+
+// The offset need not be page aligned, which allows mapping a part of an archive
+bool MappedFile::MapRange(int inFd, long long inOffset, long long inLength)
+{
+   #ifdef NME_MAP_POSIX
+   if (inLength<=0 || inLength>sgMaxSize || inOffset<0)
+      return false;
+
+   long long page = sysconf(_SC_PAGESIZE);
+   long long base = page>0 ? inOffset - inOffset%page : inOffset;
+   size_t length = (size_t)(inLength + inOffset - base);
+   void *ptr = mmap(0, length, PROT_READ, MAP_PRIVATE, inFd, (off_t)base);
+   if (ptr==MAP_FAILED)
+      return false;
+
+   mMapBase = ptr;
+   mMapLength = length;
+   mData = (const unsigned char *)ptr + (inOffset-base);
+   mSize = (int)inLength;
+   return true;
+   #else
+   return false;
+   #endif
+}
+
+
+MappedFile *MappedFile::Open(const OSChar *inFilename)
+{
+   MappedFile *packed = AssetPack::Open(inFilename);
+   if (packed)
+      return packed;
+
+   #if defined(NME_MAP_WIN32)
+   HANDLE file = CreateFileW(inFilename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, 0);
+   if (file!=INVALID_HANDLE_VALUE)
+   {
+      MappedFile *result = 0;
+      LARGE_INTEGER size;
+      if (GetFileSizeEx(file,&size) && size.QuadPart<=sgMaxSize)
+      {
+         if (size.QuadPart==0)
+            result = new MappedFile();
+         else
+         {
+            HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+            if (mapping)
+            {
+               // The view keeps the file open
+               void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+               CloseHandle(mapping);
+               if (base)
+               {
+                  result = new MappedFile();
+                  result->mMapBase = base;
+                  result->mMapLength = (size_t)size.QuadPart;
+                  result->mData = (const unsigned char *)base;
+                  result->mSize = (int)size.QuadPart;
+               }
+            }
+         }
+      }
+      CloseHandle(file);
+      if (result)
+         return result;
+   }
+   #endif
+
+   // OpenRead knows where the platform keeps its files, so map through its descriptor
+   FILE *file = OpenRead(inFilename);
+   if (file)
+   {
+      #ifdef NME_MAP_POSIX
+      struct stat info;
+      int fd = fileno(file);
+      if (fstat(fd,&info)==0 && S_ISREG(info.st_mode) && info.st_size>0)
+      {
+         MappedFile *result = new MappedFile();
+         if (result->MapRange(fd,0,info.st_size))
+         {
+            fclose(file);
+            return result;
+         }
+         result->DecRef();
+      }
+      #endif
+      return ReadAll(file);
+   }
+
+   #ifdef ANDROID
+   // Uncompressed assets can be mapped straight out of the apk
+   AAsset *asset = AndroidGetAsset(inFilename);
+   if (asset)
+   {
+      MappedFile *result = 0;
+      off_t offset = 0;
+      off_t length = 0;
+      int fd = AAsset_openFileDescriptor(asset, &offset, &length);
+      if (fd>=0)
+      {
+         result = new MappedFile();
+         if (!result->MapRange(fd,offset,length))
+         {
+            result->DecRef();
+            result = 0;
+         }
+         close(fd);
+      }
+      if (!result)
+      {
+         long size = AAsset_getLength(asset);
+         if (size>=0 && size<=sgMaxSize)
+         {
+            result = new MappedFile();
+            if (size>0)
+            {
+               result->mHeap = (unsigned char *)malloc(size);
+               if (result->mHeap && AAsset_read(asset, result->mHeap, size)==size)
+               {
+                  result->mData = result->mHeap;
+                  result->mSize = (int)size;
+               }
+               else
+               {
+                  result->DecRef();
+                  result = 0;
+               }
+            }
+         }
+      }
+      AAsset_close(asset);
+      return result;
+   }
+
+   ByteArray bytes = AndroidGetAssetBytes(inFilename);
+   if (bytes.Ok())
+      return FromBytes(bytes.Bytes(), bytes.Size());
+   #endif
+
+   return 0;
+}
+
+#ifdef HX_WINDOWS
+MappedFile *MappedFile::Open(const char *inUtf8Filename)
+{
+   WString wide = UTF8ToWide(inUtf8Filename);
+   return Open( wide.c_str() );
+}
+#endif
+
+} // end namespace nme
@@ -0,0 +1,305 @@
+#include <Display.h>
+#include <Tilesheet.h>
+#include <Surface.h>
+#include <NMEThread.h>
+#include <Profile.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+   #define NME_PARTICLE_SSE
+   #include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+   #define NME_PARTICLE_NEON
+   #include <arm_neon.h>
+#endif
+
+namespace nme
+{
+
+// x,y, rect x,y,w,h, 2x2 transform, r,g,b,a - see GraphicsPath::qtile
+enum { TILE_FLOATS = 14 };
+
+// Longer gaps, such as after a pause, are simulated as this much time
+static const double sMaxStep = 0.25;
+
+
+// The particle state is kept as one array per value, padded to a multiple of 4, so the
+//  motion of 4 particles is worked out at once.  Everything here is touched only by the step
+//  (which may be on a worker thread) or by the main thread while no step is running.
+class ParticleSystem : public WorkerTask
+{
+public:
+   ParticleSystem(int inMaxParticles) : mCount(0), mEmitAccum(0), mSeed(0x2545f491), mStepSeconds(0), mStepBurst(0), mClear(false)
+   {
+      mMax = inMaxParticles<0 ? 0 : inMaxParticles;
+      int padded = (mMax+3) & ~3;
+      QuickVec<float> *arrays[] = { &mX, &mY, &mVX, &mVY, &mRot, &mSpin, &mAge, &mLife };
+      for(int a=0;a<8;a++)
+      {
+         arrays[a]->resize(padded);
+         if (padded)
+            memset(&(*arrays[a])[0], 0, padded*sizeof(float));
+      }
+      mTiles.reserve(mMax*TILE_FLOATS);
+      memset(mSettings,0,sizeof(mSettings));
+      memset(mTileRect,0,sizeof(mTileRect));
+   }
+
+   void RunTask(int)
+   {
+      double dt = mStepSeconds;
+      if (mClear)
+      {
+         mCount = 0;
+         mEmitAccum = 0;
+      }
+      if (dt>0)
+         Move((float)dt);
+      Expire();
+
+      mEmitAccum += mSettings[psRate]*dt;
+      int spawn = (int)mEmitAccum;
+      mEmitAccum -= spawn;
+      Spawn(spawn + mStepBurst);
+
+      BuildTiles();
+   }
+
+   void Move(float dt)
+   {
+      float gx = mSettings[psGravityX]*dt;
+      float gy = mSettings[psGravityY]*dt;
+      float damp = mSettings[psDamping]>0 ? (float)exp(-mSettings[psDamping]*dt) : 1.0f;
+      int n = (mCount+3) & ~3;
+
+      float *x = n ? &mX[0] : 0;
+      float *y = n ? &mY[0] : 0;
+      float *vx = n ? &mVX[0] : 0;
+      float *vy = n ? &mVY[0] : 0;
+      float *rot = n ? &mRot[0] : 0;
+      const float *spin = n ? &mSpin[0] : 0;
+      float *age = n ? &mAge[0] : 0;
+
+      #if defined(NME_PARTICLE_SSE)
+      __m128 t = _mm_set1_ps(dt);
+      __m128 g_x = _mm_set1_ps(gx);
+      __m128 g_y = _mm_set1_ps(gy);
+      __m128 d = _mm_set1_ps(damp);
+      for(int i=0;i<n;i+=4)
+      {
+         __m128 v_x = _mm_mul_ps( _mm_add_ps(_mm_loadu_ps(vx+i),g_x), d );
+         __m128 v_y = _mm_mul_ps( _mm_add_ps(_mm_loadu_ps(vy+i),g_y), d );
+         _mm_storeu_ps(vx+i, v_x);
+         _mm_storeu_ps(vy+i, v_y);
+         _mm_storeu_ps(x+i, _mm_add_ps(_mm_loadu_ps(x+i), _mm_mul_ps(v_x,t)) );
+         _mm_storeu_ps(y+i, _mm_add_ps(_mm_loadu_ps(y+i), _mm_mul_ps(v_y,t)) );
+         _mm_storeu_ps(rot+i, _mm_add_ps(_mm_loadu_ps(rot+i), _mm_mul_ps(_mm_loadu_ps(spin+i),t)) );
+         _mm_storeu_ps(age+i, _mm_add_ps(_mm_loadu_ps(age+i), t) );
+      }
+      #elif defined(NME_PARTICLE_NEON)
+      float32x4_t t = vdupq_n_f32(dt);
+      float32x4_t g_x = vdupq_n_f32(gx);
+      float32x4_t g_y = vdupq_n_f32(gy);
+      float32x4_t d = vdupq_n_f32(damp);
+      for(int i=0;i<n;i+=4)
+      {
+         float32x4_t v_x = vmulq_f32( vaddq_f32(vld1q_f32(vx+i),g_x), d );
+         float32x4_t v_y = vmulq_f32( vaddq_f32(vld1q_f32(vy+i),g_y), d );
+         vst1q_f32(vx+i, v_x);
+         vst1q_f32(vy+i, v_y);
+         vst1q_f32(x+i, vmlaq_f32(vld1q_f32(x+i), v_x, t) );
+         vst1q_f32(y+i, vmlaq_f32(vld1q_f32(y+i), v_y, t) );
+         vst1q_f32(rot+i, vmlaq_f32(vld1q_f32(rot+i), vld1q_f32(spin+i), t) );
+         vst1q_f32(age+i, vaddq_f32(vld1q_f32(age+i), t) );
+      }
+      #else
+      for(int i=0;i<n;i++)
+      {
+         vx[i] = (vx[i]+gx)*damp;
+         vy[i] = (vy[i]+gy)*damp;
+         x[i] += vx[i]*dt;
+         y[i] += vy[i]*dt;
+         rot[i] += spin[i]*dt;
+         age[i] += dt;
+      }
+      #endif
+   }
+
+   // Order does not matter, so the last particle fills each gap
+   void Expire()
+   {
+      int i = 0;
+      while(i<mCount)
+      {
+         if (mAge[i]>=mLife[i])
+         {
+            int last = --mCount;
+            mX[i] = mX[last];
+            mY[i] = mY[last];
+            mVX[i] = mVX[last];
+            mVY[i] = mVY[last];
+            mRot[i] = mRot[last];
+            mSpin[i] = mSpin[last];
+            mAge[i] = mAge[last];
+            mLife[i] = mLife[last];
+         }
+         else
+            i++;
+      }
+   }
+
+   void Spawn(int inCount)
+   {
+      if (inCount>mMax-mCount)
+         inCount = mMax-mCount;
+
+      const float *s = mSettings;
+      for(int n=0;n<inCount;n++)
+      {
+         int i = mCount++;
+         mX[i] = s[psX] + s[psSpreadX]*(Random()*2-1);
+         mY[i] = s[psY] + s[psSpreadY]*(Random()*2-1);
+         double angle = s[psAngle] + s[psAngleSpread]*(Random()-0.5);
+         double speed = s[psSpeed] + s[psSpeedVariance]*(Random()*2-1);
+         mVX[i] = (float)(cos(angle)*speed);
+         mVY[i] = (float)(sin(angle)*speed);
+         mRot[i] = 0;
+         mSpin[i] = s[psSpin] + s[psSpinVariance]*(Random()*2-1);
+         mAge[i] = 0;
+         float life = s[psLife] + s[psLifeVariance]*(Random()*2-1);
+         mLife[i] = life>0.001f ? life : 0.001f;
+      }
+   }
+
+   void BuildTiles()
+   {
+      const float *s = mSettings;
+      float w = mTileRect[2];
+      float h = mTileRect[3];
+      // Drawn centred on the particle
+      float ox = w*0.5f;
+      float oy = h*0.5f;
+
+      mTiles.resize(mCount*TILE_FLOATS);
+      float *tile = mCount ? &mTiles[0] : 0;
+      for(int i=0;i<mCount;i++)
+      {
+         float f = mAge[i]/mLife[i];
+         float scale = s[psStartScale] + (s[psEndScale]-s[psStartScale])*f;
+         float c = (float)cos(mRot[i])*scale;
+         float sn = (float)sin(mRot[i])*scale;
+
+         tile[0] = mX[i] - (ox*c - oy*sn);
+         tile[1] = mY[i] - (ox*sn + oy*c);
+         tile[2] = mTileRect[0];
+         tile[3] = mTileRect[1];
+         tile[4] = w;
+         tile[5] = h;
+         tile[6] = c;
+         tile[7] = sn;
+         tile[8] = -sn;
+         tile[9] = c;
+         for(int ch=0;ch<4;ch++)
+            tile[10+ch] = s[psStartR+ch] + (s[psEndR+ch]-s[psStartR+ch])*f;
+         tile += TILE_FLOATS;
+      }
+   }
+
+   // xorshift - the particles only need to look random
+   inline float Random()
+   {
+      mSeed ^= mSeed << 13;
+      mSeed ^= mSeed >> 17;
+      mSeed ^= mSeed << 5;
+      return (mSeed & 0xffffff) * (1.0f/16777216.0f);
+   }
+
+   int             mMax;
+   int             mCount;
+   double          mEmitAccum;
+   unsigned int    mSeed;
+   QuickVec<float> mX, mY, mVX, mVY, mRot, mSpin, mAge, mLife;
+   QuickVec<float> mTiles;
+
+   // Set by the main thread before each step
+   float           mSettings[psSIZE];
+   float           mTileRect[4];
+   double          mStepSeconds;
+   int             mStepBurst;
+   bool            mClear;
+};
+
+
+// --- ParticleEmitter ------------------------------------------------
+
+ParticleEmitter::ParticleEmitter(Tilesheet *inSheet, int inMaxParticles)
+{
+   mSheet = inSheet;
+   if (mSheet)
+      mSheet->IncRef();
+   mSystem = new ParticleSystem(inMaxParticles);
+   mBurst = 0;
+   mClear = false;
+   mDrawnCount = 0;
+}
+
+ParticleEmitter::~ParticleEmitter()
+{
+   // A step may still be using the system
+   WaitWorkerTask(mSystem);
+   delete mSystem;
+   if (mSheet)
+      mSheet->DecRef();
+}
+
+void ParticleEmitter::Update(double inSeconds, const float *inSettings)
+{
+   NME_PROFILE_ZONE("ParticleEmitter::Update");
+
+   ParticleSystem &system = *mSystem;
+   WaitWorkerTask(&system);
+
+   // Draw the last step
+   Graphics &gfx = GetGraphics();
+   gfx.clear();
+   mDrawnCount = system.mTiles.size()/TILE_FLOATS;
+   if (mDrawnCount && mSheet)
+   {
+      BlendMode blend = system.mSettings[psAdditive]!=0 ? bmAdd : bmNormal;
+      gfx.beginTiles(&mSheet->GetSurface(), system.mSettings[psSmooth]!=0, blend,
+                     pcTile | pcTile_Trans_Bit | pcTile_Col_Bit, mDrawnCount);
+      GraphicsPath *path = gfx.getPath();
+      int d0 = path->data.size();
+      path->data.resize(d0 + mDrawnCount*TILE_FLOATS);
+      memcpy(&path->data[d0], &system.mTiles[0], mDrawnCount*TILE_FLOATS*sizeof(float));
+   }
+
+   // Start the next
+   memcpy(system.mSettings, inSettings, sizeof(system.mSettings));
+   int id = (int)inSettings[psTile];
+   if (mSheet && id>=0 && id<mSheet->Tiles())
+   {
+      const FRect &r = mSheet->GetTile(id).mFRect;
+      system.mTileRect[0] = r.x;
+      system.mTileRect[1] = r.y;
+      system.mTileRect[2] = r.w;
+      system.mTileRect[3] = r.h;
+   }
+   else if (mSheet)
+   {
+      system.mTileRect[0] = 0;
+      system.mTileRect[1] = 0;
+      system.mTileRect[2] = mSheet->GetSurface().Width();
+      system.mTileRect[3] = mSheet->GetSurface().Height();
+   }
+   system.mStepSeconds = inSeconds<0 ? 0 : inSeconds>sMaxStep ? sMaxStep : inSeconds;
+   system.mStepBurst = mBurst;
+   system.mClear = mClear;
+   mBurst = 0;
+   mClear = false;
+
+   QueueWorkerTask(&system);
+}
+
+} // end namespace nme
@@ -0,0 +1,141 @@
+#include <PixelPool.h>
+#include <NMEThread.h>
+#include <nme/QuickVec.h>
+#include <stdlib.h>
+
+namespace nme
+{
+
+// Smaller requests are not worth keeping, and bigger ones are always freed
+enum { MIN_BUCKET = 12, MAX_BUCKET = 28, BUCKETS = MAX_BUCKET+1 };
+
+// Frames a buffer may sit unused before it is trimmed
+static const int sgPixelPoolIdleFrames = 60;
+
+struct PooledBuffer
+{
+   unsigned char *data;
+   int           frame;
+};
+
+static NmeMutex                sgPixelPoolLock;
+static QuickVec<PooledBuffer>  sgPixelPool[BUCKETS];
+static int                     sgPixelPoolBudget = 32<<20;
+static int                     sgPixelPoolHeld = 0;
+static int                     sgPixelPoolFrame = 0;
+
+
+// The bucket holding buffers big enough for inBytes, or -1 if it should not be pooled
+static int PixelPoolBucket(int inBytes)
+{
+   if (inBytes < (1<<MIN_BUCKET))
+      return -1;
+   int bucket = MIN_BUCKET;
+   while( (1<<bucket) < inBytes )
+   {
+      if (++bucket>MAX_BUCKET)
+         return -1;
+   }
+   return bucket;
+}
+
+unsigned char *PixelPoolAlloc(int inBytes)
+{
+   int bucket = PixelPoolBucket(inBytes);
+   if (bucket<0)
+      return (unsigned char *)malloc(inBytes);
+
+   {
+      NmeAutoMutex lock(sgPixelPoolLock);
+      QuickVec<PooledBuffer> &pool = sgPixelPool[bucket];
+      if (pool.size())
+      {
+         sgPixelPoolHeld -= 1<<bucket;
+         // Most recently used first, since it is most likely to still be in the cache
+         return pool.qpop().data;
+      }
+   }
+   return (unsigned char *)malloc(1<<bucket);
+}
+
+void PixelPoolFree(unsigned char *inBuffer, int inBytes)
+{
+   if (!inBuffer)
+      return;
+
+   int bucket = PixelPoolBucket(inBytes);
+   if (bucket>=0)
+   {
+      NmeAutoMutex lock(sgPixelPoolLock);
+      if (sgPixelPoolHeld + (1<<bucket) <= sgPixelPoolBudget)
+      {
+         PooledBuffer buffer = { inBuffer, sgPixelPoolFrame };
+         sgPixelPool[bucket].push_back(buffer);
+         sgPixelPoolHeld += 1<<bucket;
+         return;
+      }
+   }
+   free(inBuffer);
+}
+
+void PixelPoolTrim()
+{
+   NmeAutoMutex lock(sgPixelPoolLock);
+   sgPixelPoolFrame++;
+   for(int b=MIN_BUCKET;b<BUCKETS;b++)
+   {
+      QuickVec<PooledBuffer> &pool = sgPixelPool[b];
+      // Oldest first
+      int keep = 0;
+      while(keep<pool.size() && sgPixelPoolFrame-pool[keep].frame > sgPixelPoolIdleFrames)
+         keep++;
+      if (keep)
+      {
+         for(int i=0;i<keep;i++)
+            free(pool[i].data);
+         pool.erase(0,keep);
+         sgPixelPoolHeld -= keep<<b;
+      }
+   }
+}
+
+// Called with sgPixelPoolLock held
+static void PixelPoolClearLocked()
+{
+   for(int b=MIN_BUCKET;b<BUCKETS;b++)
+   {
+      QuickVec<PooledBuffer> &pool = sgPixelPool[b];
+      for(int i=0;i<pool.size();i++)
+         free(pool[i].data);
+      pool.resize(0);
+   }
+   sgPixelPoolHeld = 0;
+}
+
+void PixelPoolClear()
+{
+   NmeAutoMutex lock(sgPixelPoolLock);
+   PixelPoolClearLocked();
+}
+
+void PixelPoolSetBudget(int inBytes)
+{
+   NmeAutoMutex lock(sgPixelPoolLock);
+   sgPixelPoolBudget = inBytes;
+   if (sgPixelPoolHeld>sgPixelPoolBudget)
+      PixelPoolClearLocked();
+}
+
+int PixelPoolGetBudget()
+{
+   NmeAutoMutex lock(sgPixelPoolLock);
+   return sgPixelPoolBudget;
+}
+
+int PixelPoolHeldBytes()
+{
+   NmeAutoMutex lock(sgPixelPoolLock);
+   return sgPixelPoolHeld;
+}
+
+} // end namespace nme
@@ -0,0 +1,212 @@
+#include <Profile.h>
+#include <Utils.h>
+#include <NMEThread.h>
+#include <nme/QuickVec.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace nme
+{
+
+bool gProfileEnabled = false;
+
+static const char *sgCounterNames[pcSIZE] =
+{
+   "drawCalls",
+   "vertices",
+   "textureBytes",
+   "tessellations",
+   "bitmapCacheBuilds",
+   "filters",
+   "skippedStateCalls",
+};
+
+enum { MAX_ZONE_DEPTH = 64 };
+
+static inline bool SameZone(const char *inA, const char *inB)
+{
+   return inA==inB || !strcmp(inA,inB);
+}
+
+// Bounds the memory used if tracing is left on
+static const int sgMaxTraceEvents = 1000000;
+
+struct OpenZone
+{
+   const char *name;
+   double     start;
+};
+
+struct TraceEvent
+{
+   const char *name;
+   double     start;
+   double     duration;
+};
+
+struct TraceFrame
+{
+   double end;
+   int    counts[pcSIZE];
+};
+
+static bool     sgTrace = false;
+static double   sgFrameStart = 0;
+static double   sgLastFrameSeconds = 0;
+static int      sgCounts[pcSIZE];
+static int      sgLastCounts[pcSIZE];
+static OpenZone sgOpenZones[MAX_ZONE_DEPTH];
+static int      sgZoneDepth = 0;
+
+static QuickVec<ProfileZoneStats> sgZones;
+static QuickVec<ProfileZoneStats> sgLastZones;
+static QuickVec<TraceEvent>       sgTraceEvents;
+static QuickVec<TraceFrame>       sgTraceFrames;
+
+
+void SetProfiling(bool inEnable, bool inTrace)
+{
+   gProfileEnabled = inEnable;
+   sgTrace = inEnable && inTrace;
+   sgZoneDepth = 0;
+   sgZones.resize(0);
+   sgLastZones.resize(0);
+   for(int i=0;i<pcSIZE;i++)
+      sgCounts[i] = sgLastCounts[i] = 0;
+   sgLastFrameSeconds = 0;
+   sgFrameStart = GetTimeStamp();
+}
+
+const char *ProfileCounterName(ProfileCounter inCounter)
+{
+   return sgCounterNames[inCounter];
+}
+
+void ProfileBeginFrame()
+{
+   if (!gProfileEnabled)
+      return;
+   sgFrameStart = GetTimeStamp();
+}
+
+void ProfileEndFrame()
+{
+   if (!gProfileEnabled)
+      return;
+
+   double now = GetTimeStamp();
+   sgLastFrameSeconds = now - sgFrameStart;
+   for(int i=0;i<pcSIZE;i++)
+   {
+      sgLastCounts[i] = sgCounts[i];
+      sgCounts[i] = 0;
+   }
+   sgLastZones.swap(sgZones);
+   sgZones.resize(0);
+
+   if (sgTrace && sgTraceEvents.size()<sgMaxTraceEvents)
+   {
+      TraceFrame frame;
+      frame.end = now;
+      for(int i=0;i<pcSIZE;i++)
+         frame.counts[i] = sgLastCounts[i];
+      sgTraceFrames.push_back(frame);
+   }
+}
+
+bool ProfileBeginZone(const char *inName)
+{
+   if (sgZoneDepth>=MAX_ZONE_DEPTH || !IsMainThread())
+      return false;
+
+   OpenZone &zone = sgOpenZones[sgZoneDepth++];
+   zone.name = inName;
+   zone.start = GetTimeStamp();
+   return true;
+}
+
+void ProfileEndZone()
+{
+   if (sgZoneDepth<=0)
+      return;
+
+   double now = GetTimeStamp();
+   const OpenZone &zone = sgOpenZones[--sgZoneDepth];
+   double duration = now - zone.start;
+
+   if (sgTrace && sgTraceEvents.size()<sgMaxTraceEvents)
+   {
+      TraceEvent event = { zone.name, zone.start, duration };
+      sgTraceEvents.push_back(event);
+   }
+
+   // Recursive zones only count the time of the outermost one
+   bool nested = false;
+   for(int i=0;i<sgZoneDepth && !nested;i++)
+      nested = SameZone(sgOpenZones[i].name,zone.name);
+
+   for(int i=0;i<sgZones.size();i++)
+   {
+      ProfileZoneStats &stats = sgZones[i];
+      if (SameZone(stats.name,zone.name))
+      {
+         if (!nested)
+            stats.seconds += duration;
+         stats.calls++;
+         return;
+      }
+   }
+   ProfileZoneStats stats = { zone.name, duration, 1 };
+   sgZones.push_back(stats);
+}
+
+void ProfileAddCount(ProfileCounter inCounter, int inAmount)
+{
+   if (IsMainThread())
+      sgCounts[inCounter] += inAmount;
+}
+
+double ProfileFrameSeconds() { return sgLastFrameSeconds; }
+
+int ProfileFrameCount(ProfileCounter inCounter) { return sgLastCounts[inCounter]; }
+
+int ProfileZoneCount() { return sgLastZones.size(); }
+
+const ProfileZoneStats &ProfileGetZone(int inIndex) { return sgLastZones[inIndex]; }
+
+
+// See "Trace Event Format" - times are in microseconds
+bool ProfileSaveTrace(const char *inFilename)
+{
+   FILE *file = fopen(inFilename,"wb");
+   if (!file)
+      return false;
+
+   fprintf(file,"{\"traceEvents\":[\n");
+   bool first = true;
+   for(int i=0;i<sgTraceEvents.size();i++)
+   {
+      const TraceEvent &e = sgTraceEvents[i];
+      fprintf(file,"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+             first ? "" : ",\n", e.name, e.start*1e6, e.duration*1e6);
+      first = false;
+   }
+   for(int i=0;i<sgTraceFrames.size();i++)
+   {
+      const TraceFrame &f = sgTraceFrames[i];
+      fprintf(file,"%s{\"name\":\"frame\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{",
+             first ? "" : ",\n", f.end*1e6);
+      for(int c=0;c<pcSIZE;c++)
+         fprintf(file,"%s\"%s\":%d", c ? "," : "", sgCounterNames[c], f.counts[c]);
+      fprintf(file,"}}");
+      first = false;
+   }
+   fprintf(file,"\n]}\n");
+   fclose(file);
+
+   sgTraceEvents.resize(0);
+   sgTraceFrames.resize(0);
+   return true;
+}
+
+} // end namespace nme
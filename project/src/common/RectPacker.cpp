@@ -0,0 +1,198 @@
+#include <RectPacker.h>
+
+namespace nme
+{
+
+// The skyline is a list of spans across the width, each with the height of the
+//  lowest free pixel above it.  A new rect is placed where its top edge will be lowest,
+//  preferring the narrowest span to break ties, which keeps the skyline flat.
+// Placing a rect over a lower part of the skyline leaves a gap underneath it - these,
+//  and any rects given back, go into a free list that is searched first.
+
+RectPacker::RectPacker(int inWidth,int inHeight)
+{
+   Reset(inWidth,inHeight);
+}
+
+void RectPacker::Reset(int inWidth,int inHeight)
+{
+   mWidth = inWidth;
+   mHeight = inHeight;
+   Reset();
+}
+
+void RectPacker::Reset()
+{
+   mAllocated = 0;
+   mUsedArea = 0;
+   mFree.resize(0);
+   mSkyline.resize(0);
+   if (mWidth>0)
+   {
+      Span span = { 0, 0, mWidth };
+      mSkyline.push_back(span);
+   }
+}
+
+// The y position a rect would have if its left edge was at the start of inSpan, or -1
+int RectPacker::FitAt(int inSpan,int inW,int inH) const
+{
+   int x = mSkyline[inSpan].x;
+   if (x+inW>mWidth)
+      return -1;
+
+   int y = 0;
+   int remaining = inW;
+   for(int i=inSpan; remaining>0; i++)
+   {
+      const Span &span = mSkyline[i];
+      if (span.y>y)
+         y = span.y;
+      if (y+inH>mHeight)
+         return -1;
+      remaining -= span.w;
+   }
+   return y;
+}
+
+// Best area fit from the free list, splitting off what is left along the shorter axis
+bool RectPacker::AllocFree(int inW,int inH,Rect &outRect)
+{
+   int best = -1;
+   int bestArea = 0;
+   for(int i=0;i<mFree.size();i++)
+   {
+      const Rect &r = mFree[i];
+      if (r.w>=inW && r.h>=inH && (best<0 || r.w*r.h<bestArea))
+      {
+         best = i;
+         bestArea = r.w*r.h;
+      }
+   }
+   if (best<0)
+      return false;
+
+   Rect r = mFree[best];
+   mFree.qremoveAt(best);
+   outRect = Rect(r.x, r.y, inW, inH);
+
+   if (r.w-inW > r.h-inH)
+   {
+      AddFree( Rect(r.x+inW, r.y, r.w-inW, r.h) );
+      AddFree( Rect(r.x, r.y+inH, inW, r.h-inH) );
+   }
+   else
+   {
+      AddFree( Rect(r.x+inW, r.y, r.w-inW, inH) );
+      AddFree( Rect(r.x, r.y+inH, r.w, r.h-inH) );
+   }
+   return true;
+}
+
+void RectPacker::AddFree(const Rect &inRect)
+{
+   if (!inRect.HasPixels())
+      return;
+
+   // Join with a neighbour sharing a whole edge, repeating while the result can grow
+   Rect r = inRect;
+   for(int i=0;i<mFree.size();)
+   {
+      const Rect &f = mFree[i];
+      bool join = (f.x==r.x && f.w==r.w && (f.y+f.h==r.y || r.y+r.h==f.y)) ||
+                  (f.y==r.y && f.h==r.h && (f.x+f.w==r.x || r.x+r.w==f.x));
+      if (join)
+      {
+         r = r.Union(f);
+         mFree.qremoveAt(i);
+         i = 0;
+      }
+      else
+         i++;
+   }
+   mFree.push_back(r);
+}
+
+bool RectPacker::Alloc(int inW,int inH,Rect &outRect)
+{
+   if (inW<=0 || inH<=0)
+      return false;
+
+   if (AllocFree(inW,inH,outRect))
+   {
+      mAllocated++;
+      mUsedArea += inW*inH;
+      return true;
+   }
+
+   int best = -1;
+   int bestY = 0;
+   int bestWidth = 0;
+   for(int i=0;i<mSkyline.size();i++)
+   {
+      int y = FitAt(i,inW,inH);
+      if (y<0)
+         continue;
+      if (best<0 || y<bestY || (y==bestY && mSkyline[i].w<bestWidth) )
+      {
+         best = i;
+         bestY = y;
+         bestWidth = mSkyline[i].w;
+      }
+   }
+   if (best<0)
+      return false;
+
+   outRect = Rect(mSkyline[best].x, bestY, inW, inH);
+   mAllocated++;
+   mUsedArea += inW*inH;
+
+   // Raise the skyline under the new rect, remembering any gaps left below it
+   int x1 = outRect.x + inW;
+   int i = best;
+   while(i<mSkyline.size())
+   {
+      Span &s = mSkyline[i];
+      if (s.x>=x1)
+         break;
+      int end = s.x+s.w;
+      int covered = (end<x1 ? end : x1) - s.x;
+      AddFree( Rect(s.x, s.y, covered, bestY-s.y) );
+      if (end<=x1)
+      {
+         mSkyline.EraseAt(i);
+         continue;
+      }
+      s.w -= covered;
+      s.x = x1;
+      break;
+   }
+   Span span = { outRect.x, bestY+inH, inW };
+   mSkyline.InsertAt(best,span);
+
+   // Join neighbours at the same height
+   for(int i=0;i+1<mSkyline.size();)
+   {
+      if (mSkyline[i].y==mSkyline[i+1].y)
+      {
+         mSkyline[i].w += mSkyline[i+1].w;
+         mSkyline.EraseAt(i+1);
+      }
+      else
+         i++;
+   }
+
+   return true;
+}
+
+void RectPacker::Free(const Rect &inRect)
+{
+   mAllocated--;
+   mUsedArea -= inRect.w*inRect.h;
+   if (mAllocated<=0)
+      Reset();
+   else
+      AddFree(inRect);
+}
+
+} // end namespace nme
@@ -0,0 +1,418 @@
+#include <SpanBlend.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+   #define NME_SPAN_SSE2
+   #include <emmintrin.h>
+   #if defined(_MSC_VER)
+      #include <intrin.h>
+   #elif !defined(__x86_64__)
+      #include <cpuid.h>
+   #endif
+   // Allow the sse2 code to be compiled, even if the rest of the code is not
+   #if defined(__GNUC__) && !defined(__SSE2__)
+      #define SSE2_FUNC __attribute__((target("sse2")))
+   #else
+      #define SSE2_FUNC
+   #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+   #define NME_SPAN_NEON
+   #include <arm_neon.h>
+#endif
+
+namespace nme
+{
+
+// Each kernel does 4 pixels at a time, and the remainder is done by padding out to 4 pixels.
+// The arithmetic is done in 16 bits per channel and matches the scalar code exactly:
+//   A = alpha + (alpha>>7)  (ie, 0...256)
+//   dest = (A*src + (256-A)*dest) >> 8
+
+template<typename KERNEL>
+inline void BlendTail(ARGB *ioDest, const ARGB *inSrc, int inCount)
+{
+   ARGB dest[4];
+   ARGB src[4] = { 0, 0, 0, 0 };
+   memcpy(dest,ioDest,inCount*sizeof(ARGB));
+   memcpy(src,inSrc,inCount*sizeof(ARGB));
+   KERNEL::Blend4(dest,src);
+   memcpy(ioDest,dest,inCount*sizeof(ARGB));
+}
+
+template<typename KERNEL>
+void TBlendSpan(ARGB *ioDest, const ARGB *inSrc, int inCount)
+{
+   int n4 = inCount & ~3;
+   for(int x=0;x<n4;x+=4)
+      KERNEL::Blend4(ioDest+x,inSrc+x);
+   if (n4<inCount)
+      BlendTail<KERNEL>(ioDest+n4,inSrc+n4,inCount-n4);
+}
+
+template<typename KERNEL>
+void TSolidSpan(ARGB *ioDest, ARGB inColour, int inCount)
+{
+   ARGB src[4] = { inColour, inColour, inColour, inColour };
+   int n4 = inCount & ~3;
+   for(int x=0;x<n4;x+=4)
+      KERNEL::Blend4(ioDest+x,src);
+   if (n4<inCount)
+      BlendTail<KERNEL>(ioDest+n4,src,inCount-n4);
+}
+
+template<typename KERNEL>
+void TTintSpan(ARGB *ioDest, const uint8 *inAlpha, ARGB inTint, int inCount)
+{
+   // Matches TintSource in Surface.cpp
+   int a0 = inTint.a;
+   if (a0>127) a0++;
+   int rgb = inTint.ival & 0xffffff;
+
+   ARGB src[4];
+   for(int x=0;x<inCount;x+=4)
+   {
+      int n = inCount-x < 4 ? inCount-x : 4;
+      for(int i=0;i<n;i++)
+         src[i].ival = rgb | (((a0*inAlpha[x+i])>>8)<<24);
+      if (n==4)
+         KERNEL::Blend4(ioDest+x,src);
+      else
+         BlendTail<KERNEL>(ioDest+x,src,n);
+   }
+}
+
+
+
+#ifdef NME_SPAN_SSE2
+
+// --- SSE2 -------------------------------------------------------------
+
+struct SSE2
+{
+   // Per-pixel blend factor, 0...256
+   static SSE2_FUNC inline __m128i AlphaFactor(__m128i inSrc)
+   {
+      __m128i a = _mm_srli_epi32(inSrc,24);
+      return _mm_add_epi32(a,_mm_srli_epi32(a,7));
+   }
+
+   // Spread the factor for pixels 0,1 (or 2,3) across their 16-bit channels
+   static SSE2_FUNC inline __m128i SpreadLo(__m128i inA)
+   {
+      __m128i t = _mm_unpacklo_epi32(inA,inA);
+      return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t,0),0);
+   }
+   static SSE2_FUNC inline __m128i SpreadHi(__m128i inA)
+   {
+      __m128i t = _mm_unpackhi_epi32(inA,inA);
+      return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t,0),0);
+   }
+
+   static SSE2_FUNC inline __m128i Lerp16(__m128i inSrc, __m128i inDest, __m128i inA)
+   {
+      __m128i f = _mm_sub_epi16(_mm_set1_epi16(256),inA);
+      return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(inSrc,inA),_mm_mullo_epi16(inDest,f)),8);
+   }
+
+   static SSE2_FUNC inline __m128i Lerp(__m128i inSrc, __m128i inDest, __m128i inA)
+   {
+      __m128i zero = _mm_setzero_si128();
+      __m128i lo = Lerp16(_mm_unpacklo_epi8(inSrc,zero),_mm_unpacklo_epi8(inDest,zero),SpreadLo(inA));
+      __m128i hi = Lerp16(_mm_unpackhi_epi8(inSrc,zero),_mm_unpackhi_epi8(inDest,zero),SpreadHi(inA));
+      return _mm_packus_epi16(lo,hi);
+   }
+
+   static SSE2_FUNC inline __m128i Select(__m128i inMask, __m128i inTrue, __m128i inFalse)
+   {
+      return _mm_or_si128(_mm_and_si128(inMask,inTrue),_mm_andnot_si128(inMask,inFalse));
+   }
+};
+
+
+// ARGB::Blend<false>
+struct SSE2Normal : public SSE2
+{
+   static SSE2_FUNC void Blend4(ARGB *ioDest, const ARGB *inSrc)
+   {
+      __m128i s = _mm_loadu_si128((const __m128i *)inSrc);
+      __m128i d = _mm_loadu_si128((const __m128i *)ioDest);
+      __m128i A = AlphaFactor(s);
+      __m128i alpha = _mm_set1_epi32(0xff000000);
+
+      // Blend the colour, keep our alpha
+      __m128i result = Select(alpha,d,Lerp(s,d,A));
+      // Replace if almost solid, leave if almost clear
+      result = Select(_mm_cmpgt_epi32(A,_mm_set1_epi32(250)),s,result);
+      result = Select(_mm_cmpgt_epi32(A,_mm_set1_epi32(5)),result,d);
+
+      _mm_storeu_si128((__m128i *)ioDest,result);
+   }
+};
+
+
+// BlendFuncWithAlpha<false>, with the channel function applied in 16 bits
+template<typename OP>
+struct SSE2Func : public SSE2
+{
+   static SSE2_FUNC void Blend4(ARGB *ioDest, const ARGB *inSrc)
+   {
+      __m128i s = _mm_loadu_si128((const __m128i *)inSrc);
+      __m128i d = _mm_loadu_si128((const __m128i *)ioDest);
+      __m128i zero = _mm_setzero_si128();
+      __m128i alpha = _mm_set1_epi32(0xff000000);
+
+      __m128i lo = OP::Apply(_mm_unpacklo_epi8(s,zero),_mm_unpacklo_epi8(d,zero));
+      __m128i hi = OP::Apply(_mm_unpackhi_epi8(s,zero),_mm_unpackhi_epi8(d,zero));
+      __m128i val = Select(alpha,s,_mm_packus_epi16(lo,hi));
+
+      __m128i result = Lerp(val,d,AlphaFactor(s));
+      // Alpha becomes solid if the source was solid
+      __m128i solid = _mm_cmpeq_epi32(_mm_and_si128(s,alpha),alpha);
+      result = Select(alpha,Select(solid,alpha,d),result);
+
+      _mm_storeu_si128((__m128i *)ioDest,result);
+   }
+};
+
+struct SSE2Add
+{
+   static SSE2_FUNC inline __m128i Apply(__m128i inSrc, __m128i inDest)
+   {
+      return _mm_min_epi16(_mm_add_epi16(inSrc,inDest),_mm_set1_epi16(255));
+   }
+};
+
+struct SSE2Multiply
+{
+   static SSE2_FUNC inline __m128i Apply(__m128i inSrc, __m128i inDest)
+   {
+      __m128i s = _mm_add_epi16(inSrc,_mm_srli_epi16(inSrc,7));
+      return _mm_srli_epi16(_mm_mullo_epi16(inDest,s),8);
+   }
+};
+
+struct SSE2Screen
+{
+   static SSE2_FUNC inline __m128i Apply(__m128i inSrc, __m128i inDest)
+   {
+      __m128i c255 = _mm_set1_epi16(255);
+      __m128i s = _mm_sub_epi16(_mm_sub_epi16(_mm_set1_epi16(256),inSrc),_mm_srli_epi16(inSrc,7));
+      return _mm_sub_epi16(c255,_mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(c255,inDest),s),8));
+   }
+};
+
+
+static bool HasSSE2()
+{
+   #if defined(__x86_64__) || defined(_M_X64)
+   return true;
+   #elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info,1);
+   return (info[3] & (1<<26))!=0;
+   #else
+   unsigned int a,b,c,d;
+   if (!__get_cpuid(1,&a,&b,&c,&d))
+      return false;
+   return (d & (1<<26))!=0;
+   #endif
+}
+
+#endif
+
+
+
+#ifdef NME_SPAN_NEON
+
+// --- NEON -------------------------------------------------------------
+
+struct NEON
+{
+   static inline uint32x4_t AlphaFactor(uint32x4_t inSrc)
+   {
+      uint32x4_t a = vshrq_n_u32(inSrc,24);
+      return vaddq_u32(a,vshrq_n_u32(a,7));
+   }
+
+   static inline uint16x8_t Spread(uint16x4_t inA)
+   {
+      uint16x4x2_t z = vzip_u16(inA,inA);
+      return vcombine_u16(z.val[0],z.val[1]);
+   }
+   static inline uint16x8_t SpreadLo(uint32x4_t inA)
+   {
+      uint16x4_t a = vmovn_u32(inA);
+      return Spread(vzip_u16(a,a).val[0]);
+   }
+   static inline uint16x8_t SpreadHi(uint32x4_t inA)
+   {
+      uint16x4_t a = vmovn_u32(inA);
+      return Spread(vzip_u16(a,a).val[1]);
+   }
+
+   static inline uint16x8_t Lerp16(uint16x8_t inSrc, uint16x8_t inDest, uint16x8_t inA)
+   {
+      uint16x8_t f = vsubq_u16(vdupq_n_u16(256),inA);
+      return vshrq_n_u16(vaddq_u16(vmulq_u16(inSrc,inA),vmulq_u16(inDest,f)),8);
+   }
+
+   static inline uint32x4_t Lerp(uint32x4_t inSrc, uint32x4_t inDest, uint32x4_t inA)
+   {
+      uint8x16_t s = vreinterpretq_u8_u32(inSrc);
+      uint8x16_t d = vreinterpretq_u8_u32(inDest);
+      uint16x8_t lo = Lerp16(vmovl_u8(vget_low_u8(s)),vmovl_u8(vget_low_u8(d)),SpreadLo(inA));
+      uint16x8_t hi = Lerp16(vmovl_u8(vget_high_u8(s)),vmovl_u8(vget_high_u8(d)),SpreadHi(inA));
+      return vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(lo),vmovn_u16(hi)));
+   }
+};
+
+
+struct NEONNormal : public NEON
+{
+   static void Blend4(ARGB *ioDest, const ARGB *inSrc)
+   {
+      uint32x4_t s = vld1q_u32((const uint32_t *)inSrc);
+      uint32x4_t d = vld1q_u32((const uint32_t *)ioDest);
+      uint32x4_t A = AlphaFactor(s);
+      uint32x4_t alpha = vdupq_n_u32(0xff000000);
+
+      uint32x4_t result = vbslq_u32(alpha,d,Lerp(s,d,A));
+      result = vbslq_u32(vcgtq_u32(A,vdupq_n_u32(250)),s,result);
+      result = vbslq_u32(vcgtq_u32(A,vdupq_n_u32(5)),result,d);
+
+      vst1q_u32((uint32_t *)ioDest,result);
+   }
+};
+
+
+template<typename OP>
+struct NEONFunc : public NEON
+{
+   static void Blend4(ARGB *ioDest, const ARGB *inSrc)
+   {
+      uint32x4_t s = vld1q_u32((const uint32_t *)inSrc);
+      uint32x4_t d = vld1q_u32((const uint32_t *)ioDest);
+      uint32x4_t alpha = vdupq_n_u32(0xff000000);
+      uint8x16_t s8 = vreinterpretq_u8_u32(s);
+      uint8x16_t d8 = vreinterpretq_u8_u32(d);
+
+      uint16x8_t lo = OP::Apply(vmovl_u8(vget_low_u8(s8)),vmovl_u8(vget_low_u8(d8)));
+      uint16x8_t hi = OP::Apply(vmovl_u8(vget_high_u8(s8)),vmovl_u8(vget_high_u8(d8)));
+      uint32x4_t val = vreinterpretq_u32_u8(vcombine_u8(vqmovn_u16(lo),vqmovn_u16(hi)));
+      val = vbslq_u32(alpha,s,val);
+
+      uint32x4_t result = Lerp(val,d,AlphaFactor(s));
+      uint32x4_t solid = vceqq_u32(vandq_u32(s,alpha),alpha);
+      result = vbslq_u32(alpha,vbslq_u32(solid,alpha,d),result);
+
+      vst1q_u32((uint32_t *)ioDest,result);
+   }
+};
+
+struct NEONAdd
+{
+   static inline uint16x8_t Apply(uint16x8_t inSrc, uint16x8_t inDest)
+   {
+      return vminq_u16(vaddq_u16(inSrc,inDest),vdupq_n_u16(255));
+   }
+};
+
+struct NEONMultiply
+{
+   static inline uint16x8_t Apply(uint16x8_t inSrc, uint16x8_t inDest)
+   {
+      uint16x8_t s = vaddq_u16(inSrc,vshrq_n_u16(inSrc,7));
+      return vshrq_n_u16(vmulq_u16(inDest,s),8);
+   }
+};
+
+struct NEONScreen
+{
+   static inline uint16x8_t Apply(uint16x8_t inSrc, uint16x8_t inDest)
+   {
+      uint16x8_t c255 = vdupq_n_u16(255);
+      uint16x8_t s = vsubq_u16(vsubq_u16(vdupq_n_u16(256),inSrc),vshrq_n_u16(inSrc,7));
+      return vsubq_u16(c255,vshrq_n_u16(vmulq_u16(vsubq_u16(c255,inDest),s),8));
+   }
+};
+
+#endif
+
+
+
+// --- Selection -------------------------------------------------------
+
+static volatile bool sSpanInit = false;
+static SpanBlendFunc sSpanNormal = 0;
+static SpanBlendFunc sSpanAdd = 0;
+static SpanBlendFunc sSpanMultiply = 0;
+static SpanBlendFunc sSpanScreen = 0;
+static SpanSolidFunc sSpanSolid = 0;
+static SpanTintFunc  sSpanTint = 0;
+
+void InitSpanBlend()
+{
+   if (sSpanInit)
+      return;
+
+   #ifdef NME_SPAN_SSE2
+   if (HasSSE2())
+   {
+      sSpanNormal = TBlendSpan<SSE2Normal>;
+      sSpanAdd = TBlendSpan< SSE2Func<SSE2Add> >;
+      sSpanMultiply = TBlendSpan< SSE2Func<SSE2Multiply> >;
+      sSpanScreen = TBlendSpan< SSE2Func<SSE2Screen> >;
+      sSpanSolid = TSolidSpan<SSE2Normal>;
+      sSpanTint = TTintSpan<SSE2Normal>;
+   }
+   #endif
+
+   #ifdef NME_SPAN_NEON
+   sSpanNormal = TBlendSpan<NEONNormal>;
+   sSpanAdd = TBlendSpan< NEONFunc<NEONAdd> >;
+   sSpanMultiply = TBlendSpan< NEONFunc<NEONMultiply> >;
+   sSpanScreen = TBlendSpan< NEONFunc<NEONScreen> >;
+   sSpanSolid = TSolidSpan<NEONNormal>;
+   sSpanTint = TTintSpan<NEONNormal>;
+   #endif
+
+   // Set last, so nothing sees the flag before the functions
+   sSpanInit = true;
+}
+
+SpanBlendFunc GetSpanBlend(BlendMode inMode)
+{
+   if (!sSpanInit)
+      InitSpanBlend();
+   switch(inMode)
+   {
+      case bmNormal:
+      case bmLayer:
+         return sSpanNormal;
+      case bmAdd:
+         return sSpanAdd;
+      case bmMultiply:
+         return sSpanMultiply;
+      case bmScreen:
+         return sSpanScreen;
+      default: ;
+   }
+   return 0;
+}
+
+SpanSolidFunc GetSpanSolid()
+{
+   if (!sSpanInit)
+      InitSpanBlend();
+   return sSpanSolid;
+}
+
+SpanTintFunc GetSpanTint()
+{
+   if (!sSpanInit)
+      InitSpanBlend();
+   return sSpanTint;
+}
+
+
+} // end namespace nme
@@ -1,6 +1,9 @@
 #include <Display.h>
 #include <Surface.h>
+#include <Profile.h>
+#include <PixelPool.h>
 #include <math.h>
+#include <string.h>
 
 #include "TextField.h"
 #include "Sound.h"
@@ -44,6 +47,9 @@ public:
 
 Stage *Stage::gCurrentStage = 0;
 
+bool gDirtyRectRendering = false;
+bool gUseRenderQueue = false;
+
 Stage::Stage(bool inInitRef) : DisplayObjectContainer(inInitRef)
 {
    gCurrentStage = this;
@@ -61,6 +67,10 @@ Stage::Stage(bool inInitRef) : DisplayObjectContainer(inInitRef)
    mNextWake = 0.0;
    displayState = sdsNormal;
    align = saTopLeft;
+   mDamageActive = false;
+   mDamageClear = false;
+   mDamageWidth = 0;
+   mDamageHeight = 0;
 
    #if defined(IPHONE) || defined(ANDROID) || defined(WEBOS) || defined(TIZEN)
    quality = sqLow;
@@ -343,6 +353,7 @@ void Stage::setOpaqueBackground(uint32 inBG)
 {
    opaqueBackground = inBG | 0xff000000;
    DirtyCache();
+   DamageAll();
 }
 
 
@@ -361,6 +372,8 @@ void Stage::RemovingFromStage(DisplayObject *inObject)
    }
 
 
+   inObject->ForgetDrawn(mDamage);
+
    DisplayObject *f = mFocusObject;
    while(f)
    {
@@ -454,6 +467,7 @@ void Stage::CalcStageScaling(double inNewWidth,double inNewHeight)
          break;
    }
    DirtyCache();
+   DamageAll();
 
    mStageScale.m00 = StageScaleX;
    mStageScale.m11 = StageScaleY;
@@ -485,14 +499,38 @@ int Stage::GetAA()
 
 void Stage::BeginRenderStage(bool inClear)
 {
+   ProfileBeginFrame();
+   NME_PROFILE_ZONE("BeginRenderStage");
    Surface *surface = GetPrimarySurface();
    currentTarget = surface->BeginRender( Rect(surface->Width(),surface->Height()),false );
-   if (inClear)
+
+   bool wasActive = mDamageActive;
+   mDamageActive = gDirtyRectRendering && !currentTarget.IsHardware() && KeepsBackBuffer();
+   if (!mDamageActive || !wasActive || surface->Width()!=mDamageWidth ||
+          surface->Height()!=mDamageHeight)
+      mDamage.SetFull();
+   mDamageWidth = surface->Width();
+   mDamageHeight = surface->Height();
+
+   // When tracking damage, only the damaged parts are cleared once they are known
+   if (mDamageActive)
+      mDamageClear = inClear;
+   else if (inClear)
       surface->Clear( (opaqueBackground | 0xff000000) & getBackgroundMask() );
 }
 
+// Compare what will be drawn with what was drawn last time.  This must happen before the
+//  bitmap phase, which clears the dirty flags of the objects it caches.
+void Stage::FindDamage()
+{
+   NME_PROFILE_ZONE("FindDamage");
+   DisplayObjectContainer::CollectDamage(mStageScale,ColorTransform(),mDamage);
+   mDamage.Finish( Rect(currentTarget.Width(),currentTarget.Height()) );
+}
+
 void Stage::RenderStage()
 {
+   NME_PROFILE_ZONE("RenderStage");
    ColorTransform::TidyCache();
 
    if (currentTarget.IsHardware())
@@ -504,20 +542,226 @@ void Stage::RenderStage()
 
    state.mClipRect = Rect( currentTarget.Width(), currentTarget.Height() );
 
-   state.mPhase = rpBitmap;
-   state.mRoundSizeToPOW2 = currentTarget.IsHardware();
-   Render(currentTarget,state);
+   if (mDamageActive)
+      FindDamage();
+
+   bool hardware = currentTarget.IsHardware();
+   state.mRoundSizeToPOW2 = hardware;
+   // The bitmap phase records the queue, and is not needed at all if it is still good
+   if (!gUseRenderQueue)
+      mRenderQueue.Clear();
+   if (!gUseRenderQueue || !mRenderQueue.StillGood(state,hardware))
+   {
+      state.mPhase = rpBitmap;
+      if (gUseRenderQueue)
+         mRenderQueue.Begin(state,hardware);
+      Render(currentTarget,state);
+      state.mQueue = 0;
+   }
 
    state.mPhase = rpRender;
-   Render(currentTarget,state);
+   uint32 bg = (opaqueBackground | 0xff000000) & getBackgroundMask();
+   if (mDamageActive && !mDamage.IsFull())
+   {
+      Surface *surface = GetPrimarySurface();
+      for(int i=0;i<mDamage.Count();i++)
+      {
+         if (mDamageClear)
+            surface->Clear(bg,&mDamage[i]);
+         state.mClipRect = mDamage[i];
+         RenderPass(state);
+      }
+   }
+   else
+   {
+      if (mDamageClear)
+         GetPrimarySurface()->Clear(bg);
+      RenderPass(state);
+   }
+   mDamageClear = false;
+}
+
+void Stage::RenderPass(const RenderState &inState)
+{
+   if (gUseRenderQueue)
+      mRenderQueue.Render(currentTarget,inState);
+   else
+      Render(currentTarget,inState);
 }
 
 void Stage::EndRenderStage()
 {
+   // Begun, but not rendered
+   if (mDamageClear)
+   {
+      GetPrimarySurface()->Clear( (opaqueBackground | 0xff000000) & getBackgroundMask() );
+      mDamage.SetFull();
+      mDamageClear = false;
+   }
+
    currentTarget = RenderTarget();
    GetPrimarySurface()->EndRender();
    ClearCacheDirty();
-   Flip();
+   {
+      NME_PROFILE_ZONE("Flip");
+      Flip();
+   }
+   mDamage.Reset();
+   PixelPoolTrim();
+   ProfileEndFrame();
+}
+
+// --- DamageRegion ---------------------------------------------------------
+
+// Beyond this, everything is joined into one rect
+static const int sgMaxDamageRects = 8;
+
+void DamageRegion::Add(const Rect &inRect)
+{
+   if (mFull || !inRect.HasPixels())
+      return;
+
+   // Join with any rect where drawing the union costs no more than drawing both
+   Rect r = inRect;
+   for(int i=0;i<mRects.size();)
+   {
+      Rect joined = r.Union(mRects[i]);
+      if (joined.Area() <= r.Area() + mRects[i].Area())
+      {
+         r = joined;
+         mRects.qremoveAt(i);
+         i = 0;
+      }
+      else
+         i++;
+   }
+   mRects.push_back(r);
+
+   if (mRects.size()>sgMaxDamageRects)
+   {
+      for(int i=1;i<mRects.size();i++)
+         mRects[0] = mRects[0].Union(mRects[i]);
+      mRects.resize(1);
+   }
+}
+
+void DamageRegion::Finish(const Rect &inBounds)
+{
+   if (mFull)
+      return;
+
+   int area = 0;
+   for(int i=0;i<mRects.size();)
+   {
+      mRects[i] = mRects[i].Intersect(inBounds);
+      if (mRects[i].HasPixels())
+      {
+         area += mRects[i].Area();
+         i++;
+      }
+      else
+         mRects.qremoveAt(i);
+   }
+
+   if (area*4 > inBounds.Area()*3)
+      SetFull();
+}
+
+// --- RenderQueue ----------------------------------------------------------
+
+void RenderQueue::Clear()
+{
+   mRecorded = false;
+   mHasMasks = false;
+   mItems.resize(0);
+   mColours.resize(0);
+}
+
+void RenderQueue::Begin(RenderState &ioState,bool inHardware)
+{
+   Clear();
+   mRecorded = true;
+   mVersion = gDisplayListVersion;
+   mRoot = *ioState.mTransform.mMatrix;
+   mRootClip = ioState.mClipRect;
+   mAA = ioState.mTransform.mAAFactor;
+   mHardware = inHardware;
+   ioState.mQueue = this;
+}
+
+void RenderQueue::Add(RenderQueueKind inKind,DisplayObject *inObject,const RenderState &inState)
+{
+   Item item;
+   item.mKind = inKind;
+   item.mObject = inObject;
+   item.mMask = inState.mMask;
+   item.mMatrix = *inState.mTransform.mMatrix;
+   item.mClip = inState.mClipRect;
+   item.mColour = -1;
+   if (inState.mMask)
+      mHasMasks = true;
+
+   // Bitmaps ignore the colour, and have not had theirs combined yet
+   const ColorTransform *colour = inState.mColourTransform;
+   if (inKind!=rqBitmap && !colour->IsIdentity())
+   {
+      // Siblings usually share the colour
+      int last = mColours.size()-1;
+      if (last<0 || memcmp(&mColours[last],colour,sizeof(ColorTransform)))
+         mColours.push_back(*colour);
+      item.mColour = mColours.size()-1;
+   }
+   mItems.push_back(item);
+}
+
+bool RenderQueue::StillGood(const RenderState &inState,bool inHardware)
+{
+   // Masks are only built during the bitmap phase
+   if (!mRecorded || mVersion!=gDisplayListVersion || mHasMasks || mHardware!=inHardware ||
+        mAA!=inState.mTransform.mAAFactor || mRoot!=*inState.mTransform.mMatrix ||
+        mRootClip!=inState.mClipRect)
+      return false;
+
+   // Caches to rebuild, such as a text field with a flashing caret
+   for(int i=0;i<mItems.size();i++)
+      if (mItems[i].mKind==rqBitmap && mItems[i].mObject->IsCacheDirty())
+         return false;
+
+   return true;
+}
+
+void RenderQueue::Render(const RenderTarget &inTarget,const RenderState &inState)
+{
+   NME_PROFILE_ZONE("RenderQueue");
+   static ColorTransform sIdentity;
+
+   RenderState state(inState);
+   ColorTransform colour;
+   for(int i=mItems.size()-1; i>=0; i--)
+   {
+      const Item &item = mItems[i];
+      state.mClipRect = item.mClip.Intersect(inState.mClipRect);
+      if (!state.mClipRect.HasPixels())
+         continue;
+
+      state.mTransform.mMatrix = &item.mMatrix;
+      state.mMask = item.mMask;
+      state.CombineColourTransform(inState, item.mColour<0 ? &sIdentity : &mColours[item.mColour],
+                                   &colour);
+
+      switch(item.mKind)
+      {
+         case rqBitmap:
+            item.mObject->RenderBitmap(inTarget,state);
+            break;
+         case rqWhole:
+            item.mObject->Render(inTarget,state);
+            break;
+         case rqOwn:
+            item.mObject->DisplayObject::Render(inTarget,state);
+            break;
+      }
+   }
 }
 
 
@@ -533,6 +777,9 @@ bool Stage::BuildCache()
 
    RenderTarget target(state.mClipRect, surface->GetHardwareRenderer());
    state.mRoundSizeToPOW2 = surface->GetHardwareRenderer();
+   // RenderStage can reuse this if nothing changes in between
+   if (gUseRenderQueue)
+      mRenderQueue.Begin(state,target.IsHardware());
    Render(target,state);
 
    return wasDirty;
@@ -569,6 +816,7 @@ void Stage::setQuality(int inQuality)
 {
    quality = (StageQuality)inQuality;
    DirtyCache();
+   DamageAll();
 }
 
 void Stage::setDisplayState(int inDisplayState)
@@ -1,11 +1,15 @@
 #include <Graphics.h>
 #include <Surface.h>
 #include <nme/Pixel.h>
+#include <SpanBlend.h>
+#include <PixelPool.h>
 
 namespace nme
 {
 
 int gTextureContextVersion = 1;
+bool gUseTextureAtlas = false;
+int gTextureAtlasVersion = 1;
 
 
 // --- Surface -------------------------------------------------------
@@ -42,16 +46,29 @@ Texture *Surface::GetTexture(HardwareContext *inHardware,int inPlane)
    return mTexture;
 }
 
+Texture *Surface::GetOwnTexture(HardwareContext *inHardware)
+{
+   mFlags |= surfNoAtlas;
+   if (mTexture && mTexture->GetAtlasPage())
+   {
+      delete mTexture;
+      mTexture = 0;
+   }
+   return GetTexture(inHardware);
+}
+
 
 
 
 // --- SimpleSurface -------------------------------------------------------
 
-SimpleSurface::SimpleSurface(int inWidth,int inHeight,PixelFormat inPixelFormat,int inByteAlign,int inGPUFormat)
+SimpleSurface::SimpleSurface(int inWidth,int inHeight,PixelFormat inPixelFormat,int inByteAlign,int inGPUFormat,
+                             bool inPooled)
 {
    mWidth = inWidth;
    mHeight = inHeight;
    mTexture = 0;
+   mPooled = inPooled && inGPUFormat==-1;
    mPixelFormat = inPixelFormat;
    mGPUPixelFormat = inPixelFormat;
    
@@ -74,7 +91,10 @@ SimpleSurface::SimpleSurface(int inWidth,int inHeight,PixelFormat inPixelFormat,
          mStride = inWidth*pix_size;
       }
 
-      mBase = new unsigned char[mStride * mHeight+1];
+      if (mPooled)
+         mBase = PixelPoolAlloc(mStride * mHeight+1);
+      else
+         mBase = new unsigned char[mStride * mHeight+1];
       mBase[mStride*mHeight] = 69;
    }
    else
@@ -94,10 +114,19 @@ SimpleSurface::~SimpleSurface()
    {
       if (mBase[mStride*mHeight]!=69)
          ELOG("Image write overflow");
-      delete [] mBase;
+      FreeBase();
    }
 }
 
+void SimpleSurface::FreeBase()
+{
+   if (mPooled)
+      PixelPoolFree(mBase, mStride * mHeight+1);
+   else
+      delete [] mBase;
+   mBase = 0;
+}
+
 
 void SimpleSurface::destroyHardwareSurface() {
 
@@ -124,8 +153,7 @@ void SimpleSurface::MakeTextureOnly()
    if(mBase)
    {
        createHardwareSurface();
-       delete [] mBase;
-       mBase = NULL;
+       FreeBase();
    }
 }
 
@@ -336,12 +364,57 @@ void TTBlit( const DEST &outDest, const SRC &inSrc,const MASK &inMask,
    }
 }
 
+// Whole-row blits onto opaque destinations, using the vectorised span blenders.
+//  Returns false if there is no span version for these types.
+template<typename DEST, typename SRC, typename MASK>
+bool TSpanBlit( const DEST &outDest, const SRC &inSrc,const MASK &inMask,
+            int inX, int inY, const Rect &inSrcRect)
+{
+   return false;
+}
+
+bool TSpanBlit( const ImageDest<ARGB> &outDest, const ImageSource<ARGB> &inSrc,const NullMask &inMask,
+            int inX, int inY, const Rect &inSrcRect)
+{
+   SpanBlendFunc blend = GetSpanBlend(bmNormal);
+   if (!blend)
+      return false;
+
+   for(int y=0;y<inSrcRect.h;y++)
+   {
+      outDest.SetPos(inX , inY + y );
+      inSrc.SetPos( inSrcRect.x, inSrcRect.y + y );
+      blend(outDest.mPos, inSrc.mPos, inSrcRect.w);
+   }
+   return true;
+}
+
+bool TSpanBlit( const ImageDest<ARGB> &outDest, const TintSource<false> &inSrc,const NullMask &inMask,
+            int inX, int inY, const Rect &inSrcRect)
+{
+   SpanTintFunc tint = GetSpanTint();
+   if (!tint || inSrc.mPixelStride!=1)
+      return false;
+
+   for(int y=0;y<inSrcRect.h;y++)
+   {
+      outDest.SetPos(inX , inY + y );
+      inSrc.SetPos( inSrcRect.x, inSrcRect.y + y );
+      tint(outDest.mPos, inSrc.mPos, inSrc.mCol, inSrcRect.w);
+   }
+   return true;
+}
+
+
 template<typename DEST, typename SRC, typename MASK>
 void TBlit( const DEST &outDest, const SRC &inSrc,const MASK &inMask,
             int inX, int inY, const Rect &inSrcRect)
 {
    bool dest_alpha = outDest.Format() & pfHasAlpha;
 
+   if (!dest_alpha && TSpanBlit(outDest,inSrc,inMask,inX,inY,inSrcRect))
+      return;
+
    if (dest_alpha)
       TTBlit<true,DEST,SRC,MASK>(outDest,inSrc,inMask,inX,inY,inSrcRect);
    else
@@ -558,46 +631,93 @@ template<bool DEST_ALPHA> void InnerFunc(ARGB &ioDest, ARGB inSrc)
 }
 
 
-#define BLEND_METHOD(blend) blend<false>, blend<true>,
-
-BlendFunc sgBlendFuncs[] = 
-{
-   0, 0,  // Normal
-   0, 0,  // Layer
-   BLEND_METHOD(MultiplyFunc)
-   BLEND_METHOD(ScreenFunc)
-   BLEND_METHOD(LightenFunc)
-   BLEND_METHOD(DarkenFunc)
-   BLEND_METHOD(DifferenceFunc)
-   BLEND_METHOD(AddFunc)
-   BLEND_METHOD(SubtractFunc)
-   BLEND_METHOD(InvertFunc)
-   BLEND_METHOD(AlphaFunc)
-   BLEND_METHOD(EraseFunc)
-   BLEND_METHOD(OverlayFunc)
-   BLEND_METHOD(HardLightFunc)
-   BLEND_METHOD(CopyFunc)
-   BLEND_METHOD(InnerFunc)
-};
+// -- Normal ---------
+
+template<bool DEST_ALPHA> void NormalFunc(ARGB &ioDest, ARGB inSrc)
+{
+   ioDest.Blend<DEST_ALPHA>(inSrc);
+}
+
 
 template<typename MASK,typename SOURCE>
-void TBlitBlend( const ImageDest<ARGB> &outDest, SOURCE &inSrc,const MASK &inMask,
+bool TSpanBlitBlend( const ImageDest<ARGB> &outDest, SOURCE &inSrc,const MASK &inMask,
             int inX, int inY, const Rect &inSrcRect, BlendMode inMode)
 {
-   bool dest_alpha = outDest.Format() & pfHasAlpha;
+   return false;
+}
+
+bool TSpanBlitBlend( const ImageDest<ARGB> &outDest, ImageSource<ARGB> &inSrc,const NullMask &inMask,
+            int inX, int inY, const Rect &inSrcRect, BlendMode inMode)
+{
+   SpanBlendFunc blend = GetSpanBlend(inMode);
+   if (!blend)
+      return false;
 
-   BlendFunc blend = sgBlendFuncs[inMode*2 + (dest_alpha?1:0)];
+   for(int y=0;y<inSrcRect.h;y++)
+   {
+      outDest.SetPos(inX , inY + y );
+      inSrc.SetPos( inSrcRect.x, inSrcRect.y + y );
+      blend(outDest.mPos, inSrc.mPos, inSrcRect.w);
+   }
+   return true;
+}
 
+// Row kernel for a given blend function - the function is a template argument so
+//  it gets inlined into the loop, rather than being called for each pixel.
+template<BlendFunc BLEND, typename MASK,typename SOURCE>
+void TBlitBlendRows( const ImageDest<ARGB> &outDest, SOURCE &inSrc,const MASK &inMask,
+            int inX, int inY, const Rect &inSrcRect)
+{
    for(int y=0;y<inSrcRect.h;y++)
    {
       outDest.SetPos(inX , inY + y );
       inMask.SetPos(inX , inY + y );
       inSrc.SetPos( inSrcRect.x, inSrcRect.y + y );
       for(int x=0;x<inSrcRect.w;x++)
-         blend(outDest.Next(),inMask.Mask(inSrc.Next()));
+         BLEND(outDest.Next(),inMask.Mask(inSrc.Next()));
+   }
+}
+
+#define BLEND_CASE(mode,blend) \
+   case mode: \
+      if (dest_alpha) \
+         TBlitBlendRows< blend<true> >(outDest,inSrc,inMask,inX,inY,inSrcRect); \
+      else \
+         TBlitBlendRows< blend<false> >(outDest,inSrc,inMask,inX,inY,inSrcRect); \
+      break;
+
+template<typename MASK,typename SOURCE>
+void TBlitBlend( const ImageDest<ARGB> &outDest, SOURCE &inSrc,const MASK &inMask,
+            int inX, int inY, const Rect &inSrcRect, BlendMode inMode)
+{
+   bool dest_alpha = outDest.Format() & pfHasAlpha;
+
+   if (!dest_alpha && TSpanBlitBlend(outDest,inSrc,inMask,inX,inY,inSrcRect,inMode))
+      return;
+
+   switch(inMode)
+   {
+      BLEND_CASE(bmNormal,NormalFunc)
+      BLEND_CASE(bmLayer,NormalFunc)
+      BLEND_CASE(bmMultiply,MultiplyFunc)
+      BLEND_CASE(bmScreen,ScreenFunc)
+      BLEND_CASE(bmLighten,LightenFunc)
+      BLEND_CASE(bmDarken,DarkenFunc)
+      BLEND_CASE(bmDifference,DifferenceFunc)
+      BLEND_CASE(bmAdd,AddFunc)
+      BLEND_CASE(bmSubtract,SubtractFunc)
+      BLEND_CASE(bmInvert,InvertFunc)
+      BLEND_CASE(bmAlpha,AlphaFunc)
+      BLEND_CASE(bmErase,EraseFunc)
+      BLEND_CASE(bmOverlay,OverlayFunc)
+      BLEND_CASE(bmHardLight,HardLightFunc)
+      BLEND_CASE(bmCopy,CopyFunc)
+      BLEND_CASE(bmInner,InnerFunc)
+      default: ;
    }
 }
 
+#undef BLEND_CASE
 
 
 
@@ -1063,8 +1183,7 @@ void SimpleSurface::dispose()
       {
          ELOG("Image write overflow");
       }
-      delete [] mBase;
-      mBase = NULL;
+      FreeBase();
    }
 }
 
@@ -1476,6 +1595,37 @@ void SimpleSurface::noise(unsigned int randomSeed, unsigned int low, unsigned in
 }
 
 
+// The texture upload is told the pixels are already premultiplied, so it does not do it again
+void SimpleSurface::multiplyAlpha()
+{
+   if (!mBase || (mFlags & surfHasPremultipliedAlpha))
+      return;
+   Rect r = Rect(0,0,mWidth,mHeight);
+   mVersion++;
+   if (mTexture)
+      mTexture->Dirty(r);
+
+   if (mPixelFormat!=pfARGB)
+      return;
+   mFlags |= surfHasPremultipliedAlpha;
+
+   for(int y=0;y<r.h;y++)
+   {
+      uint8 *dest = mBase + (r.y+y)*mStride + r.x*4;
+      for(int x=0;x<r.w;x++)
+      {
+         int a = dest[3];
+         if (a!=255)
+         {
+            dest[0] = (dest[0]*a + 127)/255;
+            dest[1] = (dest[1]*a + 127)/255;
+            dest[2] = (dest[2]*a + 127)/255;
+         }
+         dest += 4;
+      }
+   }
+}
+
 void SimpleSurface::unmultiplyAlpha()
 {
    if (!mBase)
@@ -1484,6 +1634,7 @@ void SimpleSurface::unmultiplyAlpha()
    mVersion++;
    if (mTexture)
       mTexture->Dirty(r);
+   mFlags &= ~surfHasPremultipliedAlpha;
    
    if (mPixelFormat==pfAlpha)
       return;
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <Surface.h>
 #include <ByteArray.h>
+#include <MappedFile.h>
 
 
 extern "C" {
@@ -524,73 +525,13 @@ namespace nme {
 
 Surface *Surface::Load(const OSChar *inFilename)
 {
-   FILE *file = OpenRead(inFilename);
+   // The decoders read straight from the mapped file, without a copy
+   MappedFile *file = MappedFile::Open(inFilename);
    if (!file)
-   {
-      #ifdef ANDROID
-      ByteArray bytes = AndroidGetAssetBytes(inFilename);
-      if (bytes.Ok())
-      {
-         Surface *result = LoadFromBytes(bytes.Bytes(), bytes.Size());
-         return result;
-      }
-
-      #endif
       return 0;
-   }
-
-   int len = 0;
-   while(inFilename[len])
-      len++;
-
-   bool jpegFirst = false;
-   bool pngFirst = false;
-   if (len>4)
-   {
-      // Jpeg/jpg
-      if (inFilename[len-4]=='j' || inFilename[len-4]=='J' || 
-             inFilename[len-3]=='j' || inFilename[len-4]=='J' )
-         jpegFirst = true;
-      else if (inFilename[len-3]=='p' || inFilename[len-3]=='P' )
-         pngFirst = true;
-   }
-   Surface *result = 0;
-
-   if (jpegFirst)
-   {
-      result = TryJPEG(file,0,0);
-      if (!result)
-      {
-         rewind(file);
-         result = TryPNG(file,0,0);
-      }
-   }
-   else if (pngFirst)
-   {
-      result = TryPNG(file,0,0);
-      if (!result)
-      {
-         rewind(file);
-         result = TryJPEG(file,0,0);
-      }
-   }
-   else
-   {
-      uint8 first = 0;
-      fread(&first,1,1,file);
-      if (first==0xff)
-      {
-         rewind(file);
-         result = TryJPEG(file,0,0);
-      }
-      else if (first==0x89)
-      {
-         rewind(file);
-         result = TryPNG(file,0,0);
-      }
-   }
 
-   fclose(file);
+   Surface *result = LoadFromBytes(file->Bytes(), file->Size());
+   file->DecRef();
    return result;
 }
 
@@ -0,0 +1,101 @@
+#include <SurfaceLoader.h>
+#include <AssetPack.h>
+#include <string.h>
+
+namespace nme
+{
+
+SurfaceLoader::SurfaceLoader(int inFormat, int inFlags) :
+   mFormat(inFormat), mFlags(inFlags), mResult(0)
+{
+}
+
+SurfaceLoader::~SurfaceLoader()
+{
+   // A queued decode still uses our buffers
+   WaitWorkerTask(this);
+   if (mResult)
+      mResult->DecRef();
+}
+
+SurfaceLoader *SurfaceLoader::Create(const OSChar *inFilename, int inFormat, int inFlags)
+{
+   SurfaceLoader *loader = new SurfaceLoader(inFormat,inFlags);
+
+   int len = 0;
+   while(inFilename[len])
+      len++;
+   loader->mFilename.resize(len+1);
+   memcpy(&loader->mFilename[0], inFilename, (len+1)*sizeof(OSChar));
+
+   #ifdef ANDROID
+   // Assets come through java, which the workers can not call, so read them here
+   FILE *file = OpenRead(inFilename);
+   if (file)
+      fclose(file);
+   else if (!AssetPack::Contains(inFilename))
+   {
+      ByteArray bytes = AndroidGetAssetBytes(inFilename);
+      if (bytes.Ok() && bytes.Size()>0)
+      {
+         loader->mBytes.resize(bytes.Size());
+         memcpy(&loader->mBytes[0], bytes.Bytes(), bytes.Size());
+      }
+      loader->mFilename.resize(0);
+   }
+   #endif
+
+   QueueWorkerTask(loader);
+   return loader;
+}
+
+SurfaceLoader *SurfaceLoader::Create(const uint8 *inBytes, int inLen, int inFormat, int inFlags)
+{
+   SurfaceLoader *loader = new SurfaceLoader(inFormat,inFlags);
+   if (inBytes && inLen>0)
+   {
+      loader->mBytes.resize(inLen);
+      memcpy(&loader->mBytes[0], inBytes, inLen);
+   }
+
+   QueueWorkerTask(loader);
+   return loader;
+}
+
+// On a worker thread - only the decoders, and our own members, may be touched
+void SurfaceLoader::RunTask(int inIndex)
+{
+   Surface *result = 0;
+   if (mFilename.size())
+      result = Surface::Load(&mFilename[0]);
+   else if (mBytes.size())
+      result = Surface::LoadFromBytes(&mBytes[0], mBytes.size());
+
+   QuickVec<uint8> empty;
+   mBytes.swap(empty);
+
+   if (result)
+   {
+      if (mFormat==1)
+         result->setGPUFormat( pfARGB4444 );
+      else if (mFormat==2)
+         result->setGPUFormat( pfRGB565 );
+
+      if (mFlags & loadPremultiply)
+         result->multiplyAlpha();
+   }
+   mResult = result;
+}
+
+bool SurfaceLoader::IsDone()
+{
+   return IsWorkerTaskDone(this);
+}
+
+Surface *SurfaceLoader::GetResult()
+{
+   WaitWorkerTask(this);
+   return mResult;
+}
+
+} // end namespace nme
@@ -1915,7 +1915,8 @@ void TextField::Render( const RenderTarget &inTarget, const RenderState &inState
 }
 
 
-void TextField::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke)
+void TextField::GetExtent(const Transform &inTrans, Extent2DF &outExt,bool inForBitmap,bool inIncludeStroke,
+                          bool inForHitTest)
 {
    Layout(*inTrans.mMatrix);
 
@@ -27,4 +27,313 @@ bool IsMainThread()
 }
 
 
+
+// --- Worker pool ---------------------------------------------------------
+
+#if defined(HX_WINRT) || defined(EMSCRIPTEN)
+#define NME_NO_WORKER_THREADS
+#endif
+
+enum { wqIdle, wqQueued, wqRunning, wqDone };
+
+#ifndef NME_NO_WORKER_THREADS
+
+#ifdef HX_WINDOWS
+typedef CRITICAL_SECTION   WorkerLock;
+typedef CONDITION_VARIABLE WorkerCond;
+static void WorkerLockInit(WorkerLock &l) { InitializeCriticalSection(&l); }
+static void WorkerCondInit(WorkerCond &c) { InitializeConditionVariable(&c); }
+static void WorkerLockEnter(WorkerLock &l) { EnterCriticalSection(&l); }
+static void WorkerLockLeave(WorkerLock &l) { LeaveCriticalSection(&l); }
+static void WorkerCondWait(WorkerCond &c, WorkerLock &l) { SleepConditionVariableCS(&c,&l,INFINITE); }
+static void WorkerCondSignalAll(WorkerCond &c) { WakeAllConditionVariable(&c); }
+#else
+typedef pthread_mutex_t WorkerLock;
+typedef pthread_cond_t  WorkerCond;
+static void WorkerLockInit(WorkerLock &l) { pthread_mutex_init(&l,0); }
+static void WorkerCondInit(WorkerCond &c) { pthread_cond_init(&c,0); }
+static void WorkerLockEnter(WorkerLock &l) { pthread_mutex_lock(&l); }
+static void WorkerLockLeave(WorkerLock &l) { pthread_mutex_unlock(&l); }
+static void WorkerCondWait(WorkerCond &c, WorkerLock &l) { pthread_cond_wait(&c,&l); }
+static void WorkerCondSignalAll(WorkerCond &c) { pthread_cond_broadcast(&c); }
+#endif
+
+static bool        sWorkerInit = false;
+static WorkerLock  sWorkerLock;
+static WorkerCond  sWorkerWake;
+static WorkerCond  sWorkerDone;
+static int         sWorkerThreads = 0;
+static int         sWorkerRequested = 0;
+
+// Current job - protected by sWorkerLock
+static WorkerTask  *sWorkerTask = 0;
+static int         sWorkerNext = 0;
+static int         sWorkerCount = 0;
+static int         sWorkerRunning = 0;
+
+// Background tasks - protected by sWorkerLock
+static WorkerTask  *sQueueHead = 0;
+static WorkerTask  *sQueueTail = 0;
+
+
+// Take indices from the current task until there are none left - called with lock held
+static void WorkerRunLocked()
+{
+   while(sWorkerTask && sWorkerNext<sWorkerCount)
+   {
+      WorkerTask *task = sWorkerTask;
+      int index = sWorkerNext++;
+      sWorkerRunning++;
+      WorkerLockLeave(sWorkerLock);
+
+      task->RunTask(index);
+
+      WorkerLockEnter(sWorkerLock);
+      sWorkerRunning--;
+      if (sWorkerNext>=sWorkerCount && sWorkerRunning==0)
+         WorkerCondSignalAll(sWorkerDone);
+   }
+}
+
+
+// Run the oldest background task - called with lock held
+static void WorkerRunQueuedLocked()
+{
+   WorkerTask *task = sQueueHead;
+   sQueueHead = task->mNextQueued;
+   if (!sQueueHead)
+      sQueueTail = 0;
+   task->mNextQueued = 0;
+   task->mQueueState = wqRunning;
+   WorkerLockLeave(sWorkerLock);
+
+   task->RunTask(0);
+
+   WorkerLockEnter(sWorkerLock);
+   task->mQueueState = wqDone;
+   WorkerCondSignalAll(sWorkerDone);
+}
+
+
+#ifdef HX_WINDOWS
+static DWORD WINAPI WorkerMain(void *)
+#else
+static void *WorkerMain(void *)
+#endif
+{
+   WorkerLockEnter(sWorkerLock);
+   while(true)
+   {
+      while( (!sWorkerTask || sWorkerNext>=sWorkerCount) && !sQueueHead)
+         WorkerCondWait(sWorkerWake,sWorkerLock);
+
+      // Split jobs are waited on, so they take priority
+      if (sWorkerTask && sWorkerNext<sWorkerCount)
+         WorkerRunLocked();
+      else
+         WorkerRunQueuedLocked();
+   }
+   WorkerLockLeave(sWorkerLock);
+   return 0;
+}
+
+
+int GetWorkerThreads()
+{
+   return sWorkerRequested;
+}
+
+
+void SetWorkerThreads(int inThreads)
+{
+   if (inThreads<0)
+      inThreads = 0;
+   if (!IsMainThread())
+      return;
+
+   if (!sWorkerInit)
+   {
+      sWorkerInit = true;
+      WorkerLockInit(sWorkerLock);
+      WorkerCondInit(sWorkerWake);
+      WorkerCondInit(sWorkerDone);
+   }
+
+   // Threads are never destroyed - reducing the count limits how many bands are created
+   while(sWorkerThreads<inThreads)
+   {
+      #ifdef HX_WINDOWS
+      HANDLE handle = CreateThread(0, 0, WorkerMain, 0, 0, 0);
+      if (!handle)
+         break;
+      CloseHandle(handle);
+      #else
+      pthread_t thread;
+      if (pthread_create(&thread, 0, WorkerMain, 0)!=0)
+         break;
+      pthread_detach(thread);
+      #endif
+      sWorkerThreads++;
+   }
+   sWorkerRequested = inThreads < sWorkerThreads ? inThreads : sWorkerThreads;
+}
+
+
+void RunWorkerTask(WorkerTask *inTask, int inCount)
+{
+   bool parallel = inCount>1 && sWorkerRequested>0;
+   if (parallel)
+   {
+      WorkerLockEnter(sWorkerLock);
+      // Someone else is using the pool (eg, nested call) - do it ourselves
+      if (sWorkerTask)
+      {
+         WorkerLockLeave(sWorkerLock);
+         parallel = false;
+      }
+   }
+
+   if (!parallel)
+   {
+      for(int i=0;i<inCount;i++)
+         inTask->RunTask(i);
+      return;
+   }
+
+   sWorkerTask = inTask;
+   sWorkerNext = 0;
+   sWorkerCount = inCount;
+   sWorkerRunning = 0;
+   WorkerCondSignalAll(sWorkerWake);
+
+   WorkerRunLocked();
+   while(sWorkerNext<sWorkerCount || sWorkerRunning>0)
+      WorkerCondWait(sWorkerDone,sWorkerLock);
+
+   sWorkerTask = 0;
+   WorkerLockLeave(sWorkerLock);
+}
+
+
+void QueueWorkerTask(WorkerTask *inTask)
+{
+   if (sWorkerRequested==0)
+   {
+      inTask->RunTask(0);
+      inTask->mQueueState = wqDone;
+      return;
+   }
+
+   WorkerLockEnter(sWorkerLock);
+   inTask->mQueueState = wqQueued;
+   inTask->mNextQueued = 0;
+   if (sQueueTail)
+      sQueueTail->mNextQueued = inTask;
+   else
+      sQueueHead = inTask;
+   sQueueTail = inTask;
+   WorkerCondSignalAll(sWorkerWake);
+   WorkerLockLeave(sWorkerLock);
+}
+
+
+bool IsWorkerTaskDone(WorkerTask *inTask)
+{
+   if (!sWorkerInit)
+      return inTask->mQueueState==wqDone;
+
+   WorkerLockEnter(sWorkerLock);
+   bool result = inTask->mQueueState==wqDone;
+   WorkerLockLeave(sWorkerLock);
+   return result;
+}
+
+
+// Take a task that has not started out of the queue - called with lock held
+static void WorkerUnqueueLocked(WorkerTask *inTask)
+{
+   WorkerTask *prev = 0;
+   for(WorkerTask *t=sQueueHead; t!=inTask; t=t->mNextQueued)
+      prev = t;
+   if (prev)
+      prev->mNextQueued = inTask->mNextQueued;
+   else
+      sQueueHead = inTask->mNextQueued;
+   if (sQueueTail==inTask)
+      sQueueTail = prev;
+   inTask->mNextQueued = 0;
+}
+
+
+void WaitWorkerTask(WorkerTask *inTask)
+{
+   if (!sWorkerInit)
+      return;
+
+   WorkerLockEnter(sWorkerLock);
+   if (inTask->mQueueState==wqQueued)
+   {
+      // Not started - take it out of the queue and do it here
+      WorkerUnqueueLocked(inTask);
+      inTask->mQueueState = wqRunning;
+      WorkerLockLeave(sWorkerLock);
+
+      inTask->RunTask(0);
+
+      WorkerLockEnter(sWorkerLock);
+      inTask->mQueueState = wqDone;
+   }
+
+   while(inTask->mQueueState==wqRunning)
+      WorkerCondWait(sWorkerDone,sWorkerLock);
+   WorkerLockLeave(sWorkerLock);
+}
+
+
+bool CancelWorkerTask(WorkerTask *inTask)
+{
+   if (!sWorkerInit)
+      return false;
+
+   WorkerLockEnter(sWorkerLock);
+   bool dropped = inTask->mQueueState==wqQueued;
+   if (dropped)
+   {
+      WorkerUnqueueLocked(inTask);
+      inTask->mQueueState = wqIdle;
+   }
+
+   while(inTask->mQueueState==wqRunning)
+      WorkerCondWait(sWorkerDone,sWorkerLock);
+   WorkerLockLeave(sWorkerLock);
+   return dropped;
+}
+
+#else
+
+int GetWorkerThreads() { return 0; }
+
+void SetWorkerThreads(int inThreads) { }
+
+void RunWorkerTask(WorkerTask *inTask, int inCount)
+{
+   for(int i=0;i<inCount;i++)
+      inTask->RunTask(i);
+}
+
+void QueueWorkerTask(WorkerTask *inTask)
+{
+   inTask->RunTask(0);
+   inTask->mQueueState = wqDone;
+}
+
+bool IsWorkerTaskDone(WorkerTask *inTask) { return inTask->mQueueState==wqDone; }
+
+void WaitWorkerTask(WorkerTask *inTask) { }
+
+bool CancelWorkerTask(WorkerTask *inTask) { return false; }
+
+#endif
+
+
 } // end namespace nmE
@@ -1,26 +1,20 @@
 #include <Tilesheet.h>
 #include <Surface.h>
-#include <algorithm>
 
 namespace nme
 {
 
-Tilesheet::Tilesheet(int inWidth,int inHeight,PixelFormat inFormat, bool inInitRef) : Object(inInitRef)
+Tilesheet::Tilesheet(int inWidth,int inHeight,PixelFormat inFormat, bool inInitRef) :
+   Object(inInitRef), mPacker(inWidth,inHeight)
 {
-   mCurrentX = 0;
-   mCurrentY = 0;
-   mMaxHeight = 0;
    mSheet = new SimpleSurface(inWidth,inHeight,inFormat);
    mSheet->IncRef();
 }
 
-Tilesheet::Tilesheet(Surface *inSurface,bool inInitRef) : Object(inInitRef)
+Tilesheet::Tilesheet(Surface *inSurface,bool inInitRef) :
+   Object(inInitRef), mPacker(inSurface->Width(),inSurface->Height())
 {
-   mCurrentX = 0;
-   mCurrentY = 0;
-   mMaxHeight = 0;
    mSheet = inSurface->IncRef();
-
 }
 
 
@@ -31,41 +25,21 @@ Tilesheet::~Tilesheet()
 
 int Tilesheet::AllocRect(int inW,int inH,float inOx, float inOy,bool inAlphaBorder)
 {
+   // The border keeps a clear pixel to the right and below, so smooth sampling
+   //  does not pick up the neighbours
+   int border = inAlphaBorder ? 1 : 0;
+   Rect rect;
+   if (!mPacker.Alloc(inW+border,inH+border,rect))
+      return -1;
+
    Tile tile;
    tile.mOx = inOx;
    tile.mOy = inOy;
    tile.mSurface = mSheet;
-
-   // does it fit on the current row ?
-   int cx = mCurrentX;
-   if (inAlphaBorder && cx>0)
-      cx++;
-   int cy = mCurrentY;
-   if (inAlphaBorder && cy>0)
-      cy++;
-   if (cx + inW <= mSheet->Width() && cy + inH < mSheet->Height())
-   {
-      tile.mRect = Rect(cx, cy, inW, inH);
-      tile.mFRect = FRect(cx, cy, inW, inH);
-      int result = mTiles.size();
-      mTiles.push_back(tile);
-      mCurrentX = cx+inW;
-      mMaxHeight = std::max(mMaxHeight,inH+cy-mCurrentY);
-      return result;
-   }
-   // No - go to next row
-   mCurrentY += mMaxHeight;
-   mCurrentX = 0;
-   mMaxHeight = 0;
-   if (inW>mSheet->Width() || mCurrentY + inH > mSheet->Height())
-      return -1;
-
-   tile.mRect = Rect(mCurrentX, mCurrentY, inW, inH);
-   tile.mFRect = FRect(mCurrentX, mCurrentY, inW, inH);
+   tile.mRect = Rect(rect.x, rect.y, inW, inH);
+   tile.mFRect = FRect(rect.x, rect.y, inW, inH);
    int result = mTiles.size();
    mTiles.push_back(tile);
-   mCurrentX += inW;
-   mMaxHeight = std::max(mMaxHeight,inH);
    return result;
 }
 
@@ -38,6 +38,8 @@
 #endif
 
 #include "ByteArray.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
 
 namespace nme
 {
@@ -56,6 +58,14 @@ std::string gFile = "Application";
 
 ByteArray ByteArray::FromFile(const OSChar *inFilename)
 {
+   MappedFile *packed = AssetPack::Open(inFilename);
+   if (packed)
+   {
+      ByteArray result(packed->Bytes(), packed->Size());
+      packed->DecRef();
+      return result;
+   }
+
    FILE *file = OpenRead(inFilename);
    if (!file)
    {
@@ -93,6 +103,14 @@ FILE *OpenRead(const char *inUtf8Name)
 
 ByteArray ByteArray::FromFile(const char *inFilename)
 {
+   MappedFile *packed = AssetPack::Open(inFilename);
+   if (packed)
+   {
+      ByteArray result(packed->Bytes(), packed->Size());
+      packed->DecRef();
+      return result;
+   }
+
    FILE *file = fopen(inFilename,"rb");
    if (!file)
       return ByteArray();
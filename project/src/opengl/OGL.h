@@ -149,6 +149,7 @@ typedef void *GLCtx;
 
 #include <Graphics.h>
 #include <Surface.h>
+#include <Profile.h>
 
 
 
@@ -165,6 +166,8 @@ namespace nme
 {
 
 Texture *OGLCreateTexture(Surface *inSurface,unsigned int inFlags);
+// Returns 0 if the surface is not suitable for the atlas, or there is no room
+Texture *OGLCreateAtlasTexture(Surface *inSurface,unsigned int inFlags);
 
 enum
 {
@@ -206,6 +209,212 @@ public:
 
 void InitOGL2Extensions();
 
+
+// --- GL state cache ---------------------------------------------------------
+//
+// A shadow of the state that is most often set again to the value it already has - the
+//  program, texture and buffer bindings, blending, viewport and scissor - so calls that
+//  would change nothing are skipped, and counted in the profiler.  The renderer and the
+//  gl prims both go through here.  Code changing this state directly must call
+//  Invalidate, after which the next call of each kind goes through.  Main thread only.
+class GLStateCache
+{
+public:
+   enum { MAX_UNITS = 16 };
+
+   GLStateCache() { Invalidate(); }
+
+   void Invalidate()
+   {
+      mProgram = mArrayBuffer = mElementBuffer = mUnit = sUnknown;
+      for(int i=0;i<MAX_UNITS;i++)
+         mTexture[i] = sUnknown;
+      for(int i=0;i<4;i++)
+         mBlend[i] = sUnknown;
+      mBlendEnabled = mScissorEnabled = -1;
+      mViewportKnown = mScissorKnown = false;
+   }
+
+   // GL unbinds deleted objects, and may hand out their ids again
+   void ForgetTexture(GLuint inTexture)
+   {
+      for(int i=0;i<MAX_UNITS;i++)
+         if (mTexture[i]==inTexture)
+            mTexture[i] = sUnknown;
+   }
+   void ForgetBuffer(GLuint inBuffer)
+   {
+      if (mArrayBuffer==inBuffer)
+         mArrayBuffer = sUnknown;
+      if (mElementBuffer==inBuffer)
+         mElementBuffer = sUnknown;
+   }
+   void ForgetProgram(GLuint inProgram)
+   {
+      if (mProgram==inProgram)
+         mProgram = sUnknown;
+   }
+
+   void UseProgram(GLuint inProgram)
+   {
+      if (Same(mProgram,inProgram))
+         return;
+      glUseProgram(inProgram);
+   }
+
+   // inUnit is GL_TEXTURE0 + n
+   void ActiveTexture(GLenum inUnit)
+   {
+      if (Same(mUnit,inUnit))
+         return;
+      if (CHECK_EXT(glActiveTexture))
+         glActiveTexture(inUnit);
+   }
+
+   // Only the 2D bindings are tracked
+   void BindTexture(GLenum inTarget, GLuint inTexture)
+   {
+      if (inTarget==GL_TEXTURE_2D)
+      {
+         GLuint unit = mUnit==sUnknown ? sUnknown : mUnit-GL_TEXTURE0;
+         if (unit<MAX_UNITS)
+         {
+            if (Same(mTexture[unit],inTexture))
+               return;
+         }
+         else
+            Invalidate2DTextures();
+      }
+      glBindTexture(inTarget,inTexture);
+   }
+
+   void BindBuffer(GLenum inTarget, GLuint inBuffer)
+   {
+      if (inTarget==GL_ARRAY_BUFFER)
+      {
+         if (Same(mArrayBuffer,inBuffer))
+            return;
+      }
+      else if (inTarget==GL_ELEMENT_ARRAY_BUFFER)
+      {
+         if (Same(mElementBuffer,inBuffer))
+            return;
+      }
+      glBindBuffer(inTarget,inBuffer);
+   }
+
+   void BlendFunc(GLenum inSrc, GLenum inDest)
+   {
+      if (mBlend[0]==inSrc && mBlend[1]==inDest && mBlend[2]==inSrc && mBlend[3]==inDest)
+      {
+         ProfileCount(pcSkippedStateCalls);
+         return;
+      }
+      mBlend[0] = mBlend[2] = inSrc;
+      mBlend[1] = mBlend[3] = inDest;
+      glBlendFunc(inSrc,inDest);
+   }
+
+   void BlendFuncSeparate(GLenum inSrcRGB, GLenum inDestRGB, GLenum inSrcA, GLenum inDestA)
+   {
+      if (mBlend[0]==inSrcRGB && mBlend[1]==inDestRGB && mBlend[2]==inSrcA && mBlend[3]==inDestA)
+      {
+         ProfileCount(pcSkippedStateCalls);
+         return;
+      }
+      mBlend[0] = inSrcRGB;
+      mBlend[1] = inDestRGB;
+      mBlend[2] = inSrcA;
+      mBlend[3] = inDestA;
+      glBlendFuncSeparate(inSrcRGB,inDestRGB,inSrcA,inDestA);
+   }
+
+   // Only GL_BLEND and GL_SCISSOR_TEST are tracked
+   void Enable(GLenum inCap, bool inEnable=true)
+   {
+      int *known = inCap==GL_BLEND ? &mBlendEnabled : inCap==GL_SCISSOR_TEST ? &mScissorEnabled : 0;
+      if (known)
+      {
+         if (*known==(int)inEnable)
+         {
+            ProfileCount(pcSkippedStateCalls);
+            return;
+         }
+         *known = inEnable;
+      }
+      if (inEnable)
+         glEnable(inCap);
+      else
+         glDisable(inCap);
+   }
+   void Disable(GLenum inCap) { Enable(inCap,false); }
+
+   void Viewport(int inX, int inY, int inW, int inH)
+   {
+      if (SameRect(mViewportKnown,mViewport,inX,inY,inW,inH))
+         return;
+      glViewport(inX,inY,inW,inH);
+   }
+
+   void Scissor(int inX, int inY, int inW, int inH)
+   {
+      if (SameRect(mScissorKnown,mScissor,inX,inY,inW,inH))
+         return;
+      glScissor(inX,inY,inW,inH);
+   }
+
+private:
+   static const GLuint sUnknown = 0xffffffff;
+
+   // Records the new value, and returns true if the call can be skipped
+   inline bool Same(GLuint &ioKnown, GLuint inValue)
+   {
+      if (ioKnown==inValue)
+      {
+         ProfileCount(pcSkippedStateCalls);
+         return true;
+      }
+      ioKnown = inValue;
+      return false;
+   }
+
+   inline bool SameRect(bool &ioKnown, int *ioRect, int inX, int inY, int inW, int inH)
+   {
+      if (ioKnown && ioRect[0]==inX && ioRect[1]==inY && ioRect[2]==inW && ioRect[3]==inH)
+      {
+         ProfileCount(pcSkippedStateCalls);
+         return true;
+      }
+      ioKnown = true;
+      ioRect[0] = inX;
+      ioRect[1] = inY;
+      ioRect[2] = inW;
+      ioRect[3] = inH;
+      return false;
+   }
+
+   void Invalidate2DTextures()
+   {
+      for(int i=0;i<MAX_UNITS;i++)
+         mTexture[i] = sUnknown;
+   }
+
+   GLuint mProgram;
+   GLuint mUnit;
+   GLuint mTexture[MAX_UNITS];
+   GLuint mArrayBuffer;
+   GLuint mElementBuffer;
+   GLenum mBlend[4];
+   int    mBlendEnabled;
+   int    mScissorEnabled;
+   bool   mViewportKnown;
+   bool   mScissorKnown;
+   int    mViewport[4];
+   int    mScissor[4];
+};
+
+extern GLStateCache gGLState;
+
 } // end namespace nme
 
 
@@ -417,7 +417,7 @@ DEFINE_PRIM(nme_gl_version,0);
 
 value nme_gl_enable(value inCap)
 {
-   glEnable(val_int(inCap));
+   gGLState.Enable(val_int(inCap));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_enable,1);
@@ -425,7 +425,7 @@ DEFINE_PRIM(nme_gl_enable,1);
 
 value nme_gl_disable(value inCap)
 {
-   glDisable(val_int(inCap));
+   gGLState.Disable(val_int(inCap));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_disable,1);
@@ -869,7 +869,7 @@ DEFINE_PRIM(nme_gl_blend_equation_separate,2);
 
 value nme_gl_blend_func(value s, value d)
 {
-   glBlendFunc(val_int(s), val_int(d));
+   gGLState.BlendFunc(val_int(s), val_int(d));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_blend_func,2);
@@ -877,7 +877,7 @@ DEFINE_PRIM(nme_gl_blend_func,2);
 
 value nme_gl_blend_func_separate(value srgb, value drgb, value sa, value da)
 {
-   glBlendFuncSeparate(val_int(srgb), val_int(drgb), val_int(sa), val_int(da) );
+   gGLState.BlendFuncSeparate(val_int(srgb), val_int(drgb), val_int(sa), val_int(da) );
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_blend_func_separate,4);
@@ -1056,12 +1056,18 @@ value nme_gl_get_program_parameter(value inId,value inName)
 DEFINE_PRIM(nme_gl_get_program_parameter,2);
 
 
+// The binding calls are shared with the command buffer
+static void useProgram(value inProgram)
+{
+   getGLCurrentData()->currentProgram.set(inProgram);
+   int id = getResourceId(inProgram,resoProgram);
+   gGLState.UseProgram(id);
+}
+
 value nme_gl_use_program(value inId)
 {
    DBGFUNC("useProgram");
-   getGLCurrentData()->currentProgram.set(inId);
-   int id = getResourceId(inId,resoProgram);
-   glUseProgram(id);
+   useProgram(inId);
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_use_program,1);
@@ -1493,17 +1499,21 @@ DEFINE_PRIM(nme_gl_get_shader_precision_format,2);
 // --- Buffer -------------------------------------------
 
 
+static void bindBuffer(int inTarget, value inBuffer)
+{
+   int id = getResourceId(inBuffer,resoBuffer);
+   if (inTarget==GL_ARRAY_BUFFER)
+      getGLCurrentData()->arrayBufferBinding.set(inBuffer);
+   else if (inTarget==GL_ELEMENT_ARRAY_BUFFER)
+      getGLCurrentData()->elementArrayBufferBinding.set(inBuffer);
+
+   gGLState.BindBuffer(inTarget,id);
+}
+
 value nme_gl_bind_buffer(value inTarget, value inId )
 {
    DBGFUNC("bindBuffer");
-   int id = getResourceId(inId,resoBuffer);
-   int target = val_int(inTarget);
-   if (target==GL_ARRAY_BUFFER)
-      getGLCurrentData()->arrayBufferBinding.set(inId);
-   else if (target==GL_ELEMENT_ARRAY_BUFFER)
-      getGLCurrentData()->elementArrayBufferBinding.set(inId);
-
-   glBindBuffer(target,id);
+   bindBuffer(val_int(inTarget), inId);
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_bind_buffer,2);
@@ -1630,13 +1640,12 @@ DEFINE_PRIM(nme_gl_get_buffer_parameter,2);
 
 // --- Framebuffer -------------------------------
 
-value nme_gl_bind_framebuffer(value target, value framebuffer)
+static void bindFramebuffer(int inTarget, value inFramebuffer)
 {
-   DBGFUNC("bindFramebuffer");
    if (CHECK_EXT(glBindFramebuffer))
    {
-      getGLCurrentData()->framebufferBinding.set(framebuffer);
-      int id = getResourceId(framebuffer,resoFramebuffer);
+      getGLCurrentData()->framebufferBinding.set(inFramebuffer);
+      int id = getResourceId(inFramebuffer,resoFramebuffer);
       #ifdef IPHONE
       if (id==0)
       {
@@ -1648,8 +1657,14 @@ value nme_gl_bind_framebuffer(value target, value framebuffer)
          }
       } 
       #endif
-      glBindFramebuffer(val_int(target), id );
+      glBindFramebuffer(inTarget, id );
    }
+}
+
+value nme_gl_bind_framebuffer(value target, value framebuffer)
+{
+   DBGFUNC("bindFramebuffer");
+   bindFramebuffer(val_int(target), framebuffer);
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_bind_framebuffer,2);
@@ -1769,7 +1784,7 @@ DEFINE_PRIM(nme_gl_draw_elements,4);
 
 value nme_gl_viewport(value inX, value inY, value inW,value inH)
 {
-   glViewport(val_int(inX),val_int(inY),val_int(inW),val_int(inH));
+   gGLState.Viewport(val_int(inX),val_int(inY),val_int(inW),val_int(inH));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_viewport,4);
@@ -1777,7 +1792,7 @@ DEFINE_PRIM(nme_gl_viewport,4);
 
 value nme_gl_scissor(value inX, value inY, value inW,value inH)
 {
-   glScissor(val_int(inX),val_int(inY),val_int(inW),val_int(inH));
+   gGLState.Scissor(val_int(inX),val_int(inY),val_int(inW),val_int(inH));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_scissor,4);
@@ -1914,26 +1929,28 @@ DEFINE_PRIM(nme_gl_sample_coverage,2);
 
 // --- Texture -------------------------------------------
 
+static void activeTexture(int inSlot)
+{
+   getGLCurrentData()->setCurrentTextureSlot( inSlot - GL_TEXTURE0 );
+   gGLState.ActiveTexture(inSlot);
+}
+
 value nme_gl_active_texture(value inSlot)
 {
-   int slot = val_int(inSlot);
-   getGLCurrentData()->setCurrentTextureSlot( slot - GL_TEXTURE0 );
-   glActiveTexture(slot);
+   activeTexture(val_int(inSlot));
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_active_texture,1);
 
 
 
-value nme_gl_bind_texture(value inTarget, value inTexture)
+static void bindTexture(int target, value inTexture)
 {
-   DBGFUNC("bindTexture");
    int tid = 0;
-   int target = val_int(inTarget);
    if (target!=GL_TEXTURE_2D && target!=GL_TEXTURE_CUBE_MAP)
    {
       ELOG("Warning invalid texture target %d", target);
-      return alloc_null();
+      return;
    }
 
    value glObject = 0;
@@ -1950,7 +1967,13 @@ value nme_gl_bind_texture(value inTarget, value inTexture)
 
    getGLCurrentData()->setTexture(glObject, target==GL_TEXTURE_CUBE_MAP);
 
-   glBindTexture(val_int(inTarget), tid );
+   gGLState.BindTexture(target, tid );
+}
+
+value nme_gl_bind_texture(value inTarget, value inTexture)
+{
+   DBGFUNC("bindTexture");
+   bindTexture(val_int(inTarget), inTexture);
    return alloc_null();
 }
 DEFINE_PRIM(nme_gl_bind_texture,2);
@@ -1966,7 +1989,8 @@ value nme_gl_bind_bitmap_data_texture(value inBitmapData)
          ctx = nme::HardwareRenderer::current;
       if (ctx)
       {
-         Texture *texture = surface->GetTexture(gDirectRenderContext);
+         // Shaders expect the tex-coords to cover the whole texture
+         Texture *texture = surface->GetOwnTexture(gDirectRenderContext);
          if (texture)
             texture->Bind(-1);
       }
@@ -2133,6 +2157,282 @@ value nme_gl_get_tex_parameter(value inTarget,value inPname)
 DEFINE_PRIM(nme_gl_get_tex_parameter,2);
 
 
+
+// --- Command buffer -------------------------------------------
+//
+// GLCommandBuffer writes the calls into a ByteArray as little endian 32 bit words - an
+//  opcode, then its arguments as ints or floats - so a frame of calls costs one prim.
+//  GL objects are passed as an index into a separate array, or -1 for null.
+// These values must match nme/gl/GLCommandBuffer.hx
+
+enum GLCommandOp
+{
+   cmdActiveTexture = 1,
+   cmdBindBuffer,
+   cmdBindFramebuffer,
+   cmdBindTexture,
+   cmdBlendFunc,
+   cmdBlendFuncSeparate,
+   cmdBufferSubData,
+   cmdClear,
+   cmdClearColor,
+   cmdColorMask,
+   cmdCullFace,
+   cmdDepthFunc,
+   cmdDepthMask,
+   cmdDisable,
+   cmdDisableVertexAttribArray,
+   cmdDrawArrays,
+   cmdDrawElements,
+   cmdEnable,
+   cmdEnableVertexAttribArray,
+   cmdScissor,
+   cmdUniform1f,
+   cmdUniform2f,
+   cmdUniform3f,
+   cmdUniform4f,
+   cmdUniform1i,
+   cmdUniform2i,
+   cmdUniform3i,
+   cmdUniform4i,
+   cmdUniformfv,
+   cmdUniformMatrix,
+   cmdUseProgram,
+   cmdVertexAttribPointer,
+   cmdViewport,
+};
+
+struct CommandReader
+{
+   CommandReader(const unsigned char *inData, int inLength) :
+      ptr(inData), end(inData + (inLength & ~3)) { }
+
+   // Checks the words of a whole command are there before it is read
+   bool has(int inWords) const { return inWords>=0 && (end-ptr)>>2 >= inWords; }
+
+   int   i() { int result; memcpy(&result,ptr,4); ptr+=4; return result; }
+   float f() { float result; memcpy(&result,ptr,4); ptr+=4; return result; }
+   const unsigned char *skip(int inBytes) { const unsigned char *result = ptr; ptr+=(inBytes+3) & ~3; return result; }
+
+   const unsigned char *ptr;
+   const unsigned char *end;
+};
+
+static value commandObject(value inObjects, int inIndex)
+{
+   if (inIndex<0 || inIndex>=val_array_size(inObjects))
+      return alloc_null();
+   return val_array_i(inObjects,inIndex);
+}
+
+// Returns the number of commands run, stopping at the first that is not complete or known
+value nme_gl_execute_commands(value inBytes, value inLength, value inObjects)
+{
+   DBGFUNC("executeCommands");
+   ByteArray bytes(inBytes);
+   int len = val_int(inLength);
+   if (len<0 || len>bytes.Size())
+      val_throw(alloc_string("Invalid byte length"));
+
+   CommandReader cmd(bytes.Bytes(), len);
+   int count = 0;
+   #define CMD_NEED(words) if (!cmd.has(words)) return alloc_int(count)
+   while(cmd.has(1))
+   {
+      int op = cmd.i();
+      switch(op)
+      {
+         case cmdActiveTexture:
+            CMD_NEED(1);
+            activeTexture(cmd.i());
+            break;
+         case cmdBindBuffer:
+            CMD_NEED(2);
+            { int target = cmd.i(); bindBuffer(target, commandObject(inObjects,cmd.i())); }
+            break;
+         case cmdBindFramebuffer:
+            CMD_NEED(2);
+            { int target = cmd.i(); bindFramebuffer(target, commandObject(inObjects,cmd.i())); }
+            break;
+         case cmdBindTexture:
+            CMD_NEED(2);
+            { int target = cmd.i(); bindTexture(target, commandObject(inObjects,cmd.i())); }
+            break;
+         case cmdBlendFunc:
+            CMD_NEED(2);
+            { int s = cmd.i(); gGLState.BlendFunc(s, cmd.i()); }
+            break;
+         case cmdBlendFuncSeparate:
+            CMD_NEED(4);
+            { int srgb = cmd.i(); int drgb = cmd.i(); int sa = cmd.i(); gGLState.BlendFuncSeparate(srgb, drgb, sa, cmd.i()); }
+            break;
+         case cmdBufferSubData:
+            CMD_NEED(3);
+            {
+               int target = cmd.i();
+               int offset = cmd.i();
+               int size = cmd.i();
+               CMD_NEED((size+3)>>2);
+               glBufferSubData(target, offset, size, cmd.skip(size));
+            }
+            break;
+         case cmdClear:
+            CMD_NEED(1);
+            glClear(cmd.i());
+            break;
+         case cmdClearColor:
+            CMD_NEED(4);
+            { float r = cmd.f(); float g = cmd.f(); float b = cmd.f(); glClearColor(r, g, b, cmd.f()); }
+            break;
+         case cmdColorMask:
+            CMD_NEED(4);
+            { int r = cmd.i(); int g = cmd.i(); int b = cmd.i(); glColorMask(r, g, b, cmd.i()); }
+            break;
+         case cmdCullFace:
+            CMD_NEED(1);
+            glCullFace(cmd.i());
+            break;
+         case cmdDepthFunc:
+            CMD_NEED(1);
+            glDepthFunc(cmd.i());
+            break;
+         case cmdDepthMask:
+            CMD_NEED(1);
+            glDepthMask(cmd.i());
+            break;
+         case cmdDisable:
+            CMD_NEED(1);
+            gGLState.Disable(cmd.i());
+            break;
+         case cmdDisableVertexAttribArray:
+            CMD_NEED(1);
+            glDisableVertexAttribArray(cmd.i());
+            break;
+         case cmdDrawArrays:
+            CMD_NEED(3);
+            { int mode = cmd.i(); int first = cmd.i(); glDrawArrays(mode, first, cmd.i()); }
+            break;
+         case cmdDrawElements:
+            CMD_NEED(4);
+            {
+               int mode = cmd.i(); int n = cmd.i(); int type = cmd.i();
+               glDrawElements(mode, n, type, (void *)(intptr_t)cmd.i());
+            }
+            break;
+         case cmdEnable:
+            CMD_NEED(1);
+            gGLState.Enable(cmd.i());
+            break;
+         case cmdEnableVertexAttribArray:
+            CMD_NEED(1);
+            {
+               int index = cmd.i();
+               if (index>gDirectMaxAttribArray)
+                  gDirectMaxAttribArray = index;
+               glEnableVertexAttribArray(index);
+            }
+            break;
+         case cmdScissor:
+            CMD_NEED(4);
+            { int x = cmd.i(); int y = cmd.i(); int w = cmd.i(); gGLState.Scissor(x, y, w, cmd.i()); }
+            break;
+         case cmdUniform1f:
+            CMD_NEED(2);
+            { int loc = cmd.i(); glUniform1f(loc, cmd.f()); }
+            break;
+         case cmdUniform2f:
+            CMD_NEED(3);
+            { int loc = cmd.i(); float x = cmd.f(); glUniform2f(loc, x, cmd.f()); }
+            break;
+         case cmdUniform3f:
+            CMD_NEED(4);
+            { int loc = cmd.i(); float x = cmd.f(); float y = cmd.f(); glUniform3f(loc, x, y, cmd.f()); }
+            break;
+         case cmdUniform4f:
+            CMD_NEED(5);
+            { int loc = cmd.i(); float x = cmd.f(); float y = cmd.f(); float z = cmd.f(); glUniform4f(loc, x, y, z, cmd.f()); }
+            break;
+         case cmdUniform1i:
+            CMD_NEED(2);
+            { int loc = cmd.i(); glUniform1i(loc, cmd.i()); }
+            break;
+         case cmdUniform2i:
+            CMD_NEED(3);
+            { int loc = cmd.i(); int x = cmd.i(); glUniform2i(loc, x, cmd.i()); }
+            break;
+         case cmdUniform3i:
+            CMD_NEED(4);
+            { int loc = cmd.i(); int x = cmd.i(); int y = cmd.i(); glUniform3i(loc, x, y, cmd.i()); }
+            break;
+         case cmdUniform4i:
+            CMD_NEED(5);
+            { int loc = cmd.i(); int x = cmd.i(); int y = cmd.i(); int z = cmd.i(); glUniform4i(loc, x, y, z, cmd.i()); }
+            break;
+         case cmdUniformfv:
+            // location, components, float count, floats
+            CMD_NEED(3);
+            {
+               int loc = cmd.i();
+               int components = cmd.i();
+               int floats = cmd.i();
+               CMD_NEED(floats);
+               const float *data = (const float *)cmd.skip(floats*4);
+               switch(components)
+               {
+                  case 1: glUniform1fv(loc, floats, data); break;
+                  case 2: glUniform2fv(loc, floats/2, data); break;
+                  case 3: glUniform3fv(loc, floats/3, data); break;
+                  case 4: glUniform4fv(loc, floats/4, data); break;
+               }
+            }
+            break;
+         case cmdUniformMatrix:
+            // location, transpose, size, float count, floats
+            CMD_NEED(4);
+            {
+               int loc = cmd.i();
+               bool trans = cmd.i();
+               int size = cmd.i();
+               int floats = cmd.i();
+               CMD_NEED(floats);
+               const float *data = (const float *)cmd.skip(floats*4);
+               if (size==2)
+                  glUniformMatrix2fv(loc, floats/4, trans, data);
+               else if (size==3)
+                  glUniformMatrix3fv(loc, floats/9, trans, data);
+               else if (size==4)
+                  glUniformMatrix4fv(loc, floats/16, trans, data);
+            }
+            break;
+         case cmdUseProgram:
+            CMD_NEED(1);
+            useProgram(commandObject(inObjects,cmd.i()));
+            break;
+         case cmdVertexAttribPointer:
+            CMD_NEED(6);
+            {
+               int index = cmd.i(); int size = cmd.i(); int type = cmd.i();
+               int normalized = cmd.i(); int stride = cmd.i();
+               glVertexAttribPointer(index, size, type, normalized, stride, (void *)(intptr_t)cmd.i());
+            }
+            break;
+         case cmdViewport:
+            CMD_NEED(4);
+            { int x = cmd.i(); int y = cmd.i(); int w = cmd.i(); gGLState.Viewport(x, y, w, cmd.i()); }
+            break;
+         default:
+            ELOG("Unknown gl command %d", op);
+            return alloc_int(count);
+      }
+      count++;
+   }
+
+   return alloc_int(count);
+}
+DEFINE_PRIM(nme_gl_execute_commands,3);
+#undef CMD_NEED
+
+
 }
 
 extern "C" int nme_oglexport_register_prims() { return 0; }
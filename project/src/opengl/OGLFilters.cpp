@@ -0,0 +1,339 @@
+#include "./OGLFilters.h"
+#include <Surface.h>
+#include <Profile.h>
+
+
+namespace nme {
+
+
+// All the passes work on premultiplied pixels, which is what the textures hold.
+// The cpu blurs weight the colour by alpha, and the colour matrix un-multiplies first,
+//  so the results are the same, give or take rounding.
+
+OGLFilters::OGLFilters()
+{
+   mHardware = 0;
+   for(int i=0;i<FILTER_PROG_COUNT;i++)
+      mProg[i] = 0;
+   mFramebuffer = 0;
+   mQuadBuffer = 0;
+   mMaxTextureSize = 0;
+   mContextVersion = 0;
+   mOk = false;
+}
+
+OGLFilters::~OGLFilters()
+{
+   for(int i=0;i<FILTER_PROG_COUNT;i++)
+      delete mProg[i];
+}
+
+
+bool OGLFilters::CanApply(const Filter *inFilter) const
+{
+   const DropShadowFilter *shadow = dynamic_cast<const DropShadowFilter *>(inFilter);
+   if (shadow)
+      return !shadow->mInner;
+
+   if (dynamic_cast<const BlurFilter *>(inFilter))
+      return true;
+
+   const ColorMatrixFilter *matrix = dynamic_cast<const ColorMatrixFilter *>(inFilter);
+   return matrix && matrix->mMatrix.size()>=20;
+}
+
+
+Surface *OGLFilters::FilterBitmap(HardwareRenderer *inHardware, const FilterList &inFilters,
+                                  Surface *inBitmap, const Rect &inSrcRect, const Rect &inDestRect,
+                                  ImagePoint inSrc0)
+{
+   int n = inFilters.size();
+   if (n==0 || inBitmap->Format()!=pfARGB || !CHECK_EXT(glBindFramebuffer))
+      return 0;
+   for(int i=0;i<n;i++)
+      if (!CanApply(inFilters[i]))
+         return 0;
+
+   NME_PROFILE_ZONE("GPUFilterBitmap");
+   ProfileCount(pcFilters,n);
+
+   mHardware = inHardware;
+   if (mContextVersion!=gTextureContextVersion)
+   {
+      mContextVersion = gTextureContextVersion;
+      mFramebuffer = 0;
+      mQuadBuffer = 0;
+   }
+   if (!mFramebuffer)
+   {
+      glGenFramebuffers(1,&mFramebuffer);
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE,&mMaxTextureSize);
+   }
+   if (!mQuadBuffer)
+   {
+      static const float quad[] = { -1,-1,  1,-1,  -1,1,  1,1 };
+      glGenBuffers(1,&mQuadBuffer);
+      gGLState.BindBuffer(GL_ARRAY_BUFFER,mQuadBuffer);
+      glBufferData(GL_ARRAY_BUFFER,sizeof(quad),quad,GL_STATIC_DRAW);
+   }
+
+   GLint oldFramebuffer = 0;
+   glGetIntegerv(GL_FRAMEBUFFER_BINDING,&oldFramebuffer);
+   glBindFramebuffer(GL_FRAMEBUFFER,mFramebuffer);
+   gGLState.Disable(GL_BLEND);
+   mOk = true;
+
+   // The same passes and rects as the cpu version
+   Rect src_rect = inSrcRect;
+   Surface *bmp = inBitmap->IncRef();
+   for(int i=0;i<n && mOk;i++)
+   {
+      Filter *f = inFilters[i];
+
+      int quality = f->GetQuality();
+      for(int q=0;q<quality && mOk;q++)
+      {
+         Rect dest_rect(src_rect);
+         if (i==n-1 && q==quality-1)
+            dest_rect = inDestRect;
+         else
+            f->GetFilteredObjectRect(dest_rect, q);
+
+         if (dest_rect.w>mMaxTextureSize || dest_rect.h>mMaxTextureSize)
+         {
+            mOk = false;
+            break;
+         }
+
+         Surface *filtered = CreateTarget(dest_rect.w,dest_rect.h);
+         Apply(f,bmp,filtered, inSrc0, ImagePoint(dest_rect.x-src_rect.x, dest_rect.y-src_rect.y), q );
+         inSrc0 = ImagePoint(0,0);
+
+         bmp->DecRef();
+         bmp = filtered;
+         src_rect = dest_rect;
+      }
+   }
+
+   glBindFramebuffer(GL_FRAMEBUFFER,oldFramebuffer);
+   gGLState.BindBuffer(GL_ARRAY_BUFFER,0);
+   gGLState.ActiveTexture(GL_TEXTURE0);
+
+   if (!mOk)
+   {
+      bmp->DecRef();
+      return 0;
+   }
+   return bmp;
+}
+
+
+void OGLFilters::Apply(const Filter *inFilter, Surface *inSrc, Surface *outDest,
+                       ImagePoint inSrc0, ImagePoint inDiff, int inPass)
+{
+   const DropShadowFilter *shadow = dynamic_cast<const DropShadowFilter *>(inFilter);
+   if (shadow)
+   {
+      DropShadow(shadow,inSrc,outDest,inSrc0,inDiff);
+      return;
+   }
+
+   const BlurFilter *blur = dynamic_cast<const BlurFilter *>(inFilter);
+   if (blur)
+      Blur(blur,inSrc,outDest,inSrc0,inDiff,inPass);
+   else
+      ColourMatrix(dynamic_cast<const ColorMatrixFilter *>(inFilter),inSrc,outDest);
+}
+
+
+// --- Passes ---
+
+Surface *OGLFilters::CreateTarget(int inWidth, int inHeight)
+{
+   Surface *result = new SimpleSurface(inWidth,inHeight,pfARGB,4,0);
+   result->IncRef();
+   return result;
+}
+
+// Attaches and clears the target, returning the bound program, or 0 if it can't be drawn
+OGLProg *OGLFilters::BeginPass(int inFilterProg, Surface *outDest)
+{
+   outDest->Bind(*mHardware,0);
+   GLint tex = 0;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D,&tex);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+   if (glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE)
+   {
+      mOk = false;
+      return 0;
+   }
+
+   gGLState.Viewport(0,0,outDest->Width(),outDest->Height());
+   glClearColor(0,0,0,0);
+   glClear(GL_COLOR_BUFFER_BIT);
+   if (inFilterProg<0)
+      return 0;
+
+   if (!mProg[inFilterProg])
+      mProg[inFilterProg] = CreateFilterProg(inFilterProg);
+   OGLProg *prog = mProg[inFilterProg];
+   if (!prog->bind())
+   {
+      mOk = false;
+      return 0;
+   }
+   return prog;
+}
+
+void OGLFilters::BindSource(OGLProg *inProg, Surface *inSrc, int inSlot,
+                            const char *inTexelSize, const char *inSize)
+{
+   Texture *texture = inSrc->GetOwnTexture(mHardware);
+   inSrc->Bind(*mHardware,inSlot);
+   texture->BindFlags(false,false);
+
+   UserPoint texel = texture->PixelToTex(UserPoint(1,1));
+   glUniform2f(glGetUniformLocation(inProg->mProgramId,inTexelSize), texel.x, texel.y);
+   glUniform2f(glGetUniformLocation(inProg->mProgramId,inSize), inSrc->Width(), inSrc->Height());
+}
+
+void OGLFilters::EndPass(OGLProg *inProg)
+{
+   gGLState.BindBuffer(GL_ARRAY_BUFFER,mQuadBuffer);
+   glVertexAttribPointer(inProg->vertexSlot, 2, GL_FLOAT, GL_FALSE, 0, 0);
+   glEnableVertexAttribArray(inProg->vertexSlot);
+   glDrawArrays(GL_TRIANGLE_STRIP,0,4);
+   ProfileCount(pcDrawCalls);
+   glDisableVertexAttribArray(inProg->vertexSlot);
+}
+
+
+// Rows go into a target with the source height, then columns into the destination.
+// The source offsets match the cpu window, so dest pixel x sums source x+sx0-ox onwards.
+void OGLFilters::Blur(const BlurFilter *inFilter, Surface *inSrc, Surface *outDest,
+                      ImagePoint inSrc0, ImagePoint inDiff, int inPass)
+{
+   int w = outDest->Width();
+   int sw = inSrc->Width();
+   int sh = inSrc->Height();
+
+   int blurred_w = std::min(sw+inFilter->mBlurX,w);
+   if (blurred_w<=0 || sh<=0)
+   {
+      BeginPass(-1,outDest);
+      return;
+   }
+
+   int ox = inFilter->mBlurX/2;
+   int oy = inFilter->mBlurY/2;
+   if ( (inPass & 1) == 0)
+   {
+      ox = inFilter->mBlurX - ox;
+      oy = inFilter->mBlurY - oy;
+   }
+
+   Surface *rows = CreateTarget(blurred_w,sh);
+   OGLProg *prog = BeginPass(FILTER_PROG_BLUR,rows);
+   if (prog)
+   {
+      GLuint id = prog->mProgramId;
+      BindSource(prog,inSrc,0,"uTexelSize","uSrcSize");
+      glUniform2f(glGetUniformLocation(id,"uSrcOffset"), inSrc0.x + inDiff.x - ox, 0);
+      glUniform2f(glGetUniformLocation(id,"uStep"), 1, 0);
+      glUniform1f(glGetUniformLocation(id,"uTaps"), inFilter->mBlurX+1);
+      EndPass(prog);
+
+      prog = BeginPass(FILTER_PROG_BLUR,outDest);
+      if (prog)
+      {
+         BindSource(prog,rows,0,"uTexelSize","uSrcSize");
+         glUniform2f(glGetUniformLocation(id,"uSrcOffset"), 0, inSrc0.y + inDiff.y - oy);
+         glUniform2f(glGetUniformLocation(id,"uStep"), 0, 1);
+         glUniform1f(glGetUniformLocation(id,"uTaps"), inFilter->mBlurY+1);
+         EndPass(prog);
+      }
+   }
+   rows->DecRef();
+}
+
+
+// Like the cpu version, this ignores the offsets
+void OGLFilters::ColourMatrix(const ColorMatrixFilter *inFilter, Surface *inSrc, Surface *outDest)
+{
+   OGLProg *prog = BeginPass(FILTER_PROG_COLOUR_MATRIX,outDest);
+   if (!prog)
+      return;
+
+   BindSource(prog,inSrc,0,"uTexelSize","uSrcSize");
+
+   // Rows of the filter are the outputs, and it works in 0-255 - GL wants columns, in 0-1
+   const QuickVec<float> &m = inFilter->mMatrix;
+   float matrix[16];
+   float offset[4];
+   for(int row=0;row<4;row++)
+   {
+      for(int col=0;col<4;col++)
+         matrix[col*4+row] = m[row*5+col];
+      offset[row] = m[row*5+4]/255.0;
+   }
+   glUniformMatrix4fv(glGetUniformLocation(prog->mProgramId,"uMatrix"), 1, GL_FALSE, matrix);
+   glUniform4f(glGetUniformLocation(prog->mProgramId,"uOffset"),
+               offset[0], offset[1], offset[2], offset[3]);
+   EndPass(prog);
+}
+
+
+// Outer shadows only: the object is blurred with the shadow's own passes, and the blurred
+//  alpha is coloured and combined with the object in one final pass.
+void OGLFilters::DropShadow(const DropShadowFilter *inFilter, Surface *inSrc, Surface *outDest,
+                            ImagePoint inSrc0, ImagePoint inDiff)
+{
+   Surface *alpha = inSrc->IncRef();
+   ImagePoint offset(0,0);
+   ImagePoint a_src(inSrc0);
+   for(int q=0;q<inFilter->mQuality && mOk;q++)
+   {
+      Rect src_rect(alpha->Width(),alpha->Height());
+      inFilter->BlurFilter::GetFilteredObjectRect(src_rect,q);
+      Surface *blur = CreateTarget(src_rect.w, src_rect.h);
+
+      ImagePoint diff(src_rect.x, src_rect.y);
+      Blur(inFilter,alpha,blur,a_src,diff,q);
+
+      a_src = ImagePoint(0,0);
+      alpha->DecRef();
+      alpha = blur;
+      offset += diff;
+   }
+
+   OGLProg *prog = mOk ? BeginPass(FILTER_PROG_DROP_SHADOW,outDest) : 0;
+   if (prog)
+   {
+      GLuint id = prog->mProgramId;
+      ImagePoint blur_pos = offset + ImagePoint(inFilter->mTX,inFilter->mTY) - inDiff;
+      ImagePoint obj_pos = inSrc0 + inDiff;
+
+      BindSource(prog,inSrc,0,"uTexelSize","uSrcSize");
+      glUniform2f(glGetUniformLocation(id,"uSrcOffset"), obj_pos.x, obj_pos.y);
+
+      BindSource(prog,alpha,1,"uShadowTexelSize","uShadowSize");
+      glUniform1i(glGetUniformLocation(id,"uImage1"), 1);
+      glUniform2f(glGetUniformLocation(id,"uShadowOffset"), -blur_pos.x, -blur_pos.y);
+
+      int col = inFilter->mCol;
+      glUniform3f(glGetUniformLocation(id,"uColour"),
+                  ((col>>16)&0xff)/255.0, ((col>>8)&0xff)/255.0, (col&0xff)/255.0 );
+      glUniform1f(glGetUniformLocation(id,"uStrength"), inFilter->mStrength/256.0);
+      glUniform1f(glGetUniformLocation(id,"uAlpha"), inFilter->mAlpha/256.0);
+      glUniform1f(glGetUniformLocation(id,"uKnockout"),
+                  (inFilter->mKnockout || !inFilter->mHideObject) ? 1.0 : 0.0);
+      glUniform1f(glGetUniformLocation(id,"uObject"),
+                  (inFilter->mKnockout || inFilter->mHideObject) ? 0.0 : 1.0);
+      EndPass(prog);
+   }
+
+   alpha->DecRef();
+}
+
+
+} // end namespace nme
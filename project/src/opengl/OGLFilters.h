@@ -0,0 +1,60 @@
+#ifndef OGL_FILTERS_H
+#define OGL_FILTERS_H
+
+
+#include "./OGLShaders.h"
+#include <Filters.h>
+
+
+namespace nme {
+
+
+class Surface;
+
+
+// Runs display object filters on the gpu, rendering each pass into a texture through
+//  a framebuffer object.  Blur, colour matrix and outer drop shadows are done here -
+//  anything else is left to the cpu.
+class OGLFilters
+{
+public:
+
+   OGLFilters();
+   ~OGLFilters();
+
+   // Returns a new, texture-only, surface with a reference, or 0 if the filters must be done
+   //  on the cpu.  The arguments match FilterBitmap, and inBitmap is not released.
+   Surface *FilterBitmap(HardwareRenderer *inHardware, const FilterList &inFilters,
+                         Surface *inBitmap, const Rect &inSrcRect, const Rect &inDestRect,
+                         ImagePoint inSrc0);
+
+private:
+   bool CanApply(const Filter *inFilter) const;
+   void Apply(const Filter *inFilter, Surface *inSrc, Surface *outDest,
+              ImagePoint inSrc0, ImagePoint inDiff, int inPass);
+   void Blur(const BlurFilter *inFilter, Surface *inSrc, Surface *outDest,
+              ImagePoint inSrc0, ImagePoint inDiff, int inPass);
+   void ColourMatrix(const ColorMatrixFilter *inFilter, Surface *inSrc, Surface *outDest);
+   void DropShadow(const DropShadowFilter *inFilter, Surface *inSrc, Surface *outDest,
+              ImagePoint inSrc0, ImagePoint inDiff);
+
+   Surface *CreateTarget(int inWidth, int inHeight);
+   OGLProg *BeginPass(int inFilterProg, Surface *outDest);
+   void     BindSource(OGLProg *inProg, Surface *inSrc, int inSlot,
+                       const char *inTexelSize, const char *inSize);
+   void     EndPass(OGLProg *inProg);
+
+   HardwareRenderer *mHardware;
+   OGLProg *mProg[FILTER_PROG_COUNT];
+   GLuint   mFramebuffer;
+   GLuint   mQuadBuffer;
+   GLint    mMaxTextureSize;
+   int      mContextVersion;
+   bool     mOk;
+};
+
+
+}
+
+
+#endif
@@ -121,6 +121,7 @@ void OGLProg::recreate()
   
       glDeleteShader(mVertId);
       glDeleteShader(mFragId);
+      gGLState.ForgetProgram(mProgramId);
       glDeleteProgram(mProgramId);
       mVertId = mFragId = mProgramId = 0;
    }
@@ -140,7 +141,7 @@ void OGLProg::recreate()
    mOn2ASlot = glGetUniformLocation(mProgramId, "mOn2A");
 
    
-   glUseProgram(mProgramId);
+   gGLState.UseProgram(mProgramId);
    if (mImageSlot>=0)
       glUniform1i(mImageSlot,0);
 }
@@ -153,7 +154,7 @@ bool OGLProg::bind()
    if (mProgramId==0)
       return false;
 
-   glUseProgram(mProgramId);
+   gGLState.UseProgram(mProgramId);
    return true;
 }
 
@@ -412,6 +413,111 @@ GPUProg *GPUProg::create(unsigned int inID)
 }
 
 
+OGLProg *CreateFilterProg(int inFilterProg)
+{
+   std::string vertexShader =
+      "attribute vec4 aVertex;\n"
+      "void main()\n"
+      "{\n"
+      "   gl_Position = aVertex;\n"
+      "}\n";
+
+   // Pixel positions need more than mediump once the target gets large
+   std::string pixelVars = "";
+   #ifdef NME_GLES
+   pixelVars =
+      "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+      "precision highp float;\n"
+      "#else\n"
+      "precision mediump float;\n"
+      "#endif\n";
+   #endif
+
+   pixelVars +=
+      "uniform sampler2D uImage0;\n"
+      "uniform vec2 uTexelSize;\n"
+      "uniform vec2 uSrcSize;\n"
+      "uniform vec2 uSrcOffset;\n"
+      "vec4 texel(sampler2D inImage, vec2 inPos, vec2 inSize, vec2 inTexelSize)\n"
+      "{\n"
+      "   if (inPos.x<0.0 || inPos.y<0.0 || inPos.x>=inSize.x || inPos.y>=inSize.y)\n"
+      "      return vec4(0.0);\n"
+      "   return texture2D(inImage,(inPos+0.5)*inTexelSize);\n"
+      "}\n";
+
+   std::string pixelProg;
+   switch(inFilterProg)
+   {
+      case FILTER_PROG_BLUR:
+         // A BlurFilter box is at most 257 pixels
+         pixelVars +=
+            "uniform vec2 uStep;\n"
+            "uniform float uTaps;\n";
+         pixelProg =
+            "   vec2 pos = floor(gl_FragCoord.xy) + uSrcOffset;\n"
+            "   vec4 sum = vec4(0.0);\n"
+            "   for(int i=0;i<257;i++)\n"
+            "   {\n"
+            "      if (float(i)>=uTaps)\n"
+            "         break;\n"
+            "      sum += texel(uImage0,pos,uSrcSize,uTexelSize);\n"
+            "      pos += uStep;\n"
+            "   }\n"
+            "   gl_FragColor = sum/uTaps;\n";
+         break;
+
+      // The matrix works on un-multiplied colour, in the same position, and only over the source
+      case FILTER_PROG_COLOUR_MATRIX:
+         pixelVars +=
+            "uniform mat4 uMatrix;\n"
+            "uniform vec4 uOffset;\n";
+         pixelProg =
+            "   vec2 pos = floor(gl_FragCoord.xy);\n"
+            "   vec4 col = vec4(0.0);\n"
+            "   if (pos.x<uSrcSize.x && pos.y<uSrcSize.y)\n"
+            "   {\n"
+            "      col = texture2D(uImage0,(pos+0.5)*uTexelSize);\n"
+            "      if (col.a>0.0)\n"
+            "         col.rgb /= col.a;\n"
+            "      col = clamp(uMatrix*col + uOffset, 0.0, 1.0);\n"
+            "      col.rgb *= col.a;\n"
+            "   }\n"
+            "   gl_FragColor = col;\n";
+         break;
+
+      // uImage0 is the object and uImage1 its blurred copy.
+      // uKnockout removes the shadow under the object, and uObject draws the object over it.
+      case FILTER_PROG_DROP_SHADOW:
+         pixelVars +=
+            "uniform sampler2D uImage1;\n"
+            "uniform vec2 uShadowTexelSize;\n"
+            "uniform vec2 uShadowSize;\n"
+            "uniform vec2 uShadowOffset;\n"
+            "uniform vec3 uColour;\n"
+            "uniform float uStrength;\n"
+            "uniform float uAlpha;\n"
+            "uniform float uKnockout;\n"
+            "uniform float uObject;\n";
+         pixelProg =
+            "   vec2 pos = floor(gl_FragCoord.xy);\n"
+            "   vec4 obj = texel(uImage0,pos+uSrcOffset,uSrcSize,uTexelSize);\n"
+            "   float a = texel(uImage1,pos+uShadowOffset,uShadowSize,uShadowTexelSize).a;\n"
+            "   a = min(a*uStrength,1.0)*uAlpha;\n"
+            "   gl_FragColor = vec4(uColour*a,a)*(1.0-obj.a*uKnockout) + obj*uObject;\n";
+         break;
+   }
+
+   std::string pixelShader =
+      pixelVars +
+      "void main()\n"
+      "{\n" +
+         pixelProg +
+      "}\n";
+
+   return new OGLProg(vertexShader, pixelShader);
+}
+
+
 } // end namespace nme
 
 
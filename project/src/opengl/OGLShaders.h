@@ -50,6 +50,22 @@ public:
 };
 
 
+// --- Filter programs ---
+// These draw a quad covering the viewport, and work in whole target pixels from gl_FragCoord.
+// Sources are sampled with nearest filtering, and are zero outside their size.
+
+enum
+{
+   FILTER_PROG_BLUR,
+   FILTER_PROG_COLOUR_MATRIX,
+   FILTER_PROG_DROP_SHADOW,
+
+   FILTER_PROG_COUNT,
+};
+
+OGLProg *CreateFilterProg(int inFilterProg);
+
+
 
 } // end namespace nme
 
@@ -1,4 +1,6 @@
 #include "./OGL.h"
+#include <RectPacker.h>
+#include <Profile.h>
 
 #define SWAP_RB 0
 
@@ -115,7 +117,7 @@ void checkRgbFormat()
    glGetError();
    GLuint tid = 0;
    glGenTextures(1, &tid);
-   glBindTexture(GL_TEXTURE_2D,tid);
+   gGLState.BindTexture(GL_TEXTURE_2D,tid);
    glTexImage2D(GL_TEXTURE_2D, 0, ARGB_STORE, 1, 1, 0, ARGB_PIXEL, GL_UNSIGNED_BYTE, data);
    int err = glGetError();
    if (err)
@@ -133,6 +135,7 @@ void checkRgbFormat()
          SWAP_RB = true;
       }
    }
+   gGLState.ForgetTexture(tid);
    glDeleteTextures(1,&tid);
    //else ELOG("Using normal texture format in simulator");
 }
@@ -158,6 +161,7 @@ class OGLTexture : public Texture
 public:
    OGLTexture(Surface *inSurface,unsigned int inFlags)
    {
+      NME_PROFILE_ZONE("TextureCreate");
       #ifdef ANDROID_X86
       if (!sFormatChecked)
          checkRgbFormat();
@@ -296,7 +300,7 @@ public:
       glGenTextures(1, &mTextureID);
       // __android_log_print(ANDROID_LOG_ERROR, "NME", "CreateTexture %d (%dx%d)",
       //  mTextureID, mPixelWidth, mPixelHeight);
-      glBindTexture(GL_TEXTURE_2D,mTextureID);
+      gGLState.BindTexture(GL_TEXTURE_2D,mTextureID);
       mRepeat = mCanRepeat;
       mSmooth = true;
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mRepeat ? GL_REPEAT : GL_CLAMP_TO_EDGE );
@@ -305,6 +309,8 @@ public:
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
       glTexImage2D(GL_TEXTURE_2D, 0, store_format, w, h, 0, pixel_format, pixels, buffer);
+      if (buffer)
+         ProfileCount(pcTextureBytes, w*h*(fmt==pfAlpha ? 1 : 4));
 
       if (buffer && buffer!=mSurface->Row(0))
          free(buffer);
@@ -329,11 +335,9 @@ public:
 
    void Bind(int inSlot)
    {
-      if (inSlot>=0 && CHECK_EXT(glActiveTexture))
-      {
-         glActiveTexture(GL_TEXTURE0 + inSlot);
-      }
-      glBindTexture(GL_TEXTURE_2D,mTextureID);
+      if (inSlot>=0)
+         gGLState.ActiveTexture(GL_TEXTURE0 + inSlot);
+      gGLState.BindTexture(GL_TEXTURE_2D,mTextureID);
 
       if (gTextureContextVersion!=mContextVersion)
       {
@@ -345,6 +349,7 @@ public:
       {
          //__android_log_print(ANDROID_LOG_INFO, "NME", "UpdateDirtyRect! %d %d",
              //mPixelWidth, mPixelHeight);
+         NME_PROFILE_ZONE("TextureUpload");
 
 
          PixelFormat fmt = mSurface->Format();
@@ -354,6 +359,7 @@ public:
          int y0 = mDirtyRect.y;
          int dw = mDirtyRect.w;
          int dh = mDirtyRect.h;
+         ProfileCount(pcTextureBytes, dw*dh*pw);
 
          
          bool needsCopy = mMultiplyAlphaOnLoad;
@@ -537,4 +543,293 @@ Texture *OGLCreateTexture(Surface *inSurface,unsigned int inFlags)
 }
 
 
+
+// --- Texture atlas -------------------------------------------------------
+//
+// Small surfaces share "pages" so many of them can be drawn with one texture bind, which
+//  lets the renderer batch them.  Each surface gets a rect in a page with a one pixel border
+//  of repeated edge pixels, so smooth sampling does not bleed in from its neighbours.
+// A rect keeps its place until the surface is done with it, so tex-coords survive a context
+//  loss - the page is simply reloaded.  Freed rects are reused by new surfaces.
+
+static const int sgAtlasPageSize = 1024;
+static const int sgAtlasMaxImageSize = 128;
+static const int sgMaxAtlasPages = 8;
+
+class OGLAtlasTexture;
+
+class OGLAtlasPage
+{
+public:
+   OGLAtlasPage(bool inAlpha,bool inPremultiplied) :
+      mPacker(sgAtlasPageSize,sgAtlasPageSize)
+   {
+      mAlpha = inAlpha;
+      mPremultiplied = inPremultiplied;
+      mTextureID = 0;
+      mContextVersion = 0;
+      mSmooth = true;
+      mHasDirty = false;
+   }
+
+   ~OGLAtlasPage()
+   {
+      if (mTextureID && mContextVersion==gTextureContextVersion && HardwareRenderer::current)
+         HardwareRenderer::current->DestroyNativeTexture((void *)(size_t)mTextureID);
+   }
+
+   bool Matches(bool inAlpha,bool inPremultiplied) const
+   {
+      return mAlpha==inAlpha && mPremultiplied==inPremultiplied;
+   }
+
+   bool Alloc(int inW,int inH,Rect &outRect) { return mPacker.Alloc(inW+2,inH+2,outRect); }
+
+   void Add(OGLAtlasTexture *inTexture)
+   {
+      mEntries.push_back(inTexture);
+      mHasDirty = true;
+   }
+   // Returns true if the page is now empty
+   bool Remove(OGLAtlasTexture *inTexture,const Rect &inRect)
+   {
+      mEntries.qremove(inTexture);
+      mPacker.Free(inRect);
+      return mEntries.empty();
+   }
+
+   void Bind(int inSlot);
+
+   void BindFlags(bool inSmooth)
+   {
+      if (mSmooth!=inSmooth)
+      {
+         mSmooth = inSmooth;
+         GLint filter = mSmooth ? GL_LINEAR : GL_NEAREST;
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+      }
+   }
+
+   bool mHasDirty;
+
+private:
+   void CreateTexture();
+
+   bool        mAlpha;
+   bool        mPremultiplied;
+   bool        mSmooth;
+   GLuint      mTextureID;
+   int         mContextVersion;
+   RectPacker  mPacker;
+
+   QuickVec<OGLAtlasTexture *> mEntries;
+};
+
+static QuickVec<OGLAtlasPage *> sgAtlasPages;
+
+
+class OGLAtlasTexture : public Texture
+{
+public:
+   OGLAtlasTexture(Surface *inSurface,unsigned int inFlags,OGLAtlasPage *inPage,const Rect &inRect)
+   {
+      // No reference count since the surface should outlive us
+      mSurface = inSurface;
+      mPage = inPage;
+      mRect = inRect;
+      mScale = 1.0/sgAtlasPageSize;
+      mMultiplyAlphaOnLoad = (inFlags & surfUsePremultipliedAlpha) &&
+                            !(inFlags & surfHasPremultipliedAlpha);
+      mDirtyRect = Rect(mSurface->Width(),mSurface->Height());
+      mPage->Add(this);
+   }
+
+   ~OGLAtlasTexture()
+   {
+      if (mPage->Remove(this,mRect) && sgAtlasPages.size()>1)
+      {
+         sgAtlasPages.qremove(mPage);
+         delete mPage;
+      }
+      // The surface lives on, so anything drawn with our rect must be rebuilt
+      if (mSurface->mRefCount>0)
+         gTextureAtlasVersion++;
+   }
+
+   int GetWidth() { return mSurface->Width(); }
+   int GetHeight() { return mSurface->Height(); }
+
+   void Bind(int inSlot) { mPage->Bind(inSlot); }
+
+   // Repeating is not possible within the page
+   void BindFlags(bool inRepeat,bool inSmooth) { mPage->BindFlags(inSmooth); }
+
+   UserPoint PixelToTex(const UserPoint &inPixels)
+   {
+      return UserPoint( (mRect.x + 1 + inPixels.x)*mScale, (mRect.y + 1 + inPixels.y)*mScale );
+   }
+
+   UserPoint TexToPaddedTex(const UserPoint &inTex)
+   {
+      return PixelToTex( UserPoint(inTex.x*mSurface->Width(), inTex.y*mSurface->Height()) );
+   }
+
+   void Dirty(const Rect &inRect)
+   {
+      if (!mDirtyRect.HasPixels())
+         mDirtyRect = inRect;
+      else
+         mDirtyRect = mDirtyRect.Union(inRect);
+      mPage->mHasDirty = true;
+   }
+
+   void DirtyAll() { mDirtyRect = Rect(mSurface->Width(),mSurface->Height()); }
+
+   // The page takes care of context loss
+   bool IsCurrentVersion() { return true; }
+
+   const void *GetAtlasPage() { return mPage; }
+
+   // Copy the dirty pixels into the bound page, along with any border pixels they touch
+   void Upload()
+   {
+      if (!mDirtyRect.HasPixels() || !mSurface->GetBase())
+         return;
+      NME_PROFILE_ZONE("TextureUpload");
+
+      int w = mSurface->Width();
+      int h = mSurface->Height();
+      Rect r(mDirtyRect.x-1, mDirtyRect.y-1, mDirtyRect.w+2, mDirtyRect.h+2);
+      r = r.Intersect( Rect(-1,-1,w+2,h+2) );
+      mDirtyRect = Rect();
+
+      bool alpha = mSurface->Format()==pfAlpha;
+      int pw = alpha ? 1 : 4;
+      int *multiplyAlpha = mMultiplyAlphaOnLoad && !alpha ? getAlpha16Table() : 0;
+
+      ProfileCount(pcTextureBytes, pw * r.w * r.h);
+      uint8 *buffer = (uint8 *)malloc(pw * r.w * r.h);
+      uint8 *dest = buffer;
+      for(int y=r.y; y<r.y+r.h; y++)
+      {
+         const uint8 *row = mSurface->Row( y<0 ? 0 : y>=h ? h-1 : y );
+         for(int x=r.x; x<r.x+r.w; x++)
+         {
+            const uint8 *src = row + pw*( x<0 ? 0 : x>=w ? w-1 : x );
+            if (alpha)
+               *dest++ = *src;
+            else
+            {
+               int a16 = multiplyAlpha ? multiplyAlpha[src[3]] : (1<<16);
+               dest[0] = (src[SWAP_RB ? 2 : 0]*a16)>>16;
+               dest[1] = (src[1]*a16)>>16;
+               dest[2] = (src[SWAP_RB ? 0 : 2]*a16)>>16;
+               dest[3] = src[3];
+               dest+=4;
+            }
+         }
+      }
+
+      if (alpha)
+         glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+      glTexSubImage2D(GL_TEXTURE_2D, 0,
+         mRect.x + 1 + r.x, mRect.y + 1 + r.y,
+         r.w, r.h,
+         alpha ? GL_ALPHA : ARGB_PIXEL, GL_UNSIGNED_BYTE,
+         buffer );
+      if (alpha)
+         glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+      free(buffer);
+   }
+
+private:
+   Surface      *mSurface;
+   OGLAtlasPage *mPage;
+   Rect         mRect;
+   Rect         mDirtyRect;
+   double       mScale;
+   bool         mMultiplyAlphaOnLoad;
+};
+
+
+void OGLAtlasPage::CreateTexture()
+{
+   mContextVersion = gTextureContextVersion;
+   mTextureID = 0;
+   glGenTextures(1, &mTextureID);
+   gGLState.BindTexture(GL_TEXTURE_2D,mTextureID);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   GLint filter = mSmooth ? GL_LINEAR : GL_NEAREST;
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+   GLuint store_format = mAlpha ? GL_ALPHA : ARGB_STORE;
+   GLuint pixel_format = mAlpha ? GL_ALPHA : ARGB_PIXEL;
+   glTexImage2D(GL_TEXTURE_2D, 0, store_format, sgAtlasPageSize, sgAtlasPageSize, 0,
+                pixel_format, GL_UNSIGNED_BYTE, 0);
+
+   for(int i=0;i<mEntries.size();i++)
+      mEntries[i]->DirtyAll();
+   mHasDirty = true;
+}
+
+void OGLAtlasPage::Bind(int inSlot)
+{
+   if (inSlot>=0)
+      gGLState.ActiveTexture(GL_TEXTURE0 + inSlot);
+
+   if (!mTextureID || mContextVersion!=gTextureContextVersion)
+      CreateTexture();
+   else
+      gGLState.BindTexture(GL_TEXTURE_2D,mTextureID);
+
+   if (mHasDirty)
+   {
+      mHasDirty = false;
+      for(int i=0;i<mEntries.size();i++)
+         mEntries[i]->Upload();
+
+      int err = glGetError();
+      if (err != GL_NO_ERROR)
+         ELOG("GL Error: %d updating atlas page", err);
+   }
+}
+
+
+Texture *OGLCreateAtlasTexture(Surface *inSurface,unsigned int inFlags)
+{
+   int w = inSurface->Width();
+   int h = inSurface->Height();
+   if ( (inFlags & surfNoAtlas) || !inSurface->GetBase() || inSurface->GPUFormat()!=inSurface->Format() ||
+         w<1 || h<1 || w>sgAtlasMaxImageSize || h>sgAtlasMaxImageSize )
+      return 0;
+
+   #ifdef ANDROID_X86
+   if (!sFormatChecked)
+      checkRgbFormat();
+   #endif
+
+   bool alpha = inSurface->Format()==pfAlpha;
+   bool premultiplied = !alpha && (inFlags & surfUsePremultipliedAlpha);
+
+   Rect rect;
+   for(int i=0;i<sgAtlasPages.size();i++)
+   {
+      OGLAtlasPage *page = sgAtlasPages[i];
+      if (page->Matches(alpha,premultiplied) && page->Alloc(w,h,rect))
+         return new OGLAtlasTexture(inSurface,inFlags,page,rect);
+   }
+
+   if (sgAtlasPages.size()>=sgMaxAtlasPages)
+      return 0;
+
+   OGLAtlasPage *page = new OGLAtlasPage(alpha,premultiplied);
+   sgAtlasPages.push_back(page);
+   page->Alloc(w,h,rect);
+   return new OGLAtlasTexture(inSurface,inFlags,page,rect);
+}
+
+
 } // end namespace nme
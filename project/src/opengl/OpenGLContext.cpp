@@ -1,5 +1,7 @@
 #include "./OGL.h"
+#include "./OGLFilters.h"
 #include <NMEThread.h>
+#include <Profile.h>
 
 #if HX_LINUX
 #include <dlfcn.h>
@@ -25,12 +27,22 @@ int sgDrawBitmap = 0;
 namespace nme
 {
 
+GLStateCache gGLState;
+
 const double one_on_255 = 1.0/255.0;
 const double one_on_256 = 1.0/256.0;
 
 static GLuint sgOpenglType[] =
   { GL_TRIANGLE_FAN, GL_TRIANGLE_STRIP, GL_TRIANGLES, GL_LINE_STRIP, GL_POINTS, GL_LINES, 0, 0 /* Quads / Full */ };
 
+// Objects with up to this many vertices are transformed on the cpu and merged with
+//  their neighbours into a single draw call.  Bigger objects are drawn from their own vbo.
+static int sgMaxBatchObjectVertices = 1024;
+static int sgMaxBatchVertices = 16384;
+
+// Geometry that does not have its own vbo is streamed through a shared buffer of this size.
+static int sgStreamBufferSize = 1<<20;
+
 
 void ReloadExtentions();
 
@@ -72,6 +84,9 @@ public:
       mContextId = gTextureContextVersion;
       mQuadsBuffer = 0;
       mFullTexCoordsBuffer = 0;
+      mStreamBuffer = 0;
+      mStreamSize = 0;
+      mStreamPos = 0;
       #if defined(NME_GLES)
       mQuality = sqLow;
       #else
@@ -94,6 +109,11 @@ public:
       e.mColour = 0xff000000;
       e.mTexOffset = sizeof(float)*2;
       e.mStride = sizeof(float)*4;
+
+      mBatch.mElements.resize(1);
+      memset(&mBatch.mElements[0],0,sizeof(DrawElement));
+      mBatchHasTrans = false;
+      mBatchFirst = 0;
       
       #if defined(NME_S3D) && defined(ANDROID)
       mS3D.Init ();
@@ -123,6 +143,7 @@ public:
       }
       else
       {
+         gGLState.ForgetTexture(inTex);
          glDeleteTextures(1,&inTex);
       }
    }
@@ -135,7 +156,10 @@ public:
          mZombieVbos.push_back(inVbo);
       }
       else
+      {
+         gGLState.ForgetBuffer(inVbo);
          glDeleteBuffers(1,&inVbo);
+      }
    }
 
    void DestroyProgram(unsigned int inProg)
@@ -146,7 +170,10 @@ public:
          mZombiePrograms.push_back(inProg);
       }
       else
+      {
+         gGLState.ForgetProgram(inProg);
          glDeleteProgram(inProg);
+      }
    }
    void DestroyShader(unsigned int inShader)
    {
@@ -183,6 +210,8 @@ public:
 
    void OnContextLost()
    {
+      ClearBatch();
+      gGLState.Invalidate();
       mZombieTextures.resize(0);
       mZombieVbos.resize(0);
       mZombiePrograms.resize(0);
@@ -210,9 +239,11 @@ public:
 
    void Clear(uint32 inColour, const Rect *inRect)
    {
+      FlushBatch();
+
       Rect r = inRect ? *inRect : Rect(mWidth,mHeight);
      
-      glViewport(r.x,mHeight-r.y1(),r.w,r.h);
+      gGLState.Viewport(r.x,mHeight-r.y1(),r.w,r.h);
 
 
       float alpha = ((inColour >>24) & 0xff) /255.0;
@@ -235,16 +266,17 @@ public:
 
 
       if (r!=mViewport)
-         glViewport(mViewport.x, mHeight-mViewport.y1(), mViewport.w, mViewport.h);
+         gGLState.Viewport(mViewport.x, mHeight-mViewport.y1(), mViewport.w, mViewport.h);
    }
 
    void SetViewport(const Rect &inRect)
    {
       if (inRect!=mViewport)
       {
+         FlushBatch();
          setOrtho(inRect.x,inRect.x1(), inRect.y1(),inRect.y);
          mViewport = inRect;
-         glViewport(inRect.x, mHeight-inRect.y1(), inRect.w, inRect.h);
+         gGLState.Viewport(inRect.x, mHeight-inRect.y1(), inRect.w, inRect.h);
       }
    }
 
@@ -258,6 +290,9 @@ public:
             updateContext();
          }
 
+         // Other code may have used the context between frames
+         gGLState.Invalidate();
+
          #ifndef NME_GLES
          #ifndef SDL_OGL
          #ifndef GLFW_OGL
@@ -271,12 +306,16 @@ public:
             mHasZombie = false;
             if (mZombieTextures.size())
             {
+               for(int i=0;i<mZombieTextures.size();i++)
+                  gGLState.ForgetTexture(mZombieTextures[i]);
                glDeleteTextures(mZombieTextures.size(),&mZombieTextures[0]);
                mZombieTextures.resize(0);
             }
 
             if (mZombieVbos.size())
             {
+               for(int i=0;i<mZombieVbos.size();i++)
+                  gGLState.ForgetBuffer(mZombieVbos[i]);
                glDeleteBuffers(mZombieVbos.size(),&mZombieVbos[0]);
                mZombieVbos.resize(0);
             }
@@ -284,7 +323,10 @@ public:
             if (mZombiePrograms.size())
             {
                for(int i=0;i<mZombiePrograms.size();i++)
+               {
+                  gGLState.ForgetProgram(mZombiePrograms[i]);
                   glDeleteProgram(mZombiePrograms[i]);
+               }
                mZombiePrograms.resize(0);
             }
 
@@ -314,7 +356,7 @@ public:
          SetViewport(inRect);
 
 
-         glEnable(GL_BLEND);
+         gGLState.Enable(GL_BLEND);
 
         #ifdef WEBOS
          glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
@@ -329,7 +371,7 @@ public:
    }
    void EndRender()
    {
-
+      FlushBatch();
    }
 
    void updateContext()
@@ -338,6 +380,9 @@ public:
       mThreadId = GetThreadId();
       mQuadsBuffer = 0;
       mFullTexCoordsBuffer = 0;
+      mStreamBuffer = 0;
+      mStreamSize = 0;
+      mStreamPos = 0;
       mHasZombie = false;
       mZombieTextures.resize(0);
       mZombieVbos.resize(0);
@@ -363,6 +408,8 @@ public:
 
    void BeginDirectRender()
    {
+      FlushBatch();
+      gGLState.BindBuffer(GL_ARRAY_BUFFER,0);
       gDirectMaxAttribArray = 0;
    }
 
@@ -370,6 +417,8 @@ public:
    {
       for(int i=0;i<gDirectMaxAttribArray;i++)
          glDisableVertexAttribArray(i);
+      // The callback may have reached gl without the prims
+      gGLState.Invalidate();
    }
 
 
@@ -378,25 +427,273 @@ public:
       if (!inData.mArray.size())
          return;
 
+      const ColorTransform *ctrans = inState.mColourTransform;
+      if (ctrans && ctrans->IsIdentity())
+         ctrans = 0;
+
       SetViewport(inState.mClipRect);
 
-      if (mModelView!=*inState.mTransform.mMatrix)
+      if (CanBatch(inData))
       {
-         mModelView=*inState.mTransform.mMatrix;
+         AddToBatch(inData,*inState.mTransform.mMatrix,ctrans);
+         return;
+      }
+      FlushBatch();
+
+      RenderObject(inData,*inState.mTransform.mMatrix,ctrans);
+   }
+
+   void RenderObject(const HardwareData &inData, const Matrix &inMatrix, const ColorTransform *ctrans)
+   {
+      if (mModelView!=inMatrix)
+      {
+         mModelView=inMatrix;
          CombineModelView(mModelView);
          mLineScaleV = -1;
          mLineScaleH = -1;
          mLineScaleNormal = -1;
       }
-      const ColorTransform *ctrans = inState.mColourTransform;
-      if (ctrans && ctrans->IsIdentity())
-         ctrans = 0;
 
       RenderData(inData,ctrans,mTrans);
    }
 
+   void ForgetData(const HardwareData *inData)
+   {
+      // Draw it while it is still there
+      if (mBatchFirst && inData==mBatchFirst)
+         FlushBatch();
+   }
+
+
+   // --- Batching ---------------------------------------------------------------
+   //
+   // Consecutive small objects that would use the same program, texture, blend mode
+   //  and colour transform are pre-transformed into viewport coordinates and
+   //  accumulated in mBatch, which is drawn in one call with mBitmapTrans.
+   // The first object is only held (in mBatchFirst) until the next one arrives - if that
+   //  does not join it, it is drawn from its own buffer, so lone objects keep their vbo.
+
+   bool CanBatch(const HardwareData &inData)
+   {
+      #ifdef NME_S3D
+      return false;
+      #else
+      int count = 0;
+      for(int e=0;e<inData.mElements.size();e++)
+      {
+         const DrawElement &element = inData.mElements[e];
+         if (!element.mCount)
+            continue;
+         if (element.mPrimType!=ptTriangles && element.mPrimType!=ptQuads)
+            return false;
+         if (element.mFlags & (DRAW_HAS_NORMAL | DRAW_HAS_PERSPECTIVE | DRAW_RADIAL))
+            return false;
+
+         // Must be interleaved, so the vertices can be copied as a block
+         int stride = element.mStride;
+         if (element.mFlags & DRAW_HAS_TEX)
+         {
+            int offset = element.mTexOffset - element.mVertexOffset;
+            if (offset<0 || offset+2*(int)sizeof(float)>stride)
+               return false;
+         }
+         if (element.mFlags & DRAW_HAS_COLOUR)
+         {
+            int offset = element.mColourOffset - element.mVertexOffset;
+            if (offset<0 || offset+(int)sizeof(int)>stride)
+               return false;
+         }
+         count += element.mCount;
+      }
+      return count>0 && count<=sgMaxBatchObjectVertices;
+      #endif
+   }
+
+   bool ElementsMatch(const DrawElement &inElement, const DrawElement &inBatch)
+   {
+      if (inElement.mPrimType!=inBatch.mPrimType || inElement.mFlags!=inBatch.mFlags ||
+          inElement.mBlendMode!=inBatch.mBlendMode || inElement.mColour!=inBatch.mColour ||
+          inElement.mStride!=inBatch.mStride)
+         return false;
+
+      // Different surfaces can be drawn together if they share an atlas page
+      if (inElement.mSurface!=inBatch.mSurface)
+      {
+         if (!inElement.mSurface || !inBatch.mSurface)
+            return false;
+         const void *page = inElement.mSurface->GetTexture(this)->GetAtlasPage();
+         if (!page || page!=inBatch.mSurface->GetTexture(this)->GetAtlasPage())
+            return false;
+      }
+
+      if ( (inElement.mFlags & DRAW_HAS_TEX) &&
+             inElement.mTexOffset-inElement.mVertexOffset != inBatch.mTexOffset-inBatch.mVertexOffset )
+         return false;
+      if ( (inElement.mFlags & DRAW_HAS_COLOUR) &&
+             inElement.mColourOffset-inElement.mVertexOffset != inBatch.mColourOffset-inBatch.mVertexOffset )
+         return false;
+      return true;
+   }
+
+   bool BatchMatches(const DrawElement &inElement, const ColorTransform *inTrans)
+   {
+      return ElementsMatch(inElement,mBatch.mElements[0]) && TransMatches(inTrans);
+   }
+
+   bool TransMatches(const ColorTransform *inTrans)
+   {
+      if ( (inTrans!=0) != mBatchHasTrans )
+         return false;
+      if (inTrans)
+      {
+         const ColorTransform &t = mBatchTrans;
+         if (inTrans->redMultiplier!=t.redMultiplier || inTrans->redOffset!=t.redOffset ||
+             inTrans->greenMultiplier!=t.greenMultiplier || inTrans->greenOffset!=t.greenOffset ||
+             inTrans->blueMultiplier!=t.blueMultiplier || inTrans->blueOffset!=t.blueOffset ||
+             inTrans->alphaMultiplier!=t.alphaMultiplier || inTrans->alphaOffset!=t.alphaOffset )
+            return false;
+      }
+      return true;
+   }
+
+   static const DrawElement *FirstElement(const HardwareData &inData)
+   {
+      for(int e=0;e<inData.mElements.size();e++)
+         if (inData.mElements[e].mCount)
+            return &inData.mElements[e];
+      return 0;
+   }
+
+   static const DrawElement *LastElement(const HardwareData &inData)
+   {
+      for(int e=inData.mElements.size()-1;e>=0;e--)
+         if (inData.mElements[e].mCount)
+            return &inData.mElements[e];
+      return 0;
+   }
+
+   static int VertexCount(const HardwareData &inData)
+   {
+      int count = 0;
+      for(int e=0;e<inData.mElements.size();e++)
+         count += inData.mElements[e].mCount;
+      return count;
+   }
+
+   void AddToBatch(const HardwareData &inData, const Matrix &inMatrix, const ColorTransform *inTrans)
+   {
+      if (!mBatchFirst && !mBatch.mElements[0].mCount)
+      {
+         HoldBatchFirst(inData,inMatrix,inTrans);
+         return;
+      }
+
+      if (mBatchFirst)
+      {
+         // Only worth copying if the two join up
+         if ( !TransMatches(inTrans) ||
+              VertexCount(*mBatchFirst)+VertexCount(inData)>sgMaxBatchVertices ||
+              !ElementsMatch(*FirstElement(inData),*LastElement(*mBatchFirst)) )
+         {
+            FlushBatch();
+            HoldBatchFirst(inData,inMatrix,inTrans);
+            return;
+         }
+         const HardwareData *first = mBatchFirst;
+         mBatchFirst = 0;
+         CopyToBatch(*first,mBatchFirstMatrix,inTrans);
+      }
+
+      CopyToBatch(inData,inMatrix,inTrans);
+   }
+
+   void HoldBatchFirst(const HardwareData &inData, const Matrix &inMatrix, const ColorTransform *inTrans)
+   {
+      mBatchFirst = &inData;
+      mBatchFirstMatrix = inMatrix;
+      mBatchHasTrans = inTrans!=0;
+      if (inTrans)
+         mBatchTrans = *inTrans;
+   }
+
+   void CopyToBatch(const HardwareData &inData, const Matrix &inMatrix, const ColorTransform *inTrans)
+   {
+      DrawElement &batch = mBatch.mElements[0];
+
+      for(int e=0;e<inData.mElements.size();e++)
+      {
+         const DrawElement &element = inData.mElements[e];
+         if (!element.mCount)
+            continue;
+
+         if (batch.mCount && (batch.mCount+element.mCount>sgMaxBatchVertices ||
+                               !BatchMatches(element,inTrans)) )
+            FlushBatch();
+
+         if (!batch.mCount)
+         {
+            if (batch.mSurface)
+               batch.mSurface->DecRef();
+            batch = element;
+            batch.mCount = 0;
+            batch.mVertexOffset = 0;
+            batch.mTexOffset = element.mTexOffset - element.mVertexOffset;
+            batch.mColourOffset = element.mColourOffset - element.mVertexOffset;
+            batch.mNormalOffset = 0;
+            if (batch.mSurface)
+               batch.mSurface->IncRef();
+            mBatchHasTrans = inTrans!=0;
+            if (inTrans)
+               mBatchTrans = *inTrans;
+         }
+
+         int stride = element.mStride;
+         int base = mBatch.mArray.size();
+         mBatch.mArray.resize(base + element.mCount*stride);
+         uint8 *dest = &mBatch.mArray[base];
+         memcpy(dest, &inData.mArray[element.mVertexOffset], element.mCount*stride);
+         for(int v=0;v<element.mCount;v++)
+         {
+            UserPoint &p = *(UserPoint *)(dest + v*stride);
+            p = inMatrix.Apply(p.x,p.y);
+         }
+         batch.mCount += element.mCount;
+      }
+   }
+
+   void FlushBatch()
+   {
+      DrawElement &batch = mBatch.mElements[0];
+      if (mBatchFirst)
+      {
+         const HardwareData *first = mBatchFirst;
+         mBatchFirst = 0;
+         RenderObject(*first, mBatchFirstMatrix, mBatchHasTrans ? &mBatchTrans : 0);
+      }
+      else if (batch.mCount)
+      {
+         mBatch.mRendersWithoutVbo = -999;
+         RenderData(mBatch, mBatchHasTrans ? &mBatchTrans : 0, mBitmapTrans);
+      }
+      ClearBatch();
+   }
+
+   void ClearBatch()
+   {
+      DrawElement &batch = mBatch.mElements[0];
+      mBatchFirst = 0;
+      batch.mCount = 0;
+      if (batch.mSurface)
+      {
+         batch.mSurface->DecRef();
+         batch.mSurface = 0;
+      }
+      mBatch.mArray.resize(0);
+   }
+
    void RenderData(const HardwareData &inData, const ColorTransform *ctrans,const Trans4x4 &inTrans)
    {
+      NME_PROFILE_ZONE("RenderData");
       const uint8 *data = 0;
       if (inData.mVertexBo)
       {
@@ -411,7 +708,7 @@ public:
             inData.mContextId = 0;
          }
          else
-            glBindBuffer(GL_ARRAY_BUFFER, inData.mVertexBo);
+            gGLState.BindBuffer(GL_ARRAY_BUFFER, inData.mVertexBo);
       }
 
       if (!inData.mVertexBo)
@@ -426,13 +723,20 @@ public:
             inData.mVboOwner = this;
             IncRef();
             inData.mContextId = gTextureContextVersion;
-            glBindBuffer(GL_ARRAY_BUFFER, inData.mVertexBo);
+            gGLState.BindBuffer(GL_ARRAY_BUFFER, inData.mVertexBo);
             // printf("VBO DATA %d\n", inData.mArray.size());
             glBufferData(GL_ARRAY_BUFFER, inData.mArray.size(), data, GL_STATIC_DRAW);
             data = 0;
          }
       }
 
+      GLuint vbo = inData.mVertexBo;
+      if (data)
+      {
+         data = (const uint8 *)(size_t)StreamData(data, inData.mArray.size());
+         vbo = mStreamBuffer;
+      }
+
       GPUProg *lastProg = 0;
       bool rebind = false;
  
@@ -443,9 +747,9 @@ public:
          if (!n)
             continue;
 
-         if (rebind && inData.mVertexBo)
+         if (rebind && vbo)
          {
-            glBindBuffer(GL_ARRAY_BUFFER, inData.mVertexBo);
+            gGLState.BindBuffer(GL_ARRAY_BUFFER, vbo);
             rebind = false;
          }
 
@@ -491,16 +795,16 @@ public:
          switch(element.mBlendMode)
          {
             case bmAdd:
-               glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+               gGLState.BlendFunc( GL_SRC_ALPHA, GL_ONE );
                break;
             case bmMultiply:
-               glBlendFunc( GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
+               gGLState.BlendFunc( GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA);
                break;
             case bmScreen:
-               glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+               gGLState.BlendFunc( GL_ONE, GL_ONE_MINUS_SRC_COLOR);
                break;
             default:
-               glBlendFunc(premAlpha ? GL_ONE : GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+               gGLState.BlendFunc(premAlpha ? GL_ONE : GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
          }
 
 
@@ -543,8 +847,8 @@ public:
             {
                BindFullQuadTextures(element.mCount);
                glVertexAttribPointer(prog->textureSlot, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), 0);
-               if (data)
-                  glBindBuffer(GL_ARRAY_BUFFER, 0);
+               if (!vbo)
+                  gGLState.BindBuffer(GL_ARRAY_BUFFER, 0);
                else
                   rebind = true;
             }
@@ -611,6 +915,8 @@ public:
             //printf("glDrawArrays %d : %d x %d\n", element.mPrimType, element.mFirst, element.mCount );
 
          sgDrawCount++;
+         ProfileCount(pcDrawCalls);
+         ProfileCount(pcVertices,element.mCount);
          
          if (element.mPrimType==ptQuads || element.mPrimType==ptQuadsFull)
          {
@@ -625,8 +931,34 @@ public:
       if (lastProg)
         lastProg->disableSlots();
 
-      if (inData.mVertexBo)
-         glBindBuffer(GL_ARRAY_BUFFER,0);
+      // The vbo is left bound, so the next object from the same buffer - often the
+      //  stream buffer - does not bind it again.  Direct rendering starts unbound.
+   }
+
+   // Copies dynamic vertex data into the stream buffer, leaving it bound, and returns the offset.
+   // When the buffer is full, it is orphaned so the driver can hand us fresh memory while
+   //  the gpu is still drawing from the old contents.
+   int StreamData(const uint8 *inData, int inSize)
+   {
+      if (mStreamBuffer==0)
+      {
+         glGenBuffers(1,&mStreamBuffer);
+         mStreamSize = 0;
+      }
+      gGLState.BindBuffer(GL_ARRAY_BUFFER, mStreamBuffer);
+
+      if (inSize>mStreamSize || mStreamPos+inSize>mStreamSize)
+      {
+         while(mStreamSize<inSize || mStreamSize<sgStreamBufferSize)
+            mStreamSize = mStreamSize ? mStreamSize*2 : sgStreamBufferSize;
+         glBufferData(GL_ARRAY_BUFFER, mStreamSize, 0, GL_STREAM_DRAW);
+         mStreamPos = 0;
+      }
+
+      int offset = mStreamPos;
+      glBufferSubData(GL_ARRAY_BUFFER, offset, inSize, inData);
+      mStreamPos = (offset + inSize + 15) & ~15;
+      return offset;
    }
 
    void BindFullQuadTextures(int inVertexCount)
@@ -641,7 +973,7 @@ public:
             glGenBuffers(1,&mFullTexCoordsBuffer);
 
          mFullTexCoordsSize = quadCount;
-         glBindBuffer(GL_ARRAY_BUFFER, mFullTexCoordsBuffer);
+         gGLState.BindBuffer(GL_ARRAY_BUFFER, mFullTexCoordsBuffer);
 
          std::vector<float> tex(quadCount*2*4);
          int idx = 0;
@@ -655,7 +987,7 @@ public:
          glBufferData(GL_ARRAY_BUFFER, sizeof(float)*tex.size(), &tex[0], GL_STATIC_DRAW);
       }
       else
-         glBindBuffer(GL_ARRAY_BUFFER, mFullTexCoordsBuffer);
+         gGLState.BindBuffer(GL_ARRAY_BUFFER, mFullTexCoordsBuffer);
    }
 
    void BindQuadsBufferIndices(int inVertexCount)
@@ -675,7 +1007,7 @@ public:
             quadCount = 4096;
 
          mQuadsBufferSize = quadCount;
-         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadsBuffer);
+         gGLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadsBuffer);
 
          if (quadCount*4<65536)
          {
@@ -715,14 +1047,33 @@ public:
          }
       }
       else
-         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadsBuffer);
+         gGLState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadsBuffer);
    }
 
 
 
 
+   Surface *FilterBitmap(const FilterList &inFilters, Surface *inBitmap,
+                         const Rect &inSrcRect, const Rect &inDestRect, ImagePoint inSrc0)
+   {
+      FlushBatch();
+      Surface *result = mFilters.FilterBitmap(this,inFilters,inBitmap,inSrcRect,inDestRect,inSrc0);
+
+      // Put back the viewport and blending changed by the passes
+      if (mViewport.w>=0)
+      {
+         Rect viewport = mViewport;
+         mViewport.w = -1;
+         SetViewport(viewport);
+      }
+      gGLState.Enable(GL_BLEND);
+      return result;
+   }
+
+
    void BeginBitmapRender(Surface *inSurface,uint32 inTint,bool inRepeat,bool inSmooth)
    {
+      FlushBatch();
       mBitmapBuffer.mArray.resize(0);
       mBitmapBuffer.mRendersWithoutVbo = -999;
       DrawElement &e = mBitmapBuffer.mElements[0];
@@ -807,7 +1158,10 @@ public:
 
    Texture *CreateTexture(Surface *inSurface,unsigned int inFlags)
    {
-      return OGLCreateTexture(inSurface,inFlags);
+      Texture *result = gUseTextureAtlas ? OGLCreateAtlasTexture(inSurface,inFlags) : 0;
+      if (!result)
+         result = OGLCreateTexture(inSurface,inFlags);
+      return result;
    }
 
    void SetQuality(StageQuality inQ)
@@ -884,6 +1238,7 @@ public:
    #ifdef NME_S3D
    void EndS3DRender()
    {
+      FlushBatch();
       setOrtho(0, mWidth, 0, mHeight);
       #ifdef ANDROID
       mS3D.EndS3DRender(mWidth, mHeight, mTrans);
@@ -892,6 +1247,7 @@ public:
    
    void SetS3DEye(int eye)
    {
+      FlushBatch();
       #ifdef ANDROID
       mS3D.SetS3DEye(eye);
       #endif
@@ -919,6 +1275,12 @@ public:
    HardwareData mBitmapBuffer;
    Texture *mBitmapTexture;
 
+   HardwareData   mBatch;
+   const HardwareData *mBatchFirst;
+   Matrix         mBatchFirstMatrix;
+   bool           mBatchHasTrans;
+   ColorTransform mBatchTrans;
+
    double mLineWidth;
    
    // TODO - mutex in case finalizer is run from thread
@@ -931,6 +1293,7 @@ public:
    QuickVec<GLuint> mZombieRenderbuffers;
 
    GPUProg *mProg[PROG_COUNT];
+   OGLFilters mFilters;
 
    double mScaleX;
    double mOffsetX;
@@ -944,6 +1307,10 @@ public:
    GLenum mQuadsBufferSize;
    GLenum mQuadsBufferType;
 
+   GLuint mStreamBuffer;
+   int    mStreamSize;
+   int    mStreamPos;
+
 
    Trans4x4 mTrans;
    Trans4x4 mBitmapTrans;
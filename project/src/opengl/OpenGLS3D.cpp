@@ -160,6 +160,9 @@ void OpenGLS3D::EndS3DRender(int inWidth, int inHeight, const Trans4x4 &inTrans)
    
    glActiveTexture(GL_TEXTURE2);
    glBindTexture(GL_TEXTURE_2D, 0);
+
+   // Changed without the state cache
+   gGLState.Invalidate();
 }
 
 void OpenGLS3D::SetS3DEye(int eye)
@@ -193,6 +196,9 @@ void OpenGLS3D::SetS3DEye(int eye)
    
    glClearColor(0, 0, 0, 1.0);
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+   // Changed without the state cache
+   gGLState.Invalidate();
 }
 
 void OpenGLS3D::Resize(int inWidth, int inHeight)
@@ -247,6 +253,9 @@ void OpenGLS3D::Resize(int inWidth, int inHeight)
 
    glBindRenderbuffer(GL_RENDERBUFFER, 0);
    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+   // Changed without the state cache
+   gGLState.Invalidate();
 }
 
 void OpenGLS3D::FocusEye(Trans4x4 &outTrans)
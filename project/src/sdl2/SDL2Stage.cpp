@@ -322,6 +322,7 @@ public:
          }
          mSoftwareTexture = SDL_CreateTexture(mSDLRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, mWidth, mHeight);
          ((SDLSurf*)mPrimarySurface)->mSurf = mSoftwareSurface;
+         DamageAll();
       }
    }
    
@@ -590,7 +591,21 @@ public:
       }
       else
       {
-         SDL_UpdateTexture(mSoftwareTexture, NULL, mSoftwareSurface->pixels, mSoftwareSurface->pitch);
+         const DamageRegion &damage = GetDamage();
+         if (damage.IsFull())
+            SDL_UpdateTexture(mSoftwareTexture, NULL, mSoftwareSurface->pixels, mSoftwareSurface->pitch);
+         else
+         {
+            // Only upload what was redrawn
+            int pitch = mSoftwareSurface->pitch;
+            for(int i=0;i<damage.Count();i++)
+            {
+               const Rect &r = damage[i];
+               SDL_Rect rect = { r.x, r.y, r.w, r.h };
+               const uint8 *pixels = (const uint8 *)mSoftwareSurface->pixels + r.y*pitch + r.x*4;
+               SDL_UpdateTexture(mSoftwareTexture, &rect, pixels, pitch);
+            }
+         }
          //SDL_RenderClear(mSDLRenderer);
          SDL_RenderCopy(mSDLRenderer, mSoftwareTexture, NULL, NULL);
          SDL_RenderPresent(mSDLRenderer);
@@ -736,6 +751,8 @@ public:
    {
       return mPrimarySurface;
    }
+
+   bool KeepsBackBuffer() { return !mIsOpenGL; }
    
    
    HardwareRenderer *mOpenGLContext;
@@ -78,12 +78,46 @@ void AlphaMask::Dispose()
 }
 
 
+struct AlphaBitmapBandTask : public WorkerTask
+{
+   AlphaBitmapBandTask(AlphaMask &inMask, int inTX, int inTY, const RenderTarget &inTarget,
+                       const Rect &inRect, int inBands) :
+      mMask(inMask), mTX(inTX), mTY(inTY), mTarget(inTarget), mRect(inRect), mBands(inBands) { }
+
+   void RunTask(int inBand)
+   {
+      mMask.RenderBitmapRows(mTX, mTY, mTarget, GetRenderBand(mRect, inBand, mBands));
+   }
+
+   AlphaMask          &mMask;
+   int                mTX;
+   int                mTY;
+   const RenderTarget &mTarget;
+   Rect               mRect;
+   int                mBands;
+};
+
+
 void AlphaMask::RenderBitmap(int inTX, int inTY, const RenderTarget &inTarget, const RenderState &inState)
 {
    if (mLineStarts.size() < 2)
       return;
-   
-   Rect clip = inState.mClipRect;
+
+   Rect rect = mRect.Translated(inTX, inTY).Intersect(inState.mClipRect);
+   int bands = GetRenderBands(rect);
+   if (bands > 1)
+   {
+      AlphaBitmapBandTask task(*this, inTX, inTY, inTarget, rect, bands);
+      RunWorkerTask(&task, bands);
+   }
+   else
+      RenderBitmapRows(inTX, inTY, inTarget, inState.mClipRect);
+}
+
+
+void AlphaMask::RenderBitmapRows(int inTX, int inTY, const RenderTarget &inTarget, const Rect &inClip)
+{
+   Rect clip = inClip;
    int y = mRect.y + inTY;
    const int *start = &mLineStarts[0] - y;
    
@@ -607,22 +641,33 @@ void BuildAlphaRuns4(const SpanRect &inRect,Transitions *inTrans, AlphaRuns &out
 }
 
 
-AlphaMask *SpanRect::CreateMask(const Transform &inTransform, int inAlpha, Lines &inLines)
+struct MaskBandTask : public WorkerTask
 {
-   Rect rect = mRect / mAA;
-   
-   if (inLines.size() < rect.h)
-      inLines.resize(rect.h);
-   mLines = &inLines[0];
-   
-   AlphaMask *mask = AlphaMask::Create(rect, inTransform);
-   Transitions *t = &mTransitions[0];
-   int start = 0;
+   MaskBandTask(SpanRect &inSpan, int inAlpha, const Rect &inRect, int inBands) :
+      mSpan(inSpan), mAlpha(inAlpha), mRect(inRect), mBands(inBands) { }
+
+   void RunTask(int inBand)
+   {
+      Rect band = GetRenderBand(mRect, inBand, mBands);
+      mSpan.BuildLines(band.y, band.y1(), mAlpha);
+   }
+
+   SpanRect &mSpan;
+   int      mAlpha;
+   Rect     mRect;
+   int      mBands;
+};
+
+
+// Builds the runs for lines inY0 ... inY1, relative to the top of the rect.
+// Each line is independent, so this may be called for different lines at the same time.
+void SpanRect::BuildLines(int inY0, int inY1, int inAlpha)
+{
+   Transitions *t = &mTransitions[inY0*mAA];
    
-   for (int y = 0; y < rect.h; y++)
+   for (int y = inY0; y < inY1; y++)
    {
       mLines[y].resize(0);
-      mask->mLineStarts[y] = start;
       
       switch(mAA)
       {
@@ -636,9 +681,36 @@ AlphaMask *SpanRect::CreateMask(const Transform &inTransform, int inAlpha, Lines
             BuildAlphaRuns4(*this,t, mLines[y], inAlpha);
             break;
       }
-      start += mLines[y].size();
       t += mAA;
    }
+}
+
+
+AlphaMask *SpanRect::CreateMask(const Transform &inTransform, int inAlpha, Lines &inLines)
+{
+   Rect rect = mRect / mAA;
+   
+   if (inLines.size() < rect.h)
+      inLines.resize(rect.h);
+   mLines = &inLines[0];
+   
+   AlphaMask *mask = AlphaMask::Create(rect, inTransform);
+
+   int bands = GetRenderBands(rect);
+   if (bands > 1)
+   {
+      MaskBandTask task(*this, inAlpha, Rect(rect.w, rect.h), bands);
+      RunWorkerTask(&task, bands);
+   }
+   else
+      BuildLines(0, rect.h, inAlpha);
+
+   int start = 0;
+   for (int y = 0; y < rect.h; y++)
+   {
+      mask->mLineStarts[y] = start;
+      start += mLines[y].size();
+   }
    
    mask->mLineStarts[rect.h] = start;
    mask->mAlphaRuns.resize(start);
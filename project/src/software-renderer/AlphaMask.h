@@ -60,6 +60,7 @@ public:
    void Dispose();
    void ClearCache();
    void RenderBitmap(int inTX, int inTY, const RenderTarget &inTarget, const RenderState &inState);
+   void RenderBitmapRows(int inTX, int inTY, const RenderTarget &inTarget, const Rect &inClip);
    
    // Given we were created with a certain transform and valid data rect, can we
    // cover the requested area for the requested transform?
@@ -81,6 +82,7 @@ struct SpanRect
 
    AlphaMask *CreateMask(const Transform &inTransform, int inAlpha);
    inline AlphaMask *CreateMask(const Transform &inTransform, int inAlpha, Lines &inLineBuf);
+   void BuildLines(int inY0, int inY1, int inAlpha);
 
    // first bit = X AA, second bit = Y AA
    void Line00(Fixed10 inP0, Fixed10 inP1);
@@ -104,9 +106,16 @@ private:
 
 
 
+// Split large areas into horizontal bands for the worker threads - see Render.h
+int  GetRenderBands(const Rect &inRect);
+Rect GetRenderBand(const Rect &inRect, int inBand, int inBands);
+
+
 class Filler
 {
 public:
+   // Set in fillers that return the same colour for every pixel
+   enum { IsSolid = 0 };
    
    virtual ~Filler() { };
    
@@ -25,6 +25,17 @@ namespace nme
 		}
 		
 		
+		// Copies are used when rendering in multiple threads
+		GradientFillerBase(const GradientFillerBase &inRHS) :
+			Filler(inRHS), mPos(inRHS.mPos), mDGXDX(inRHS.mDGXDX), mDGYDX(inRHS.mDGYDX),
+			mIsSwapped(inRHS.mIsSwapped), mIsInit(inRHS.mIsInit), mMask(inRHS.mMask), mPad(inRHS.mPad),
+			mRadial(inRHS.mRadial), mMapper(inRHS.mMapper), mGrad(inRHS.mGrad)
+		{
+			mColours = new ARGB[mMask + 1];
+			memcpy(mColours, inRHS.mColours, (mMask + 1) * sizeof(ARGB));
+		}
+		
+		
 		~GradientFillerBase()
 		{
 			delete [] mColours;
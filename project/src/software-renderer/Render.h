@@ -3,6 +3,8 @@
 
 #include "AlphaMask.h"
 #include <nme/Pixel.h>
+#include <NMEThread.h>
+#include <SpanBlend.h>
 
 
 
@@ -28,6 +30,9 @@ void DestRender(const AlphaMask &inAlpha, SOURCE_ &inSource, DEST_ &outDest, con
 
    clip.ClipY(y,y1);
 
+   // Solid colours onto opaque surfaces can be done a whole run at a time
+   SpanSolidFunc solid = (SOURCE_::IsSolid && !DEST_::HasAlpha) ? GetSpanSolid() : 0;
+
    for(; y<y1; y++)
    {
       const AlphaRun *run = &inAlpha.mAlphaRuns[ lines[y] ];
@@ -92,6 +97,14 @@ void DestRender(const AlphaMask &inAlpha, SOURCE_ &inSource, DEST_ &outDest, con
                if (!SOURCE_::HasAlpha)
                   alpha -= (alpha>>7);
 
+               if (solid)
+               {
+                  if (x1>x0)
+                     solid(outDest.mPtr, inBlend.template Prepare<SOURCE_::HasAlpha>(inSource.GetInc(),alpha), x1-x0);
+                  ++run;
+                  continue;
+               }
+
                while(x0++<x1)
                   if (SOURCE_::HasAlpha)
                   {
@@ -154,10 +167,9 @@ struct NormalBlender
          mB_LUT = inState.mB_LUT;
       }
    }
-   template<bool DEST_ALPHA,bool SRC_ALPHA,typename DEST, typename SRC>
-   void Blend(DEST &inDest, SRC &inSrc,int inAlpha) const
+   template<bool SRC_ALPHA>
+   ARGB Prepare(ARGB src,int inAlpha) const
    {
-      ARGB src = inSrc.GetInc();
       if (SRC_ALPHA)
       {
          if (ALPHA_LUT)
@@ -178,6 +190,12 @@ struct NormalBlender
          src.g = mG_LUT[src.g];
          src.b = mB_LUT[src.b];
       }
+      return src;
+   }
+   template<bool DEST_ALPHA,bool SRC_ALPHA,typename DEST, typename SRC>
+   void Blend(DEST &inDest, SRC &inSrc,int inAlpha) const
+   {
+      ARGB src = Prepare<SRC_ALPHA>(inSrc.GetInc(),inAlpha);
       ARGB dest = inDest.Get();
       dest.Blend<DEST_ALPHA>(src);
       inDest.SetInc(dest);
@@ -231,7 +249,7 @@ void RenderBlend(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget
 
 
 template<typename SOURCE_>
-void Render(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget &inDest,
+void RenderRows(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget &inDest,
             const RenderState &inState, int inTX, int inTY)
 {
 
@@ -245,6 +263,55 @@ void Render(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget &inD
       RENDER(false,false);
 }
 
+
+// --- Multi-threaded rendering ---------------------------------------------
+//
+// Large areas are split into horizontal bands, which are rendered on the worker threads.
+// Each band gets its own copy of the source, since sources track their position as they go.
+
+template<typename SOURCE_>
+class RenderBandTask : public WorkerTask
+{
+public:
+   RenderBandTask(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget &inDest,
+                  const RenderState &inState, const Rect &inRect, int inBands, int inTX, int inTY) :
+      mAlpha(inAlpha), mSource(inSource), mDest(inDest), mState(inState),
+      mRect(inRect), mBands(inBands), mTX(inTX), mTY(inTY) { }
+
+   void RunTask(int inBand)
+   {
+      RenderState state(mState);
+      state.mClipRect = GetRenderBand(mRect, inBand, mBands);
+      SOURCE_ source(mSource);
+      RenderRows(mAlpha, source, mDest, state, mTX, mTY);
+   }
+
+   const AlphaMask    &mAlpha;
+   SOURCE_            &mSource;
+   const RenderTarget &mDest;
+   const RenderState  &mState;
+   Rect               mRect;
+   int                mBands;
+   int                mTX;
+   int                mTY;
+};
+
+
+template<typename SOURCE_>
+void Render(const AlphaMask &inAlpha, SOURCE_ &inSource, const RenderTarget &inDest,
+            const RenderState &inState, int inTX, int inTY)
+{
+   Rect rect = inAlpha.mRect.Translated(inTX,inTY).Intersect(inState.mClipRect);
+   int bands = GetRenderBands(rect);
+   if (bands>1)
+   {
+      RenderBandTask<SOURCE_> task(inAlpha, inSource, inDest, inState, rect, bands, inTX, inTY);
+      RunWorkerTask(&task, bands);
+   }
+   else
+      RenderRows(inAlpha, inSource, inDest, inState, inTX, inTY);
+}
+
 } // end namespace nme
 
 #endif
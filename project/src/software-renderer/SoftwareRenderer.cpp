@@ -1,4 +1,5 @@
 #include <Graphics.h>
+#include <NMEThread.h>
 #include "PolygonRender.h"
 
 namespace nme
@@ -32,4 +33,35 @@ Renderer *Renderer::CreateSoftware(const GraphicsJob &inJob, const GraphicsPath
 }
 
 
+
+// --- Render bands ----------------------------------------------------------
+
+// Below this, the cost of waking the workers outweighs the gain
+enum { MIN_BAND_PIXELS = 64*64, MIN_BAND_ROWS = 16 };
+
+int GetRenderBands(const Rect &inRect)
+{
+   int threads = GetWorkerThreads();
+   if (threads<1 || !inRect.HasPixels() || inRect.Area()<MIN_BAND_PIXELS*2 || !IsMainThread())
+      return 1;
+
+   int bands = threads + 1;
+   int max_bands = inRect.h / MIN_BAND_ROWS;
+   if (bands>max_bands)
+      bands = max_bands;
+   int max_area = inRect.Area() / MIN_BAND_PIXELS;
+   if (bands>max_area)
+      bands = max_area;
+   return bands<1 ? 1 : bands;
+}
+
+
+Rect GetRenderBand(const Rect &inRect, int inBand, int inBands)
+{
+   int y0 = inRect.y + inRect.h*inBand/inBands;
+   int y1 = inRect.y + inRect.h*(inBand+1)/inBands;
+   return Rect(inRect.x, y0, inRect.w, y1-y0);
+}
+
+
 } // end namespace nme
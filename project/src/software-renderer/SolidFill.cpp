@@ -9,6 +9,7 @@ class SolidFiller : public Filler
 {
 public:
 	enum { HasAlpha = HAS_ALPHA };
+	enum { IsSolid = 1 };
 
 	SolidFiller(GraphicsSolidFill *inFill)
 	{
@@ -1,5 +1,6 @@
 #include "PolygonRender.h"
 #include <Surface.h>
+#include <NMEThread.h>
 
 
 namespace nme
@@ -63,6 +64,7 @@ public:
    Filler             *mFiller;
    QuickVec<TileData> mTileData;
    BlendMode          mBlendMode;
+   bool               mCanBand;
 
    TileRenderer(const GraphicsJob &inJob, const GraphicsPath &inPath)
    {
@@ -76,6 +78,10 @@ public:
       mBlendMode = bmNormal;
       if (inJob.mBlendMode==pcBlendModeAdd)
          mBlendMode = bmAdd;
+      // Colour transforms use the shared LUT cache in ColorTransform.cpp, so only plain tiles
+      //  are rendered in bands.  Transformed tiles are tinted through a combined colour
+      //  transform in RenderTiles (even without pcTile_Col_Bit), so they need it too.
+      mCanBand = mBlendMode==bmNormal && !(inJob.mTileMode & (pcTile_Trans_Bit|pcTile_Col_Bit));
 
       int size = (inJob.mTileMode & pcTile_Full_Image_Bit) ? 1 : 3;
       if (inJob.mTileMode & pcTile_Trans_Bit)
@@ -141,7 +147,46 @@ public:
    }
    
    
+   struct BandTask : public WorkerTask
+   {
+      BandTask(TileRenderer *inRenderer, const RenderTarget &inTarget, const RenderState &inState,
+               const Rect &inRect, int inBands) :
+         mRenderer(inRenderer), mTarget(inTarget), mState(inState), mRect(inRect), mBands(inBands) { }
+
+      void RunTask(int inBand)
+      {
+         RenderState state(mState);
+         state.mClipRect = GetRenderBand(mRect, inBand, mBands);
+         // Each band needs its own filler, since the mapping is set per-tile
+         Filler *filler = Filler::Create(mRenderer->mFill);
+         mRenderer->RenderTiles(mTarget.ClipRect(state.mClipRect), state, filler);
+         delete filler;
+      }
+
+      TileRenderer       *mRenderer;
+      const RenderTarget &mTarget;
+      const RenderState  &mState;
+      Rect               mRect;
+      int                mBands;
+   };
+
+
    bool Render(const RenderTarget &inTarget, const RenderState &inState)
+   {
+      int bands = mCanBand ? GetRenderBands(inState.mClipRect.Intersect(inTarget.mRect)) : 1;
+      if (bands>1)
+      {
+         BandTask task(this, inTarget, inState, inState.mClipRect.Intersect(inTarget.mRect), bands);
+         RunWorkerTask(&task, bands);
+      }
+      else
+         RenderTiles(inTarget, inState, mFiller);
+
+      return true;
+   }
+
+
+   void RenderTiles(const RenderTarget &inTarget, const RenderState &inState, Filler *inFiller)
    {
       #define orthoTol 1e-6
 
@@ -167,7 +212,8 @@ public:
          UserPoint corner(data.mPos);
          UserPoint pos = inState.mTransform.mMatrix->Apply(corner.x,corner.y);
 
-         bool is_ortho = is_base_ortho && (!data.mHasTrans || fabs(data.mTransX.y)<orthoTol);
+         bool is_ortho = is_base_ortho && (!data.mHasTrans ||
+                           (fabs(data.mTransX.y)<orthoTol && fabs(data.mTransY.x)<orthoTol) );
          bool is_identity = data.mHasTrans ?
                            is_ortho && fabs(sx*data.mTransX.x-1.0)<orthoTol && fabs(sy*data.mTransY.y-1)<orthoTol :
                            is_base_identity;
@@ -205,14 +251,15 @@ public:
                p[0] = inState.mTransform.mMatrix->Apply(corner.x,corner.y);
                if (data.mHasTrans)
                {
+                  // Across the tile is w*(a,b) and down it h*(c,d), as the hardware draws it
                   p[1] = inState.mTransform.mMatrix->Apply(
                             corner.x + data.mRect.w*data.mTransX.x,
-                            corner.y + data.mRect.w*data.mTransY.x);
+                            corner.y + data.mRect.w*data.mTransX.y);
                   p[2] = inState.mTransform.mMatrix->Apply(
-                            corner.x + data.mRect.w*data.mTransX.x + data.mRect.h*data.mTransX.y,
-                            corner.y + data.mRect.w*data.mTransY.x + data.mRect.h*data.mTransY.y );
+                            corner.x + data.mRect.w*data.mTransX.x + data.mRect.h*data.mTransY.x,
+                            corner.y + data.mRect.w*data.mTransX.y + data.mRect.h*data.mTransY.y );
                   p[3] = inState.mTransform.mMatrix->Apply(
-                            corner.x + data.mRect.h*data.mTransX.y,
+                            corner.x + data.mRect.h*data.mTransY.x,
                             corner.y + data.mRect.h*data.mTransY.y );
                }
                else
@@ -267,7 +314,7 @@ public:
                uvt[3] = (data.mRect.y) * bmp_scale_y;
                uvt[4] = (data.mRect.x + data.mRect.w) * bmp_scale_x;
                uvt[5] = (data.mRect.y + data.mRect.h) * bmp_scale_y;
-               mFiller->SetMapping(p,uvt,2);
+               inFiller->SetMapping(p,uvt,2);
 
                // Can render straight to surface ....
                if (!offscreen_buffer)
@@ -277,9 +324,9 @@ public:
                      if (data.mHasColour)
                      {
                         ARGB col = inState.mColourTransform->Transform(data.mColour|0xff000000);
-                        mFiller->SetTint(col);
+                        inFiller->SetTint(col);
                      }
-                     mFiller->Fill(*alpha,0,0,inTarget,inState);
+                     inFiller->Fill(*alpha,0,0,inTarget,inState);
                   }
                   else if (data.mHasTrans && !just_alpha)
                   {
@@ -290,10 +337,10 @@ public:
                      tint.greenMultiplier = ((data.mColour>>8) & 0xff) * one_on_255;
                      tint.blueMultiplier =  ((data.mColour>>16)  & 0xff) * one_on_255;
                      col_state.CombineColourTransform(inState, &tint, &buf);
-                     mFiller->Fill(*alpha,0,0,inTarget,col_state);
+                     inFiller->Fill(*alpha,0,0,inTarget,col_state);
                   }
                   else
-                     mFiller->Fill(*alpha,0,0,inTarget,inState);
+                     inFiller->Fill(*alpha,0,0,inTarget,inState);
                }
                else
                {
@@ -308,11 +355,11 @@ public:
                   if (s->Format()==pfAlpha && data.mHasColour)
                   {
                      ARGB col = inState.mColourTransform->Transform(data.mColour|0xff000000);
-                     mFiller->SetTint(col);
+                     inFiller->SetTint(col);
                   }
 
 
-                  mFiller->Fill(*alpha,0,0,target,inState);
+                  inFiller->Fill(*alpha,0,0,target,inState);
                   }
 
                   tmp->BlitTo(inTarget, Rect(0,0,visible_pixels.w,visible_pixels.h),
@@ -339,8 +386,6 @@ public:
       }
 
       //printf("b/s/r = %d/%d/%d\n", blits, stretches, renders);
-      
-      return true;
    }
 
 };
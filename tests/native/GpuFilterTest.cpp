@@ -0,0 +1,226 @@
+// Checks the gpu filters (OGLFilters) against the cpu ones (FilterBitmap).
+// It needs no display - the context is a surfaceless EGL one, which Mesa's software
+//  renderer (llvmpipe) provides.  See test.sh for how it is built and run.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <Hardware.h>
+#include <Surface.h>
+#include <Filters.h>
+#include "OGL.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+
+
+namespace nme
+{
+
+// Each channel of the premultiplied result may be off by this much.  The cpu rounds down
+//  in every blur pass, so its results run a little darker - a pixel out of place is
+//  off by far more.
+static const int sTolerance = 6;
+
+
+static bool CreateContext()
+{
+   EGLDisplay display = EGL_NO_DISPLAY;
+   PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+   if (getPlatformDisplay)
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+   if (display==EGL_NO_DISPLAY)
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+   EGLint major = 0, minor = 0;
+   if (display==EGL_NO_DISPLAY || !eglInitialize(display,&major,&minor))
+      return false;
+
+   // Desktop gl, like the linux stage, so the same shaders are tested
+   if (!eglBindAPI(EGL_OPENGL_API))
+      return false;
+
+   EGLint attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+   EGLConfig config = 0;
+   EGLint configs = 0;
+   eglChooseConfig(display,attribs,&config,1,&configs);
+
+   EGLContext context = eglCreateContext(display, configs ? config : 0, EGL_NO_CONTEXT, 0);
+   if (context==EGL_NO_CONTEXT)
+      return false;
+   return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+
+// An object with soft edges and a mix of colours and alpha, not premultiplied, like a
+//  cached bitmap
+static Surface *CreateObject(int inWidth, int inHeight)
+{
+   Surface *result = new SimpleSurface(inWidth,inHeight,pfARGB);
+   result->IncRef();
+
+   srand(1);
+   uint8 *base = result->Edit(0);
+   for(int y=0;y<inHeight;y++)
+   {
+      uint32 *row = (uint32 *)(base + y*result->GetStride());
+      for(int x=0;x<inWidth;x++)
+      {
+         bool inside = x>=4 && x<inWidth-4 && y>=3 && y<inHeight-3;
+         int alpha = inside ? 64 + rand()%192 : 0;
+         if (inside && (x+y)%7==0)
+            alpha = 255;
+         row[x] = alpha ? (alpha<<24) | (rand() & 0xffffff) : 0;
+      }
+   }
+   result->Commit();
+   return result;
+}
+
+
+// Reads a surface back through its own texture - premultiplied, as the stage draws it
+static std::vector<uint8> ReadPixels(HardwareRenderer *inHardware, Surface *inSurface)
+{
+   int w = inSurface->Width();
+   int h = inSurface->Height();
+   std::vector<uint8> pixels(w*h*4);
+
+   inSurface->GetOwnTexture(inHardware)->Bind(0);
+   GLint tex = 0;
+   glGetIntegerv(GL_TEXTURE_BINDING_2D,&tex);
+
+   GLuint framebuffer = 0;
+   glGenFramebuffers(1,&framebuffer);
+   glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+   if (glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE)
+   {
+      glPixelStorei(GL_PACK_ALIGNMENT,1);
+      glReadPixels(0,0,w,h,GL_RGBA,GL_UNSIGNED_BYTE,&pixels[0]);
+   }
+   glBindFramebuffer(GL_FRAMEBUFFER,0);
+   glDeleteFramebuffers(1,&framebuffer);
+   return pixels;
+}
+
+
+static bool Check(HardwareRenderer *inHardware, const char *inName, Filter *inFilter,
+                  const Rect *inClip=0)
+{
+   FilterList filters;
+   filters.push_back(inFilter);
+
+   Surface *object = CreateObject(40,32);
+   Rect src_rect(object->Width(),object->Height());
+   Rect dest_rect = GetFilteredObjectRect(filters,src_rect);
+   if (inClip)
+      dest_rect = dest_rect.Intersect(*inClip);
+
+   Surface *gpu = inHardware->FilterBitmap(filters,object,src_rect,dest_rect,ImagePoint(0,0));
+   if (!gpu)
+   {
+      printf("FAIL %s: not run on the gpu\n", inName);
+      object->DecRef();
+      delete inFilter;
+      return false;
+   }
+
+   // The cpu version releases the object
+   Surface *cpu = FilterBitmap(filters,object,src_rect,dest_rect,false);
+
+   bool ok = gpu->Width()==cpu->Width() && gpu->Height()==cpu->Height();
+   int worst = 0;
+   int worst_x = 0;
+   int worst_y = 0;
+   if (ok)
+   {
+      std::vector<uint8> gpu_pixels = ReadPixels(inHardware,gpu);
+      std::vector<uint8> cpu_pixels = ReadPixels(inHardware,cpu);
+      for(int i=0;i<(int)gpu_pixels.size();i++)
+      {
+         int diff = abs(gpu_pixels[i] - cpu_pixels[i]);
+         if (diff>worst)
+         {
+            worst = diff;
+            worst_x = (i/4) % gpu->Width();
+            worst_y = (i/4) / gpu->Width();
+         }
+      }
+      ok = worst<=sTolerance;
+   }
+
+   if (ok)
+      printf("ok   %s: %dx%d, worst difference %d\n", inName, gpu->Width(), gpu->Height(), worst);
+   else if (worst)
+      printf("FAIL %s: difference %d at %d,%d\n", inName, worst, worst_x, worst_y);
+   else
+      printf("FAIL %s: gpu result is %dx%d, cpu %dx%d\n", inName,
+             gpu->Width(), gpu->Height(), cpu->Width(), cpu->Height());
+
+   gpu->DecRef();
+   cpu->DecRef();
+   delete inFilter;
+   return ok;
+}
+
+
+static Filter *CreateShadow(bool inHide, bool inKnockout)
+{
+   return new DropShadowFilter(2, 6, 4, 45, 5, 0x204080, 1.5, 0.75, inHide, inKnockout, false);
+}
+
+
+static int RunTests()
+{
+   if (!CreateContext())
+   {
+      printf("Could not create a surfaceless EGL context\n");
+      return 1;
+   }
+
+   HardwareRenderer *hardware = HardwareRenderer::CreateOpenGL(0,0,true);
+   if (!hardware)
+   {
+      printf("Could not load gl\n");
+      return 1;
+   }
+   hardware->IncRef();
+   printf("Renderer %s\n", (const char *)glGetString(GL_RENDERER));
+
+   QuickVec<float> matrix;
+   static const float sepia[] = { 0.39, 0.77, 0.19, 0, 10,
+                                  0.35, 0.69, 0.17, 0, 0,
+                                  0.27, 0.53, 0.13, 0, -20,
+                                  0,    0,    0,    0.8, 0 };
+   for(int i=0;i<20;i++)
+      matrix.push_back(sepia[i]);
+
+   Rect clip(5,3,30,20);
+
+   int failed = 0;
+   failed += !Check(hardware, "blur", new BlurFilter(1,5,3));
+   failed += !Check(hardware, "blur x3", new BlurFilter(3,4,6));
+   failed += !Check(hardware, "blur clipped", new BlurFilter(2,6,6), &clip);
+   failed += !Check(hardware, "colour matrix", new ColorMatrixFilter(matrix));
+   failed += !Check(hardware, "drop shadow", CreateShadow(false,false));
+   failed += !Check(hardware, "drop shadow knockout", CreateShadow(false,true));
+   failed += !Check(hardware, "drop shadow hideObject", CreateShadow(true,false));
+   failed += !Check(hardware, "drop shadow clipped", CreateShadow(false,false), &clip);
+
+   hardware->DecRef();
+
+   if (failed)
+      printf("%d failed\n", failed);
+   else
+      printf("All passed\n");
+   return failed ? 1 : 0;
+}
+
+} // end namespace nme
+
+
+int main(int argc, char **argv)
+{
+   return nme::RunTests();
+}
@@ -0,0 +1,7 @@
+set -e
+# Runs on Mesa's software renderer, through a surfaceless EGL context, so it needs no
+#  display or gpu
+cd ../../project
+haxelib run hxcpp Build.xml gpu-filter-test -DHXCPP_M64
+cd ../tests/native
+EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 bin/GpuFilterTest
@@ -0,0 +1,164 @@
+package;
+
+import haxe.io.Bytes;
+import haxe.io.BytesOutput;
+import sys.io.File;
+import sys.FileSystem;
+import nme.utils.ByteArray;
+import nme.utils.CompressionAlgorithm;
+
+
+// Writes the asset pack read by AssetPack in the native code - see AssetPack.h for the layout
+class PackHelper
+{
+   public static inline var packName = "assets.pak";
+
+   static inline var version = 1;
+   static inline var headerSize = 32;
+   static inline var entrySize = 32;
+   static inline var alignment = 16;
+   static inline var entryLzma = 1;
+
+   // These gain nothing from lzma, and are left as they are so they can be used in place
+   static var storedFormats = [ "png", "jpg", "jpeg", "gif", "ogg", "mp3", "mp2" ];
+
+
+   public static function packIfNewer(assets:Array<Asset>, destination:String)
+   {
+      var newer = !FileSystem.exists(destination);
+      for(asset in assets)
+         if (newer || asset.sourcePath=="" || FileHelper.isNewer(asset.sourcePath, destination))
+         {
+            newer = true;
+            break;
+         }
+
+      if (newer)
+         pack(assets, destination);
+   }
+
+
+   public static function pack(assets:Array<Asset>, destination:String)
+   {
+      Log.verbose("Packing " + assets.length + " assets into " + destination);
+
+      var entries = new Array<PackEntry>();
+      for(asset in assets)
+      {
+         var data:Bytes = null;
+         if (asset.sourcePath != "")
+            data = File.getBytes(asset.sourcePath);
+         else if (Std.is(asset.data, Bytes))
+            data = cast asset.data;
+         else
+            data = Bytes.ofString(Std.string(asset.data));
+
+         var entry = new PackEntry(asset.targetPath, data);
+         if (data.length>0 && storedFormats.indexOf(asset.format)<0)
+         {
+            var compressed = ByteArray.fromBytes(data);
+            compressed.compress(CompressionAlgorithm.LZMA);
+            if (compressed.length < data.length)
+            {
+               entry.stored = compressed.sub(0,compressed.length);
+               entry.flags = entryLzma;
+            }
+         }
+         entries.push(entry);
+      }
+
+      // The index is searched by hash
+      entries.sort(function(a,b) return a.hashKey<b.hashKey ? -1 : a.hashKey>b.hashKey ? 1 : 0 );
+
+      var names = new BytesOutput();
+      var nameOffsets = new Array<Int>();
+      for(entry in entries)
+      {
+         nameOffsets.push(names.length);
+         names.write(entry.name);
+      }
+      var nameBytes = names.getBytes();
+
+      var indexOffset = headerSize;
+      var namesOffset = indexOffset + entries.length*entrySize;
+      var dataOffsets = new Array<Int>();
+      var pos = namesOffset + nameBytes.length;
+      for(entry in entries)
+      {
+         pos = align(pos);
+         dataOffsets.push(pos);
+         pos += entry.stored.length;
+      }
+
+      var output = new BytesOutput();
+      output.bigEndian = false;
+      output.writeString("NMEP");
+      output.writeInt32(version);
+      output.writeInt32(entries.length);
+      output.writeInt32(indexOffset);
+      output.writeInt32(namesOffset);
+      output.writeInt32(nameBytes.length);
+      output.writeInt32(alignment);
+      output.writeInt32(0);
+
+      for(i in 0...entries.length)
+      {
+         var entry = entries[i];
+         output.writeUInt16(entry.hashLo);
+         output.writeUInt16(entry.hashHi);
+         output.writeInt32(entry.flags);
+         output.writeInt32(nameOffsets[i]);
+         output.writeInt32(entry.name.length);
+         output.writeInt32(dataOffsets[i]);
+         output.writeInt32(entry.stored.length);
+         output.writeInt32(entry.data.length);
+         output.writeInt32(0);
+      }
+      output.write(nameBytes);
+
+      for(i in 0...entries.length)
+      {
+         while(output.length < dataOffsets[i])
+            output.writeByte(0);
+         output.write(entries[i].stored);
+      }
+
+      File.saveBytes(destination, output.getBytes());
+   }
+
+   static function align(inPos:Int) return (inPos + alignment-1) & ~(alignment-1);
+}
+
+
+class PackEntry
+{
+   public var name:Bytes;
+   public var data:Bytes;
+   public var stored:Bytes;
+   public var flags:Int;
+   public var hashLo:Int;
+   public var hashHi:Int;
+   public var hashKey:Float;
+
+   public function new(inName:String, inData:Bytes)
+   {
+      name = Bytes.ofString(inName);
+      data = inData;
+      stored = inData;
+      flags = 0;
+
+      // 32 bit FNV-1a, in 16 bit halves so neko's 31 bit ints do not overflow
+      var lo = 0x9dc5;
+      var hi = 0x811c;
+      for(i in 0...name.length)
+      {
+         lo ^= name.get(i);
+         var loProduct = lo * 0x0193;
+         hi = (hi * 0x0193 + lo * 0x0100 + (loProduct>>>16)) & 0xffff;
+         lo = loProduct & 0xffff;
+      }
+      hashLo = lo;
+      hashHi = hi;
+      hashKey = hi * 65536.0 + lo;
+   }
+}
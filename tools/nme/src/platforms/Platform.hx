@@ -523,16 +523,30 @@ class Platform
    {
       var base = getAssetDir();
       PathHelper.mkdir(base);
+      // With "packAssets" defined, the files go into one pack that the runtime mounts
+      var packed = project.hasDef("packAssets") ? new Array<Asset>() : null;
       for(asset in project.assets) 
       {
          var target = catPaths(base, asset.targetPath );
          if (!asset.embed)
          {
+            if (packed!=null)
+            {
+               packed.push(asset);
+               continue;
+            }
             PathHelper.mkdir(Path.directory(target));
             addOutput(target);
             FileHelper.copyAssetIfNewer(asset, target);
          }
       }
+
+      if (packed!=null && packed.length>0)
+      {
+         var target = catPaths(base, PackHelper.packName);
+         addOutput(target);
+         PackHelper.packIfNewer(packed, target);
+      }
    }
 
    public function catPaths(inBase:String, inExtra:String)